@@ -0,0 +1,63 @@
+#ifndef CONNECTION_MANAGER_H
+#define CONNECTION_MANAGER_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <ESP8266WiFiMulti.h>
+#include "config.h"
+#include "MqttHandler.h"
+
+// 去相关抖动指数退避（decorrelated jitter）：
+//   delay = min(cap, random(base, 上次delay * 3))
+// 同一现场的设备在AP重启后同时掉线，各自按设备种子取随机数，重连时间自然错开。
+// 随机数用xorshift32，tools/reconnect_sim.py 按相同算法在主机上模拟整个现场的重连
+class ReconnectBackoff {
+private:
+    uint32_t rngState;
+    unsigned long base;
+    unsigned long cap;
+    unsigned long current;  // 上一次的退避时间，0表示已复位
+
+    uint32_t nextRandom();
+
+public:
+    ReconnectBackoff(unsigned long base, unsigned long cap);
+    // 设置随机种子（同一设备每次启动相同，不同设备不同）
+    void seed(uint32_t value);
+    // 下一次重试前的等待时间(ms)
+    unsigned long next();
+    // 连接成功后复位
+    void reset() { current = 0; }
+};
+
+// 连接管理：每轮loop检查WiFi与MQTT状态，断开后按退避时间重连
+class ConnectionManager {
+private:
+    ESP8266WiFiMulti& wifiMulti;
+    MqttHandler& mqttHandler;
+    ReconnectBackoff wifiBackoff;
+    ReconnectBackoff mqttBackoff;
+    bool wifiUp;
+    bool mqttUp;
+    unsigned long nextWifiAttempt;
+    unsigned long nextMqttAttempt;
+    unsigned long wifiAttempts;
+    unsigned long mqttAttempts;
+
+    void updateWiFi(unsigned long now);
+    void updateMqtt(unsigned long now);
+
+public:
+    ConnectionManager(ESP8266WiFiMulti& wifi, MqttHandler& mqtt);
+    // 按芯片ID和设备ID生成退避种子，并记录初始连接状态（在setup末尾调用）
+    void begin();
+    // 检查连接并在退避到期时重连，在loop()中调用
+    void update(unsigned long now);
+    // 距下一次重连尝试的时间(ms)，已连接时返回POWER_NO_DEADLINE
+    unsigned long getNextDeadlineIn(unsigned long now) const;
+
+    unsigned long getWifiAttempts() const { return wifiAttempts; }
+    unsigned long getMqttAttempts() const { return mqttAttempts; }
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+#include "ThingModel.h"
+
+class MqttHandler;
+
+// 子设备登录状态
+enum SubDeviceState {
+    SUB_OFFLINE,        // 未登录
+    SUB_LOGIN_PENDING,  // 已发送thing/sub/login，等待应答
+    SUB_ONLINE,         // 已登录，可批量上报
+    SUB_LOGOUT_PENDING  // 已发送thing/sub/logout，等待应答
+};
+
+// 子设备记录，名称即串口行/命令包中的标签
+struct SubDevice {
+    String name;
+    SubDeviceState state;
+    bool wantOnline;             // 是否需要保持登录（收到数据或LOGIN后置位，LOGOUT后清除）
+    String requestId;            // 未完成的登录/登出请求id
+    unsigned long requestTime;   // 最近一次登录/登出请求的时间戳
+    ThingProperties batch;       // 当前批次（每个子设备单独累积）
+    uint8_t sampleCount;
+    size_t batchBytes;           // 当前批次的JSON字节估算
+    unsigned long batchStartTime;
+};
+
+// 网关：一个MQTT会话代理多个子设备（STM32或其他串口板卡）
+// 子设备与网关使用同一物模型，需事先在OneNET上与网关建立拓扑关系
+class Gateway {
+private:
+    std::vector<SubDevice> subDevices;
+    MqttHandler* mqttHandler;
+    unsigned long packCount;       // 已发布的pack/post消息数
+    unsigned long droppedSamples;  // 子设备表已满或批次已满时被丢弃/覆盖的样本数
+    bool connected;                // 最近一次update()时MQTT是否已连接
+
+    SubDevice* find(const char* name);
+    SubDevice* findOrAdd(const String& name);
+    void sendLogin(SubDevice& dev, unsigned long now);
+    void sendLogout(SubDevice& dev, unsigned long now);
+    void clearBatch(SubDevice& dev);
+    bool flushBatches();
+    void appendPackEntry(String& out, const SubDevice& dev) const;
+
+public:
+    Gateway();
+    void setMqttHandler(MqttHandler* handler) { mqttHandler = handler; }
+    // 加入子设备相关主题的订阅（在MQTT连接之前调用）
+    void begin();
+    // 子设备上线/下线（串口行 "@名称 LOGIN" / "@名称 LOGOUT"）
+    void login(const String& name);
+    void logout(const String& name);
+    // 加入子设备的一个样本，子设备未登录时自动登录；样本被丢弃时返回false
+    bool addSample(const String& name, const String& key, const String& value);
+    // 批次延迟检查、登录超时与重试，在loop()中调用
+    void update(unsigned long now);
+    // MQTT连接成功后重新登录全部子设备（网关断线后平台会将子设备置为离线）
+    void onConnected();
+    // 处理登录/登出应答
+    void handleLoginReply(const char* payload, unsigned int length, bool isLogin);
+    // 子设备是否已登录（属性设置只路由给在线子设备）
+    bool isOnline(const char* name);
+    // 距下一个定时事件（批次上传、登录超时/重试）的时间(ms)
+    unsigned long getNextDeadlineIn(unsigned long now) const;
+
+    size_t getSubDeviceCount() const { return subDevices.size(); }
+    size_t getOnlineCount() const;
+    unsigned long getPackCount() const { return packCount; }
+    unsigned long getDroppedSamples() const { return droppedSamples; }
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "ThingModel.h"
+
+// 运行指标类型
+enum MetricKind : uint8_t {
+    METRIC_COUNTER,    // 开机以来累计
+    METRIC_GAUGE,      // 最近一次的值
+    METRIC_LOW_WATER,  // 开机以来的最低值
+    METRIC_PEAK        // 上报周期内的最高值，上报后清零
+};
+
+// 运行指标注册表：每个指标对应物模型中一个只读整数属性，
+// 随心跳单独上报，或在心跳到期前捎带在普通属性上报中
+class Metrics {
+public:
+    // 计数器累加
+    static void add(ThingPropertyId id, int32_t delta = 1);
+    // 设置仪表值（GAUGE直接覆盖，LOW_WATER/PEAK只保留最低/最高值）
+    static void set(ThingPropertyId id, int32_t value);
+    static int32_t get(ThingPropertyId id);
+
+    // 距上次上报已达心跳间隔（运行参数HEARTBEAT_INTERVAL）-window时返回true
+    static bool isDue(unsigned long now, unsigned long window = 0);
+    // 距下一次心跳的时间(ms)
+    static unsigned long getNextDueIn(unsigned long now);
+    // 将全部指标写入props，记录上报时间并清零PEAK指标
+    static void collect(ThingProperties& props, unsigned long now);
+
+private:
+    static int32_t values[TP_COUNT];
+    static bool seen[TP_COUNT];      // LOW_WATER/PEAK是否已有值
+    static unsigned long lastReport;
+    static MetricKind kindOf(ThingPropertyId id, bool& registered);
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+#include "config.h"
+#include "MqttCodec.h"
+#include "MqttTransport.h"
+
+// 连接状态，取值与PubSubClient的state()一致，日志中的状态码含义不变
+enum MqttClientState {
+    MQTT_CONNECTION_TIMEOUT = -4,
+    MQTT_CONNECTION_LOST = -3,
+    MQTT_CONNECT_FAILED = -2,
+    MQTT_DISCONNECTED = -1,
+    MQTT_CONNECTED = 0,
+    MQTT_CONNECT_BAD_PROTOCOL = 1,
+    MQTT_CONNECT_BAD_CLIENT_ID = 2,
+    MQTT_CONNECT_UNAVAILABLE = 3,
+    MQTT_CONNECT_BAD_CREDENTIALS = 4,
+    MQTT_CONNECT_UNAUTHORIZED = 5
+};
+
+// MQTT 3.1.1客户端（取代PubSubClient）
+// 发布时报头与负载分段交给传输层，不经过固定的发送缓冲区；
+// 接收的字节直接读入解码器的环形缓冲区，每次loop()处理完所有已到达的报文，
+// 回调拿到的主题和负载都指向接收缓冲区，不做拷贝
+class MqttClient {
+public:
+    typedef std::function<void(char* topic, uint8_t* payload, unsigned int length)> MessageCallback;
+    typedef std::function<void(uint16_t packetId)> AckCallback;
+
+private:
+    MqttTransport& transport;
+    MqttDecoder decoder;
+    std::vector<uint8_t> packet;   // CONNECT/SUBSCRIBE编码缓冲，重复使用
+    const char* host;
+    uint16_t port;
+    uint16_t keepAlive;
+    int state;
+    bool pingOutstanding;
+    unsigned long lastInActivity;
+    unsigned long lastOutActivity;
+    uint16_t nextPacketId;
+    unsigned long rxPacketCount;
+    MessageCallback messageCallback;
+    AckCallback ackCallback;
+
+    bool write(const MqttIoVec* iov, size_t count);
+    bool writePacket(const uint8_t* data, size_t length);
+    // 读取并处理所有已到达的报文，格式错误时断开连接
+    void drain();
+    void handlePacket(MqttPacket& packet);
+
+public:
+    MqttClient(MqttTransport& transport, size_t rxBufferSize);
+
+    void setServer(const char* serverHost, uint16_t serverPort) { host = serverHost; port = serverPort; }
+    void setKeepAlive(uint16_t seconds) { keepAlive = seconds; }
+    void setCallback(MessageCallback callback) { messageCallback = callback; }
+    // 收到PUBACK时调用
+    void setAckCallback(AckCallback callback) { ackCallback = callback; }
+
+    // 建立TCP连接并等待CONNACK（最长MQTT_CONNECT_TIMEOUT）
+    bool connect(const char* clientId, const char* user, const char* pass, bool cleanSession);
+    void disconnect();
+    bool connected();
+    int getState() const { return state; }
+    // 处理入站报文并维持保活，返回是否仍处于连接状态
+    bool loop();
+
+    bool publish(const char* topic, const uint8_t* payload, size_t length,
+                 uint8_t qos = 0, bool dup = false, uint16_t packetId = 0);
+    // 多个主题合并在一个SUBSCRIBE报文中（packet id使用1~0x7FFF）
+    bool subscribe(const char* const* topics, size_t count, uint8_t qos = 0);
+
+    // 已收到的报文数
+    unsigned long getRxPacketCount() const { return rxPacketCount; }
+    // 因超过接收缓冲区而被跳过的报文数
+    unsigned long getOversizeCount() const { return decoder.getOversizeCount(); }
+};
+
+#endif
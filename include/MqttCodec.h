@@ -0,0 +1,109 @@
+#ifndef MQTT_CODEC_H
+#define MQTT_CODEC_H
+
+// MQTT 3.1.1 报文编解码（设备用到的子集）
+// 只依赖标准库，不包含Arduino头文件，可在PC上直接编译，用抓包得到的报文字节测试
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+enum MqttPacketType : uint8_t {
+    MQTT_PACKET_CONNECT = 1,
+    MQTT_PACKET_CONNACK = 2,
+    MQTT_PACKET_PUBLISH = 3,
+    MQTT_PACKET_PUBACK = 4,
+    MQTT_PACKET_SUBSCRIBE = 8,
+    MQTT_PACKET_SUBACK = 9,
+    MQTT_PACKET_UNSUBACK = 11,
+    MQTT_PACKET_PINGREQ = 12,
+    MQTT_PACKET_PINGRESP = 13,
+    MQTT_PACKET_DISCONNECT = 14
+};
+
+// 一段待写出的数据（分散写入，报头与负载不拼接）
+struct MqttIoVec {
+    const uint8_t* data;
+    size_t length;
+};
+
+// PUBLISH报文的分段：固定报头+主题长度、主题、packet id、负载
+struct MqttPublishFrame {
+    uint8_t header[7];
+    uint8_t packetId[2];
+    MqttIoVec iov[4];
+    size_t count;
+};
+
+// 写入剩余长度（1~4字节），返回写入的字节数
+size_t mqttWriteRemainingLength(uint8_t* out, uint32_t length);
+
+// 组装PUBLISH分段，topic与payload不拷贝，frame有效期内两者须保持不变
+void mqttBuildPublish(MqttPublishFrame& frame, const char* topic, const uint8_t* payload, size_t length,
+                      uint8_t qos, bool dup, uint16_t packetId);
+
+// 以下编码函数将报文追加到out末尾
+void mqttEncodeConnect(std::vector<uint8_t>& out, const char* clientId, const char* user, const char* pass,
+                       uint16_t keepAlive, bool cleanSession);
+void mqttEncodeSubscribe(std::vector<uint8_t>& out, uint16_t packetId, const char* const* topics, size_t count,
+                         uint8_t qos);
+
+// 只有packet id的报文（PUBACK等），out至少4字节，返回报文长度
+size_t mqttEncodeAck(uint8_t* out, MqttPacketType type, uint16_t packetId);
+// 没有可变报头的报文（PINGREQ/PINGRESP/DISCONNECT），out至少2字节，返回报文长度
+size_t mqttEncodeEmpty(uint8_t* out, MqttPacketType type);
+
+enum MqttDecodeStatus {
+    MQTT_DECODE_PACKET,     // 取出一个完整报文
+    MQTT_DECODE_NEED_MORE,  // 数据不足，等待更多字节
+    MQTT_DECODE_ERROR       // 报文格式错误，需断开连接
+};
+
+// 解析出的报文，指针指向接收缓冲区，在下一次调用解码器的非const方法前有效
+struct MqttPacket {
+    uint8_t type;
+    uint8_t flags;
+    uint8_t* body;           // 可变报头与负载
+    uint32_t length;         // 剩余长度
+    uint16_t packetId;       // PUBLISH(QoS>0)/PUBACK/SUBACK的packet id，其他为0
+    // 以下仅PUBLISH有效
+    char* topic;             // 已在缓冲区内就地以'\0'结尾
+    uint8_t* payload;
+    uint32_t payloadLength;
+};
+
+// 入站报文解码：字节写入环形缓冲区，按报文边界逐个取出，报文不拷贝
+// 跨越缓冲区末尾的报文先将缓冲区旋转为连续，超过缓冲区容量的报文被跳过并计数
+class MqttDecoder {
+private:
+    uint8_t* ring;
+    size_t capacity;
+    size_t head;             // 第一个未处理字节的位置
+    size_t count;            // 未处理字节数
+    uint32_t skipRemaining;  // 正在跳过的超长报文剩余字节数
+    unsigned long oversizeCount;
+
+    uint8_t at(size_t offset) const { return ring[(head + offset) % capacity]; }
+    void drop(size_t n);
+
+public:
+    explicit MqttDecoder(size_t size);
+    ~MqttDecoder();
+    MqttDecoder(const MqttDecoder&) = delete;
+    MqttDecoder& operator=(const MqttDecoder&) = delete;
+
+    void reset();
+    // 可直接写入的连续空闲区，从socket读到这里后调用commit
+    uint8_t* writePointer(size_t& space);
+    void commit(size_t n);
+    // 拷贝写入，返回实际写入的字节数
+    size_t feed(const uint8_t* data, size_t length);
+    // 取出下一个完整报文
+    MqttDecodeStatus next(MqttPacket& packet);
+
+    size_t size() const { return count; }
+    size_t getCapacity() const { return capacity; }
+    unsigned long getOversizeCount() const { return oversizeCount; }
+};
+
+#endif
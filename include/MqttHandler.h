@@ -2,9 +2,18 @@
 #define MQTT_HANDLER_H
 
 #include <Arduino.h>
-#include <PubSubClient.h>
 #include <WiFiClient.h>
 #include <ArduinoJson.h>
+#include "ThingModel.h"
+#include "PropertyShadow.h"
+#include "Metrics.h"
+#include "TopicCache.h"
+#include "RequestCache.h"
+#include "Settings.h"
+#include "MqttTransport.h"
+#include "MqttClient.h"
+#include "MqttQos.h"
+#include "TelemetryQueue.h"
 
 // 待发送消息结构
 struct PendingMessage {
@@ -14,25 +23,100 @@ struct PendingMessage {
     unsigned long nextAttemptTime;
 };
 
+// 单个属性的设置结果
+struct PropertySetResult {
+    String name;
+    int code;      // 200成功，400类型或范围不符，403只读，404未定义，500 STM32执行失败，503命令队列已满
+    uint16_t seq;  // 等待确认的STM32命令序号，0表示无需等待
+};
+
+// 属性设置完成后的处理方式
+enum SetReplyMode : uint8_t {
+    SET_REPLY_ONLY,      // 网关子设备：只发送响应，不涉及本设备的属性影子
+    SET_REPLY_COMMIT,    // 云端设置：发送响应，最终结果为200的属性写入属性影子
+    SET_COMMIT_POST      // 期望值同步：不发送响应，最终结果为200的属性写入影子并上报
+};
+
+// 等待STM32确认后才能发送的属性设置响应
+struct PendingSetReply {
+    String requestId;
+    TopicId replyTopic;  // 网关子设备的设置响应发往thing/sub/property/set_reply
+    SetReplyMode mode;
+    ThingProperties applied;  // 本次应用的属性值
+    std::vector<PropertySetResult> results;
+    String message;           // 本地拒绝的原因（如运行参数无效），非空时按400响应
+};
+
+class SerialHandler;
+class Gateway;
+class RuleEngine;
+
 class MqttHandler {
 private:
     WiFiClient* wifiClient;
-    PubSubClient *mqttClient;
+    MqttInflight inflight;         // QoS1发送窗口
+    WiFiMqttTransport* transport;  // MqttClient经由它读写wifiClient
+    MqttClient *mqttClient;
     void (*propertySetCallback)(const String&topic, const String&payload);
 
     unsigned long lastPublishAttempt;// 上一次发布尝试的时间戳（以毫秒为单位）
     int publishRetryCount;//
+    unsigned long droppedMessageCount; // 因队列已满丢弃的消息数
+
+    std::vector<PendingMessage> messageQueue; // 消息重传队列（条数上限与重试次数为运行参数）
 
-    std::vector<PendingMessage> messageQueue; // 消息重传队列
-    const int MAX_QUEUE_SIZE = 10; // 最大队列大小
-    const int MAX_RETRY_COUNT = 3; // 最大重试次数
+    TelemetryQueue telemetryQueue; // 离线期间的属性上报（紧凑格式）
+    unsigned long telemetryRetryTime; // 排队属性上报发送失败后的下次重试时间
 
     void processMessageQueue(); // 处理消息队列
+    void processTelemetryQueue(); // 将排队的属性上报展开为JSON发送
+    bool sendPublish(const char* topic, const char* payload); // 按MQTT_PUBLISH_QOS发送一条消息
+    bool enqueueMessage(const char* topic, const char* payload, unsigned long delayMs);
+
+    SerialHandler* serialHandler;  // 串口处理器引用（STM32命令通道）
+    Gateway* gateway;              // 网关引用（GATEWAY_MODE为0时为空）
+    RuleEngine* ruleEngine;        // 本地规则引用（RULE_ENGINE_ENABLE为0时为空）
+    std::vector<PendingSetReply> pendingSetReplies; // 等待STM32确认的响应
+    uint16_t currentCommandSeq;  // 当前属性发出的STM32命令序号
+    int currentResultCode;       // 当前属性在本地的结果码，0表示成功（503命令入队失败，400参数无效）
+    String currentResultMessage; // 当前属性被本地拒绝的原因
+    int pendingLedState;         // 批量应用后统一写入的LED电平，-1表示不变
+    unsigned long connectCount;  // MQTT连接成功次数，大于0后的连接计为重连
+    std::vector<const char*> subscriptions; // 需要订阅的主题，每次连接后一次性恢复
+    uint16_t keepAlive;          // 本次连接使用的保活时间(s)
+    uint16_t keepAliveLimit;     // 保活时间上限，会话因保活超时断开后减半
+    bool sessionUp;              // 上一次连接是否成功建立过会话
+
+    uint16_t chooseKeepAlive(int32_t rssi);
+    void addSubscription(const char* topic);
+    bool restoreSubscriptions();
+
+    PropertyShadow shadow;         // 设备属性影子
+    RequestCache requestCache;     // 最近处理的属性设置请求及其响应
+
+    // 以 key=value 发给STM32
+    bool sendStm32Command(const String& propertyName, const String& value);
+    // 应用reply.applied，结果写入reply.results与reply.message
+    void applyProperties(PendingSetReply& reply);
+    // 所有STM32命令都已确认时按mode完成设置，否则挂起等待确认
+    void finishPropertySet(PendingSetReply& reply);
+    void commitProperties(const ThingProperties& applied, const std::vector<PropertySetResult>& results, bool post);
 
-    void mqttCallback(char* topic, byte* payload, unsigned int length);
-    void handlePropertySetCommand(const String& topic, const String& payload);
-    void sendPropertySetResponse(const String& requestId, int code, const String& message);
-    void processPropertySetValue(const String& propertyName, const JsonVariant& propertyValue);
+    void mqttCallback(char* topic, uint8_t* payload, unsigned int length);
+    void handlePropertySetCommand(char* payload, unsigned int length);
+    void handlePropertyGetCommand(char* payload, unsigned int length);
+    void handleDesiredGetReply(char* payload, unsigned int length);
+    void handleSubPropertySetCommand(char* payload, unsigned int length);
+    bool replayDuplicate(const String& requestId, TopicId replyTopic);
+    void sendPropertySetResponse(const String& requestId, int code, const char* message,
+                                 const std::vector<PropertySetResult>* results = nullptr,
+                                 TopicId replyTopic = TOPIC_SET_REPLY);
+    // 按物模型类型应用单个属性（由thingVisit分发）
+    friend struct ThingApplyVisitor;
+    void applyThingProperty(ThingPropertyId id, bool value);
+    void applyThingProperty(ThingPropertyId id, int32_t value);
+    void applyThingProperty(ThingPropertyId id, float value);
+    void applyThingProperty(ThingPropertyId id, const String& value);
     void handleDeviceProperty(const String& propertyName, const String& value);
     void handleDeviceProperty_String(const String& propertyName, const String& value);
     void handleDeviceProperty_Int(const String& propertyName, int value);
@@ -44,13 +128,50 @@ public:
     ~MqttHandler();
     bool init();
     void setUserCallback(void (*callback)(const String&topic, const String&payload));
-    bool connect(const char *topic);
+    // 连接MQTT服务器，topic非空时加入订阅列表；连接成功后恢复全部订阅
+    bool connect(const char *topic = nullptr);
     void loop();
     bool publish(const char* topic, const char* payload, bool queued = false);
+    // 加入订阅列表，已连接时立即订阅（重连后自动恢复）
     bool subscribe(const char* topic);
+    uint16_t getKeepAlive() const { return keepAlive; }
     bool isConnected();
+    // 已收到的MQTT报文数，用于判断本轮是否有网络活动
+    unsigned long getRxPacketCount() const { return mqttClient->getRxPacketCount(); }
+    // 距下一个定时事件（队列重发、保活心跳）的时间(ms)
+    unsigned long getNextDeadlineIn(unsigned long now) const;
+    // 发送心跳：单独上报一次运行指标（需符合物模型）
     void sendHeartbeat();
+    // 采样队列深度、丢弃数、RSSI等指标并写入props
+    void collectMetrics(ThingProperties& props);
     size_t getQueueSize() const { return messageQueue.size(); }
+    size_t getQueueCapacity() const { return Settings::get(CFG_MAX_QUEUE_SIZE); }
+    bool isQueueFull() const { return messageQueue.size() >= getQueueCapacity() || telemetryQueue.isFull(); }
+    // 重传队列与属性上报队列中较高的填充率(%)
+    int getQueueLevel() const;
+    // 离线属性上报队列（记录数、字节数与压缩比）
+    const TelemetryQueue& getTelemetryQueue() const { return telemetryQueue; }
+    unsigned long getDroppedMessageCount() const { return droppedMessageCount + telemetryQueue.getDroppedCount(); }
+    // QoS1发送窗口（在途数量、窗口大小与确认统计）
+    MqttInflight& getInflight() { return inflight; }
+    // 收到的重复属性设置请求数（未重复执行）
+    unsigned long getDuplicateCount() const { return requestCache.getDuplicateCount(); }
+    // 设置串口处理器引用，用于向STM32发送命令
+    void setSerialHandler(SerialHandler* handler) { serialHandler = handler; }
+    // 设置网关引用，用于子设备登录应答与属性设置路由
+    void setGateway(Gateway* handler) { gateway = handler; }
+    // 设置本地规则引用，阈值属性应用后重新编译规则
+    void setRuleEngine(RuleEngine* engine) { ruleEngine = engine; }
+    // 上报属性（同时更新属性影子）
+    bool postProperties(const ThingProperties& props, bool queued = false);
+    // 向云端请求可写属性的期望值，连接成功后自动调用
+    void requestDesiredProperties();
+    // 获取属性影子
+    PropertyShadow& getShadow() { return shadow; }
+    // STM32命令确认/拒绝/超时的通知
+    void onStm32CommandResult(uint16_t seq, bool success);
+    // 本地规则驱动LED：与LED属性走同一写入路径，并记入属性影子
+    void applyRuleLed(bool on);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef MQTT_QOS_H
+#define MQTT_QOS_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+#include "MqttClient.h"
+
+// QoS1在途消息（已发送，等待PUBACK）
+struct InflightMessage {
+    uint16_t packetId;
+    String topic;
+    String payload;
+    unsigned long sentTime;  // 最近一次发送的时间戳
+    uint8_t resendCount;     // 确认超时后的重发次数（重连后的重发不计入）
+};
+
+// QoS1发送窗口：分配packet id，允许多条PUBLISH同时在途，按PUBACK释放
+class MqttInflight {
+private:
+    std::vector<InflightMessage> messages;
+    uint16_t nextPacketId;
+    uint8_t windowSize;
+    unsigned long ackCount;        // 收到的PUBACK数
+    unsigned long resendCount;     // DUP重发次数
+    unsigned long dropCount;       // 超过重发次数后放弃的消息数
+
+    uint16_t allocatePacketId();
+    bool writePublish(MqttClient& client, const InflightMessage& msg, bool dup);
+
+public:
+    MqttInflight();
+    // 设置窗口大小（1~MQTT_QOS1_WINDOW_MAX），已在途的消息不受影响
+    void setWindowSize(uint8_t size);
+    uint8_t getWindowSize() const { return windowSize; }
+    bool isFull() const { return messages.size() >= windowSize; }
+    size_t size() const { return messages.size(); }
+
+    // 以QoS1发送，写入失败时返回false（消息不进入窗口）
+    bool publish(MqttClient& client, const char* topic, const char* payload, unsigned long now);
+    // 收到PUBACK，释放对应消息
+    void ack(uint16_t packetId);
+    // 重连后以DUP标志重发全部在途消息（持久会话下服务器按packet id去重）
+    void resendAll(MqttClient& client, unsigned long now);
+    // 确认超时的消息以DUP标志重发，超过MQTT_QOS1_MAX_RESEND次后放弃
+    void checkTimeouts(MqttClient& client, unsigned long now);
+    // 距最早一条在途消息确认超时的时间(ms)
+    unsigned long getNextDeadlineIn(unsigned long now) const;
+
+    unsigned long getAckCount() const { return ackCount; }
+    unsigned long getResendCount() const { return resendCount; }
+    unsigned long getDropCount() const { return dropCount; }
+};
+
+#endif
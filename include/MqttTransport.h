@@ -0,0 +1,40 @@
+#ifndef MQTT_TRANSPORT_H
+#define MQTT_TRANSPORT_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include "config.h"
+#include "MqttCodec.h"
+
+// MQTT使用的字节流连接，MqttClient只通过该接口收发
+class MqttTransport {
+public:
+    virtual ~MqttTransport() {}
+    virtual bool open(const char* host, uint16_t port) = 0;
+    virtual void close() = 0;
+    virtual bool isOpen() = 0;
+    virtual int available() = 0;
+    virtual int read(uint8_t* buf, size_t size) = 0;
+    // 按顺序写出多段数据，全部写入时返回true
+    virtual bool writev(const MqttIoVec* iov, size_t count) = 0;
+};
+
+// 基于WiFiClient的TCP连接
+// 连接后关闭Nagle；相邻的小分段在栈上合并后写出，避免每段各占一个TCP段，
+// 超过MQTT_TRANSPORT_MERGE_BYTES的分段（负载）直接交给WiFiClient，不做拷贝
+class WiFiMqttTransport : public MqttTransport {
+private:
+    WiFiClient& client;
+
+public:
+    explicit WiFiMqttTransport(WiFiClient& wifiClient) : client(wifiClient) {}
+
+    bool open(const char* host, uint16_t port) override;
+    void close() override { client.stop(); }
+    bool isOpen() override { return client.connected(); }
+    int available() override { return client.available(); }
+    int read(uint8_t* buf, size_t size) override { return client.read(buf, size); }
+    bool writev(const MqttIoVec* iov, size_t count) override;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <stdint.h>
+#include "config.h"
+
+// 低功耗管理：根据下一个定时事件（MQTT保活、NTP、批次上传、重连检查等）的剩余时间
+// 选择保持唤醒、modem sleep或light sleep。决策逻辑不依赖Arduino，时钟由构造函数注入，
+// 可在主机上用假时钟验证；实际的休眠动作由main.cpp中的enterPowerMode()执行
+
+// 没有待处理的定时事件
+const unsigned long POWER_NO_DEADLINE = 0xFFFFFFFFUL;
+
+enum PowerMode {
+    POWER_AWAKE,        // 保持唤醒，短暂等待或立即继续
+    POWER_MODEM_SLEEP,  // 射频按DTIM间歇关闭，CPU保持运行
+    POWER_LIGHT_SLEEP   // 射频与CPU时钟均暂停，串口RX(GPIO3)低电平唤醒
+};
+
+struct PowerInputs {
+    unsigned long idleFor;         // 距上次串口/MQTT活动的时间(ms)
+    unsigned long nextDeadlineIn;  // 距下一个定时事件的时间(ms)，POWER_NO_DEADLINE表示没有
+    bool pendingWork;              // 有未处理完的数据（半行串口数据、流控暂停中等）
+};
+
+struct PowerDecision {
+    PowerMode mode;
+    unsigned long duration;        // 本次等待/休眠的时长(ms)
+};
+
+typedef unsigned long (*PowerClock)();
+
+class PowerManager {
+private:
+    PowerClock clock;
+    unsigned long startTime;
+    unsigned long lastActivity;
+    unsigned long sleepStart;
+    unsigned long sleepMillis;     // 累计休眠时间
+    unsigned long wakeCount;       // 休眠结束次数
+    unsigned long eventWakeCount;  // 被串口/网络数据提前唤醒的次数
+    unsigned long lightSleepCount; // 进入light sleep的次数
+    bool sleeping;
+
+public:
+    explicit PowerManager(PowerClock clock);
+
+    // 纯决策函数：根据空闲时间与下一事件选择模式和时长
+    static PowerDecision decide(const PowerInputs& inputs);
+    // 距 start+interval 还剩多少毫秒（已到期返回0，处理millis()回绕）
+    static unsigned long timeUntil(unsigned long start, unsigned long interval, unsigned long now);
+
+    // 记录一次串口/MQTT活动，之后POWER_IDLE_THRESHOLD内保持唤醒
+    void noteActivity();
+    // 按当前时钟生成决策，需要休眠时开始计时
+    PowerDecision plan(unsigned long nextDeadlineIn, bool pendingWork);
+    // 休眠结束，byEvent表示被串口/网络数据提前唤醒
+    void wake(bool byEvent);
+
+    unsigned long now() const { return clock(); }
+    // 唤醒时间占比(%)
+    int getAwakeRatio() const;
+    unsigned long getSleepMillis() const { return sleepMillis; }
+    unsigned long getWakeCount() const { return wakeCount; }
+    unsigned long getEventWakeCount() const { return eventWakeCount; }
+    unsigned long getLightSleepCount() const { return lightSleepCount; }
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef PROPERTY_SHADOW_H
+#define PROPERTY_SHADOW_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "ThingModel.h"
+
+// 设备属性影子：记录上报值与期望值及其版本号
+// 云端property/get直接由影子应答，开机后通过desired/get与云端期望状态对齐
+class PropertyShadow {
+private:
+    ThingProperties reported;              // 设备当前（已上报/已应用）的属性值
+    ThingProperties desired;               // 云端期望的属性值
+    ThingProperties persisted;             // 保存到Flash的可写属性值（不含只在内存中更新的值）
+    uint32_t reportedVersion[TP_COUNT];    // 每次上报/应用后递增
+    uint32_t desiredVersion[TP_COUNT];     // 云端期望值的版本号
+    bool dirty;                            // 可写属性有变化，尚未保存
+
+public:
+    PropertyShadow();
+    // 从Flash载入影子（SHADOW_PERSIST为1时），在setup中调用
+    void begin();
+    // 合并上报/应用后的属性值，对应属性的版本号加1
+    // persist为false时只更新内存中的值（如本地规则驱动的LED），Flash中保留上次保存的值
+    void report(const ThingProperties& props, bool persist = true);
+    // 云端期望值的版本比影子新时记录并返回true
+    bool acceptDesired(ThingPropertyId id, const ThingProperties& props, uint32_t version);
+    // 将可写属性保存到Flash，没有变化时不写入
+    void save();
+
+    const ThingProperties& getReported() const { return reported; }
+    const ThingProperties& getDesired() const { return desired; }
+    uint32_t getVersion(ThingPropertyId id) const { return reportedVersion[id]; }
+    uint32_t getDesiredVersion(ThingPropertyId id) const { return desiredVersion[id]; }
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef REQUEST_CACHE_H
+#define REQUEST_CACHE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "TopicCache.h"
+
+// 已处理请求的记录
+struct CachedReply {
+    String requestId;
+    TopicId replyTopic;  // 响应主题，同时区分设备自身与子设备的请求
+    String reply;        // 已发送的响应，空表示仍在等待STM32确认
+    uint32_t lastUsed;   // 最近使用的序号，0表示空槽
+};
+
+// 最近请求id缓存（固定大小，最久未使用的记录被挤出）
+// OneNET在set_reply迟到时会重发property/set，重复的请求直接返回原响应，不再重复执行
+class RequestCache {
+private:
+    CachedReply entries[REQUEST_CACHE_SIZE];
+    uint32_t useCounter;
+    unsigned long duplicateCount;
+
+    CachedReply* find(const String& requestId, TopicId replyTopic);
+
+public:
+    RequestCache();
+    // 查找重复请求，找到时计入重复次数并返回记录（reply为空表示原请求仍在处理），否则返回nullptr
+    const CachedReply* checkDuplicate(const String& requestId, TopicId replyTopic);
+    // 记录开始处理的请求
+    void begin(const String& requestId, TopicId replyTopic);
+    // 保存请求的响应，供重复请求直接返回
+    void complete(const String& requestId, TopicId replyTopic, const String& reply);
+    unsigned long getDuplicateCount() const { return duplicateCount; }
+};
+
+#endif
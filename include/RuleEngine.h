@@ -0,0 +1,74 @@
+#ifndef RULE_ENGINE_H
+#define RULE_ENGINE_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+#include "ThingModel.h"
+
+class SerialHandler;
+class MqttHandler;
+
+// 比较方式
+enum RuleOp {
+    RULE_ABOVE,  // 输入 > 阈值时触发，回落到 阈值-回差 及以下时恢复
+    RULE_BELOW   // 输入 < 阈值时触发，回升到 阈值+回差 及以上时恢复
+};
+
+// 规则定义（注册表见 src/RuleEngine.cpp）
+struct RuleDef {
+    ThingPropertyId input;      // 采样属性（STM32上报的 key=value）
+    RuleOp op;
+    ThingPropertyId threshold;  // 阈值属性（云端下发，保存在属性影子中）
+    int32_t hysteresis;         // 回差，按输入属性的步长计（温度保留1位小数时1即0.1℃）
+    bool led;                   // 触发时点亮LED，恢复时熄灭（等同设置LED属性）
+    const char* enterCommand;   // 触发时发给STM32的命令，nullptr表示不发送
+    const char* exitCommand;    // 恢复时发给STM32的命令，nullptr表示不发送
+};
+
+// 本地阈值规则：STM32上报的每个样本在串口处理中立即求值，越过阈值时直接驱动LED/向STM32发送命令，
+// 无需等待云端往返，断网时同样有效
+//
+// 阈值属性变化时把规则编译为紧凑的求值表：阈值换算为输入属性的缩放整数，
+// 表项按输入属性分组，求值时只检查该属性的规则，比较为整数比较
+class RuleEngine {
+private:
+    // 求值表项
+    struct RuleSlot {
+        int32_t enterLimit;   // 越过该值触发（缩放整数）
+        int32_t exitLimit;    // 越过该值恢复（已计入回差）
+        uint8_t rule;         // RuleDef下标
+        bool armed;           // 阈值属性已有取值
+        bool active;          // 当前处于触发状态
+    };
+
+    std::vector<RuleSlot> slots;       // 按输入属性分组
+    uint8_t firstSlot[TP_COUNT + 1];   // 属性i的表项为[firstSlot[i], firstSlot[i+1])
+    SerialHandler* serialHandler;
+    MqttHandler* mqttHandler;
+
+    unsigned long fireCount;           // 触发与恢复的动作次数
+    unsigned long maxLatency;          // 从样本进入求值到动作执行完成的最长耗时(us)
+
+    void runAction(const RuleDef& def, bool enter, unsigned long start);
+
+public:
+    RuleEngine();
+
+    // 按阈值属性的当前取值重新编译求值表（阈值未赋值的规则不参与求值）
+    void compile(const ThingProperties& thresholds);
+    // 求值一个刚解析的样本，props中id对应的字段为样本值
+    void ingest(ThingPropertyId id, const ThingProperties& props);
+
+    // 设置串口处理器引用，用于向STM32发送命令
+    void setSerialHandler(SerialHandler* handler) { serialHandler = handler; }
+    // 设置MQTT处理器引用，LED动作经由LED属性的写入路径并更新属性影子
+    void setMqttHandler(MqttHandler* handler) { mqttHandler = handler; }
+    size_t getRuleCount() const { return slots.size(); }
+    size_t getArmedCount() const;
+    size_t getActiveCount() const;
+    unsigned long getFireCount() const { return fireCount; }
+    unsigned long getMaxLatency() const { return maxLatency; }
+};
+
+#endif
@@ -8,13 +8,19 @@
 #include <ArduinoJson.h> 
 #include "config.h"
 #include "MqttHandler.h"
+#include "ThingModel.h"
+#include "SerialTrace.h"
+#include "PowerManager.h"
+#include "Gateway.h"
+#include "RuleEngine.h"
 #include "TIME_T.h"
 
 
 // 数据接收状态枚举
 enum DataReceiveState {
     NORMAL_MODE,      // 正常模式
-    UPLOAD_DATA_MODE  // 数据上传模式
+    UPLOAD_DATA_MODE, // 数据上传模式
+    STREAM_MODE       // 流式上传模式（微批次自动上传）
 };
 
 // 键值对数据结构
@@ -24,25 +30,82 @@ struct KeyValueData {
     bool isValid;
 };
 
+// STM32下行命令状态
+enum Stm32CommandState {
+    CMD_QUEUED,    // 等待发送（在途窗口已满）
+    CMD_IN_FLIGHT  // 已发送，等待STM32确认
+};
+
+// STM32下行命令
+struct Stm32Command {
+    uint16_t seq;              // 序号，STM32通过 ACK:序号 确认
+    String payload;            // 命令内容
+    String tag;                // 网关模式下的子设备名称，空表示发给本机STM32
+    Stm32CommandState state;
+    int retryCount;
+    unsigned long sentTime;    // 最近一次发送的时间戳
+};
+
 class SerialHandler {
 private:
     String serialBuffer;
     DataReceiveState currentState;
     std::vector<KeyValueData> dataBuffer;
     unsigned long uploadStartTime;
+    unsigned long batchStartTime;  // 流式模式下当前批次第一条样本的时间戳
+    size_t batchBytes;             // 流式模式下当前批次的JSON字节估算
     MqttHandler* mqttHandler;  // MQTT处理器引用
+    PowerManager* powerManager;  // 低功耗管理器引用（STATUS中输出功耗统计）
+    Gateway* gateway;            // 网关引用（GATEWAY_MODE为0时为空）
+    RuleEngine* ruleEngine;      // 本地规则引用（RULE_ENGINE_ENABLE为0时为空）
+    ThingProperties sample;      // 最近一次通过验证的样本，供本地规则求值
+    ThingPropertyId sampleId;
+    std::vector<Stm32Command> commandQueue; // STM32命令队列（含在途命令）
+    uint16_t nextCommandSeq;
+
+    // 流控状态与统计
+    bool flowPaused;                 // 是否已通知STM32暂停发送
+    bool flowBufferIgnored;          // 暂停超时后数据缓冲区与发送队列不参与流控，回落到低水位后恢复
+    unsigned long flowPauseStart;    // 本次暂停开始时间
+    unsigned long flowPauseCount;    // 暂停次数
+    unsigned long droppedLineCount;  // 因缓冲区溢出/已满丢弃的数据行数
+
+    // 串口接收统计
+    unsigned long rxByteCount;       // 已接收字节数
+    unsigned long rxOverrunCount;    // 接收环形缓冲区溢出次数（数据已丢失）
+    unsigned long rxErrorCount;      // UART硬件FIFO溢出/帧错误次数
+    SerialTrace trace;               // 接收抓包与解析统计
     
     // 数据处理函数
+    void processLine(const String& line);
+    void processTaggedLine(const String& line);
+    void checkRxErrors();
     bool validateKeyValueFormat(const String& data, String& key, String& value, char& separator);
     void processUploadDataCommand();
     void processKeyValueData(const String& data);
     void processEndCommand();
     void processCancelCommand();
+    void processStreamCommand();
+    void processStreamData(const String& data);
+    void processStopStreamCommand();
+    bool publishDataBuffer(bool queued);
+    void checkUploadTimers();
+    bool flushStreamBatch();
+
+    // 串口流控
+    int getRxLevel() const;
+    int getBufferLevel() const;
+    // 驱动流控的填充率，STATUS中的Fill与之一致
+    int getFillLevel() const;
+    void setFlowPaused(bool paused);
     void clearDataBuffer();
+    void collectProperties(ThingProperties& props) const;
     String generateJsonPayload() const;
 
-    bool isInteger(const String& value) const;
-    bool isFloat(const String& value) const;
+    // STM32命令通道
+    void processCommandQueue();
+    void writeCommandFrame(Stm32Command& cmd, String& frames);
+    bool processAckLine(const String& line);
 
 public:
 
@@ -52,6 +115,8 @@ public:
     void init();
     // 读取串口数据
     void readSerialData();//在void loop()中调用
+    // 周期性处理（命令确认超时重发、流式批次与上传超时），在void loop()中调用
+    void update();
     // 处理串口命令
     void processSerialCommand(String command);
     // 检查WiFi连接状态
@@ -62,12 +127,38 @@ public:
     size_t getDataBufferCount() const { return dataBuffer.size(); }
     // 设置MQTT处理器引用
     void setMqttHandler(MqttHandler* handler) { mqttHandler = handler; }
+    // 设置低功耗管理器引用
+    void setPowerManager(PowerManager* manager) { powerManager = manager; }
+    // 设置网关引用，"@子设备名 ..." 形式的行交给网关处理
+    void setGateway(Gateway* handler) { gateway = handler; }
+    // 设置本地规则引用，每个通过验证的样本立即求值
+    void setRuleEngine(RuleEngine* engine) { ruleEngine = engine; }
+    // 距下一个定时事件（批次上传、上传超时、命令确认超时）的时间(ms)
+    unsigned long getNextDeadlineIn(unsigned long now) const;
+    // 是否有需要立即继续处理的数据（不完整的行、流控暂停中、STM32命令未确认）
+    // 等待确认期间不能进入light sleep：唤醒时串口的第一个字节可能丢失，确认行会被破坏
+    bool hasPendingWork() const { return serialBuffer.length() > 0 || flowPaused || !commandQueue.empty(); }
+    unsigned long getRxByteCount() const { return rxByteCount; }
     //检查是否有待上传的数据
     bool hasDataToUpload() const { return dataBuffer.size() > 0; }
     //获取JSON格式的数据负载
     String getJsonPayload() const { return generateJsonPayload(); }
     //清除已上传的数据
     void clearUploadedData() { clearDataBuffer(); }
+    //发送命令给STM32，返回命令序号（0表示队列已满）
+    //flush为false时只入队，由flushStm32Commands()统一发送；tag非空时发给对应的子设备
+    uint16_t sendStm32Command(const String& payload, bool flush = true, const char* tag = nullptr);
+    //发送所有排队中的命令（受在途窗口限制）
+    void flushStm32Commands() { processCommandQueue(); }
+    //按当前填充率更新流控状态（可在阻塞等待期间调用）
+    void updateFlowControl();
+    //流控状态与丢弃统计
+    bool isFlowPaused() const { return flowPaused; }
+    unsigned long getFlowPauseCount() const { return flowPauseCount; }
+    unsigned long getDroppedLineCount() const { return droppedLineCount; }
+    unsigned long getRxOverrunCount() const { return rxOverrunCount; }
+    //获取未完成（排队或等待确认）的STM32命令数量
+    size_t getPendingCommandCount() const { return commandQueue.size(); }
 };
 
 #endif
@@ -0,0 +1,57 @@
+#ifndef SERIAL_TRACE_H
+#define SERIAL_TRACE_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+
+// 串口接收抓包与解析统计
+// 抓包：TRACE_START后把收到的原始字节连同时间戳记录到RAM，TRACE_DUMP以十六进制从日志串口输出，
+//      由 tools/serial_replay.py 还原为trace文件并在实验室回放
+// 记录格式：[距上一条的毫秒数 varint][字节数 varint][原始字节]
+class SerialTrace {
+private:
+    std::vector<uint8_t> buffer;   // 抓包数据，TRACE_START时分配
+    bool active;
+    unsigned long lastRecordTime;
+    unsigned long recordCount;
+    unsigned long lostBytes;       // 缓冲区已满未能记录的字节数
+
+    // 解析统计（每行processLine的耗时与内存分配次数）
+    unsigned long lineCount;
+    unsigned long lineBytes;
+    unsigned long totalMicros;
+    unsigned long maxMicros;
+    unsigned long allocCount;
+    uint32_t minFreeHeap;
+    unsigned long lineStartMicros;
+    uint32_t lineStartAllocs;
+    bool skipLine;                 // 统计在行处理中被清零，本行不计入
+
+    void writeVarint(uint32_t value);
+
+public:
+    SerialTrace();
+    // 开始抓包（清空上次的数据）
+    void start();
+    // 停止抓包，已记录的数据保留到下次start()
+    void stop();
+    bool isActive() const { return active; }
+    // 记录一段收到的原始字节
+    void record(const char* data, size_t length);
+    // 以 TRACE_BEGIN / TRACE:十六进制 / TRACE_END 行输出抓包数据
+    void dump() const;
+
+    // 在processLine前后调用，统计每行的解析耗时与内存分配次数
+    void lineStart();
+    void lineEnd(size_t bytes);
+    // 输出/清零解析统计
+    void printStats() const;
+    void resetStats();
+};
+
+// 内存分配计数，需在编译时定义TRACE_ALLOC_COUNT并用--wrap链接malloc/realloc/calloc
+// （见platformio.ini中的esp12e_trace环境），否则恒为0
+uint32_t serialTraceAllocCount();
+
+#endif
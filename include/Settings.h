@@ -0,0 +1,63 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// 运行参数编号：保存在Flash中的记录按编号存储，只能在末尾追加，不能调整顺序或复用
+enum SettingId : uint8_t {
+    CFG_MAX_QUEUE_SIZE,          // 消息重传队列条数上限
+    CFG_MAX_RETRY_COUNT,         // 队列消息最大重试次数
+    CFG_MQTT_RETRY_DELAY,        // 队列消息发布失败后的重试间隔(ms)
+    CFG_MAX_DATA_BUFFER_SIZE,    // 串口数据缓冲区条数上限
+    CFG_MAX_MESSAGE_LENGTH,      // 下行消息日志截断长度
+    CFG_STREAM_BATCH_MAX_BYTES,
+    CFG_STREAM_BATCH_MAX_SAMPLES,
+    CFG_STREAM_BATCH_MAX_LATENCY,
+    CFG_UPLOAD_DATA_TIMEOUT,
+    CFG_TELEMETRY_QUEUE_BYTES,
+    CFG_TELEMETRY_DRAIN_PER_LOOP,
+    CFG_MQTT_QOS1_WINDOW,
+    CFG_STM32_CMD_TIMEOUT,
+    CFG_HEARTBEAT_INTERVAL,
+    SETTING_COUNT
+};
+
+// 运行参数描述：名称与config.h中作为默认值的宏同名
+struct SettingInfo {
+    const char* key;
+    int32_t defaultValue;
+    int32_t minValue;
+    int32_t maxValue;
+};
+
+// 运行参数注册表：config.h中的宏为默认值，可通过串口SET指令或属性Set_Config修改，
+// 修改立即生效并保存到Flash（紧接在属性影子之后的SETTINGS_EEPROM_SIZE字节）
+//
+// 存储格式: [标记 2B][版本 1B][条数 1B] 条数×[编号 1B][值 int32 4B] [CRC16 2B]
+// 只保存与默认值不同的参数，升级固件后未修改过的参数跟随新的默认值
+class Settings {
+public:
+    // 从Flash载入，在setup中其他模块初始化之前调用
+    static void begin();
+    static int32_t get(SettingId id) { return values[id]; }
+    // 超出范围时返回false，不修改
+    static bool set(SettingId id, int32_t value);
+    // 按名称查找（不区分大小写），未找到时返回SETTING_COUNT
+    static SettingId find(const char* key);
+    static const SettingInfo& info(SettingId id);
+    // 解析 "KEY=值[,KEY=值...]"（也可用 ';' 分隔），全部有效时才应用并保存；message为结果说明
+    static bool assign(const String& text, String& message);
+    // 恢复全部默认值并保存
+    static void resetDefaults();
+    // 保存到Flash，内容没有变化时不擦写
+    static bool save();
+    // 参数修改后的通知（用于窗口大小等需要主动应用的参数）
+    static void setChangeCallback(void (*callback)(SettingId id)) { changeCallback = callback; }
+
+private:
+    static int32_t values[SETTING_COUNT];
+    static void (*changeCallback)(SettingId id);
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef TELEMETRY_QUEUE_H
+#define TELEMETRY_QUEUE_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+#include "ThingModel.h"
+#include "Settings.h"
+
+// 离线属性上报队列：排队期间以紧凑记录保存，发送时才展开为OneNET JSON
+//
+// 记录格式（按入队顺序连续存放）：
+//   [present位图 varint，宽度与ThingProperties::present一致] 之后按属性编号依次为每个已赋值属性写入：
+//   - 字符串：[长度 varint][UTF-8字节]
+//   - 其他：与该属性上一次入队值之差，zigzag varint（浮点数先按步长缩放为整数，布尔为0/1）
+// 差值相对于队列中前一条含该属性的记录，因此只能从队首依次解码；
+// 入队与出队两端各保存一份每个属性的上一次取值
+class TelemetryQueue {
+private:
+    std::vector<uint8_t> buffer;
+    size_t head;                     // 队首记录在buffer中的位置
+    size_t recordCount;
+    int32_t encodeBase[TP_COUNT];    // 最近入队的各属性取值
+    int32_t decodeBase[TP_COUNT];    // 最近出队的各属性取值
+    int32_t peekBase[TP_COUNT];      // peek解码后、pop时生效的取值
+    size_t peekLength;               // peek解码的记录长度，0表示尚未peek
+    std::vector<uint8_t> scratch;    // 编码缓冲，重复使用
+    size_t maxRecordLength;          // 出现过的最长记录，用于判断队列是否已满
+
+    unsigned long droppedCount;      // 队列已满时丢弃的记录数
+    unsigned long encodedBytes;      // 已发送记录的紧凑格式字节数
+    unsigned long expandedBytes;     // 已发送记录展开后的JSON字节数
+
+public:
+    TelemetryQueue();
+
+    // 编码并入队，空间不足时丢弃并返回false
+    bool push(const ThingProperties& props);
+    // 解码队首记录（不出队），队列为空或记录损坏时返回false
+    bool peek(ThingProperties& props);
+    // 队首记录出队，expandedLength为其展开后的JSON长度，用于统计压缩比
+    void pop(size_t expandedLength);
+    void clear();
+
+    bool empty() const { return recordCount == 0; }
+    size_t size() const { return recordCount; }
+    size_t getBytes() const { return buffer.size() - head; }
+    size_t getCapacity() const { return Settings::get(CFG_TELEMETRY_QUEUE_BYTES); }
+    // 剩余空间不足以容纳最长的一条记录
+    bool isFull() const { return getBytes() + maxRecordLength > getCapacity(); }
+    unsigned long getDroppedCount() const { return droppedCount; }
+    // 展开后JSON与紧凑格式的字节数之比（x10），尚无发送记录时为0
+    unsigned long getRatioX10() const { return encodedBytes > 0 ? expandedBytes * 10 / encodedBytes : 0; }
+};
+
+#endif
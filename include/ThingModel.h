@@ -0,0 +1,898 @@
+// 自动生成文件，请勿手动修改
+// 来源: model/thing_model.json
+// 生成: tools/gen_thing_model.py（编译前由PlatformIO自动运行）
+#ifndef THING_MODEL_H
+#define THING_MODEL_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// 物模型属性值类型
+enum ThingValueType : uint8_t {
+    TM_BOOL,
+    TM_INT,
+    TM_FLOAT,
+    TM_STRING
+};
+
+// 物模型属性编号
+enum ThingPropertyId : uint8_t {
+    TP_temperature, // 温度
+    TP_humidity, // 湿度
+    TP_LED, // LED灯
+    TP_Switch, // 开关
+    TP_Upload_Data, // 触发上传
+    TP_Command, // 命令
+    TP_Control, // 控制
+    TP_Set_Threshold, // 阈值
+    TP_Set_Threshold_Float, // 浮点阈值
+    TP_Set_Temperature, // 温度阈值
+    TP_Set_Humidity, // 湿度阈值
+    TP_Set_Config, // 运行参数
+    TP_Pub_Count, // 发布次数
+    TP_Pub_Fail, // 发布失败次数
+    TP_Queue_Depth, // 队列深度
+    TP_Drop_Count, // 丢弃次数
+    TP_Reconnects, // 重连次数
+    TP_Heap_Min, // 最低空闲堆
+    TP_RSSI, // 信号强度
+    TP_Loop_Time, // 最长循环耗时
+    TP_COUNT
+};
+
+// 属性标识符
+namespace ThingKey {
+    constexpr char temperature[] = "temperature";
+    constexpr char humidity[] = "humidity";
+    constexpr char LED[] = "LED";
+    constexpr char Switch[] = "Switch";
+    constexpr char Upload_Data[] = "Upload_Data";
+    constexpr char Command[] = "Command";
+    constexpr char Control[] = "Control";
+    constexpr char Set_Threshold[] = "Set_Threshold";
+    constexpr char Set_Threshold_Float[] = "Set_Threshold_Float";
+    constexpr char Set_Temperature[] = "Set_Temperature";
+    constexpr char Set_Humidity[] = "Set_Humidity";
+    constexpr char Set_Config[] = "Set_Config";
+    constexpr char Pub_Count[] = "Pub_Count";
+    constexpr char Pub_Fail[] = "Pub_Fail";
+    constexpr char Queue_Depth[] = "Queue_Depth";
+    constexpr char Drop_Count[] = "Drop_Count";
+    constexpr char Reconnects[] = "Reconnects";
+    constexpr char Heap_Min[] = "Heap_Min";
+    constexpr char RSSI[] = "RSSI";
+    constexpr char Loop_Time[] = "Loop_Time";
+}
+
+// 物模型属性描述
+struct ThingPropertyInfo {
+    const char* key;
+    ThingValueType type;
+    bool writable;     // 是否允许云端设置
+    uint8_t decimals;  // 浮点数按步长保留的小数位数
+};
+
+static const ThingPropertyInfo THING_PROPERTIES[TP_COUNT] = {
+    {ThingKey::temperature, TM_FLOAT, false, 1},
+    {ThingKey::humidity, TM_FLOAT, false, 1},
+    {ThingKey::LED, TM_BOOL, true, 0},
+    {ThingKey::Switch, TM_BOOL, true, 0},
+    {ThingKey::Upload_Data, TM_STRING, true, 0},
+    {ThingKey::Command, TM_STRING, true, 0},
+    {ThingKey::Control, TM_STRING, true, 0},
+    {ThingKey::Set_Threshold, TM_INT, true, 0},
+    {ThingKey::Set_Threshold_Float, TM_FLOAT, true, 2},
+    {ThingKey::Set_Temperature, TM_FLOAT, true, 1},
+    {ThingKey::Set_Humidity, TM_FLOAT, true, 1},
+    {ThingKey::Set_Config, TM_STRING, true, 0},
+    {ThingKey::Pub_Count, TM_INT, false, 0},
+    {ThingKey::Pub_Fail, TM_INT, false, 0},
+    {ThingKey::Queue_Depth, TM_INT, false, 0},
+    {ThingKey::Drop_Count, TM_INT, false, 0},
+    {ThingKey::Reconnects, TM_INT, false, 0},
+    {ThingKey::Heap_Min, TM_INT, false, 0},
+    {ThingKey::RSSI, TM_INT, false, 0},
+    {ThingKey::Loop_Time, TM_INT, false, 0},
+};
+
+constexpr size_t THING_WRITABLE_COUNT = 10;
+// 属性设置JSON容量: {"id","version","params":{...}}，按零拷贝方式解析
+constexpr size_t THING_SET_JSON_CAPACITY =
+    JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(THING_WRITABLE_COUNT);
+
+// 物模型属性值，present位图标记已赋值的属性
+struct ThingProperties {
+    uint32_t present;
+    float temperature;
+    float humidity;
+    bool LED;
+    bool Switch;
+    String Upload_Data;
+    String Command;
+    String Control;
+    int32_t Set_Threshold;
+    float Set_Threshold_Float;
+    float Set_Temperature;
+    float Set_Humidity;
+    String Set_Config;
+    int32_t Pub_Count;
+    int32_t Pub_Fail;
+    int32_t Queue_Depth;
+    int32_t Drop_Count;
+    int32_t Reconnects;
+    int32_t Heap_Min;
+    int32_t RSSI;
+    int32_t Loop_Time;
+
+    ThingProperties() : present(0), temperature(0), humidity(0), LED(false), Switch(false), Set_Threshold(0), Set_Threshold_Float(0), Set_Temperature(0), Set_Humidity(0), Pub_Count(0), Pub_Fail(0), Queue_Depth(0), Drop_Count(0), Reconnects(0), Heap_Min(0), RSSI(0), Loop_Time(0) {}
+    bool has(ThingPropertyId id) const { return (present & ((uint32_t)1UL << id)) != 0; }
+    void mark(ThingPropertyId id) { present |= (uint32_t)1UL << id; }
+    void clear() { present = 0; }
+    bool empty() const { return present == 0; }
+};
+
+// 按步长保留小数位，避免平台校验步长失败
+inline double thingRound(double value, uint8_t decimals) {
+    double scale = 1.0;
+    for (uint8_t i = 0; i < decimals; i++) {
+        scale *= 10.0;
+    }
+    return lround(value * scale) / scale;
+}
+
+// 浮点数按步长缩放为整数（与thingRound取整一致），NaN/无穷大记为THING_SCALED_NULL
+constexpr int32_t THING_SCALED_NULL = INT32_MIN;
+inline int32_t thingScaleFloat(float value, uint8_t decimals) {
+    if (isnan(value) || isinf(value)) {
+        return THING_SCALED_NULL;
+    }
+    double scale = 1.0;
+    for (uint8_t i = 0; i < decimals; i++) {
+        scale *= 10.0;
+    }
+    return (int32_t)lround(value * scale);
+}
+
+inline float thingUnscaleFloat(int32_t value, uint8_t decimals) {
+    if (value == THING_SCALED_NULL) {
+        return NAN;
+    }
+    double scale = 1.0;
+    for (uint8_t i = 0; i < decimals; i++) {
+        scale *= 10.0;
+    }
+    return (float)(value / scale);
+}
+
+// 按标识符查找属性，未找到时返回TP_COUNT
+inline ThingPropertyId thingFindProperty(const char* key) {
+    if (strcmp(key, ThingKey::temperature) == 0) return TP_temperature;
+    if (strcmp(key, ThingKey::humidity) == 0) return TP_humidity;
+    if (strcmp(key, ThingKey::LED) == 0) return TP_LED;
+    if (strcmp(key, ThingKey::Switch) == 0) return TP_Switch;
+    if (strcmp(key, ThingKey::Upload_Data) == 0) return TP_Upload_Data;
+    if (strcmp(key, ThingKey::Command) == 0) return TP_Command;
+    if (strcmp(key, ThingKey::Control) == 0) return TP_Control;
+    if (strcmp(key, ThingKey::Set_Threshold) == 0) return TP_Set_Threshold;
+    if (strcmp(key, ThingKey::Set_Threshold_Float) == 0) return TP_Set_Threshold_Float;
+    if (strcmp(key, ThingKey::Set_Temperature) == 0) return TP_Set_Temperature;
+    if (strcmp(key, ThingKey::Set_Humidity) == 0) return TP_Set_Humidity;
+    if (strcmp(key, ThingKey::Set_Config) == 0) return TP_Set_Config;
+    if (strcmp(key, ThingKey::Pub_Count) == 0) return TP_Pub_Count;
+    if (strcmp(key, ThingKey::Pub_Fail) == 0) return TP_Pub_Fail;
+    if (strcmp(key, ThingKey::Queue_Depth) == 0) return TP_Queue_Depth;
+    if (strcmp(key, ThingKey::Drop_Count) == 0) return TP_Drop_Count;
+    if (strcmp(key, ThingKey::Reconnects) == 0) return TP_Reconnects;
+    if (strcmp(key, ThingKey::Heap_Min) == 0) return TP_Heap_Min;
+    if (strcmp(key, ThingKey::RSSI) == 0) return TP_RSSI;
+    if (strcmp(key, ThingKey::Loop_Time) == 0) return TP_Loop_Time;
+    return TP_COUNT;
+}
+
+// 读取云端下发的属性值（类型、范围与可写性校验）
+// 返回结果码: 200成功，400类型或范围不符，403只读，404未定义
+inline int thingReadValue(ThingProperties& props, ThingPropertyId id, JsonVariantConst value) {
+    switch (id) {
+        case TP_temperature: {
+            return 403;
+        }
+        case TP_humidity: {
+            return 403;
+        }
+        case TP_LED: {
+            if (value.is<bool>()) {
+                props.LED = value.as<bool>();
+            } else if (value.is<int>() && (value.as<int>() == 0 || value.as<int>() == 1)) {
+                props.LED = value.as<int>() == 1;
+            } else {
+                return 400;
+            }
+            break;
+        }
+        case TP_Switch: {
+            if (value.is<bool>()) {
+                props.Switch = value.as<bool>();
+            } else if (value.is<int>() && (value.as<int>() == 0 || value.as<int>() == 1)) {
+                props.Switch = value.as<int>() == 1;
+            } else {
+                return 400;
+            }
+            break;
+        }
+        case TP_Upload_Data: {
+            if (!value.is<const char*>()) return 400;
+            const char* v = value.as<const char*>();
+            if (strlen(v) > 32) return 400;
+            props.Upload_Data = v;
+            break;
+        }
+        case TP_Command: {
+            if (!value.is<const char*>()) return 400;
+            const char* v = value.as<const char*>();
+            if (strlen(v) > 64) return 400;
+            props.Command = v;
+            break;
+        }
+        case TP_Control: {
+            if (!value.is<const char*>()) return 400;
+            const char* v = value.as<const char*>();
+            if (strlen(v) > 64) return 400;
+            props.Control = v;
+            break;
+        }
+        case TP_Set_Threshold: {
+            if (!value.is<int32_t>()) return 400;
+            int32_t v = value.as<int32_t>();
+            if (v < 0 || v > 100000) return 400;
+            props.Set_Threshold = v;
+            break;
+        }
+        case TP_Set_Threshold_Float: {
+            if (!value.is<float>()) return 400;
+            float v = value.as<float>();
+            if (v < -1000.0f || v > 1000.0f) return 400;
+            props.Set_Threshold_Float = v;
+            break;
+        }
+        case TP_Set_Temperature: {
+            if (!value.is<float>()) return 400;
+            float v = value.as<float>();
+            if (v < -40.0f || v > 125.0f) return 400;
+            props.Set_Temperature = v;
+            break;
+        }
+        case TP_Set_Humidity: {
+            if (!value.is<float>()) return 400;
+            float v = value.as<float>();
+            if (v < 0.0f || v > 100.0f) return 400;
+            props.Set_Humidity = v;
+            break;
+        }
+        case TP_Set_Config: {
+            if (!value.is<const char*>()) return 400;
+            const char* v = value.as<const char*>();
+            if (strlen(v) > 128) return 400;
+            props.Set_Config = v;
+            break;
+        }
+        case TP_Pub_Count: {
+            return 403;
+        }
+        case TP_Pub_Fail: {
+            return 403;
+        }
+        case TP_Queue_Depth: {
+            return 403;
+        }
+        case TP_Drop_Count: {
+            return 403;
+        }
+        case TP_Reconnects: {
+            return 403;
+        }
+        case TP_Heap_Min: {
+            return 403;
+        }
+        case TP_RSSI: {
+            return 403;
+        }
+        case TP_Loop_Time: {
+            return 403;
+        }
+        default:
+            return 404;
+    }
+    props.mark(id);
+    return 200;
+}
+
+// 解析串口文本形式的属性值（key=value中的value），格式或范围不符时返回false
+inline bool thingParseText(ThingProperties& props, ThingPropertyId id, const char* text) {
+    char* end = nullptr;
+    switch (id) {
+        case TP_temperature: {
+            float v = strtof(text, &end);
+            if (end == text || *end != '\0') return false;
+            if (v < -40.0f || v > 125.0f) return false;
+            props.temperature = v;
+            break;
+        }
+        case TP_humidity: {
+            float v = strtof(text, &end);
+            if (end == text || *end != '\0') return false;
+            if (v < 0.0f || v > 100.0f) return false;
+            props.humidity = v;
+            break;
+        }
+        case TP_LED: {
+            if (strcmp(text, "1") == 0 || strcasecmp(text, "true") == 0 || strcasecmp(text, "on") == 0) {
+                props.LED = true;
+            } else if (strcmp(text, "0") == 0 || strcasecmp(text, "false") == 0 || strcasecmp(text, "off") == 0) {
+                props.LED = false;
+            } else {
+                return false;
+            }
+            break;
+        }
+        case TP_Switch: {
+            if (strcmp(text, "1") == 0 || strcasecmp(text, "true") == 0 || strcasecmp(text, "on") == 0) {
+                props.Switch = true;
+            } else if (strcmp(text, "0") == 0 || strcasecmp(text, "false") == 0 || strcasecmp(text, "off") == 0) {
+                props.Switch = false;
+            } else {
+                return false;
+            }
+            break;
+        }
+        case TP_Upload_Data: {
+            if (strlen(text) > 32) return false;
+            props.Upload_Data = text;
+            break;
+        }
+        case TP_Command: {
+            if (strlen(text) > 64) return false;
+            props.Command = text;
+            break;
+        }
+        case TP_Control: {
+            if (strlen(text) > 64) return false;
+            props.Control = text;
+            break;
+        }
+        case TP_Set_Threshold: {
+            long v = strtol(text, &end, 10);
+            if (end == text || *end != '\0') return false;
+            if (v < 0 || v > 100000) return false;
+            props.Set_Threshold = (int32_t)v;
+            break;
+        }
+        case TP_Set_Threshold_Float: {
+            float v = strtof(text, &end);
+            if (end == text || *end != '\0') return false;
+            if (v < -1000.0f || v > 1000.0f) return false;
+            props.Set_Threshold_Float = v;
+            break;
+        }
+        case TP_Set_Temperature: {
+            float v = strtof(text, &end);
+            if (end == text || *end != '\0') return false;
+            if (v < -40.0f || v > 125.0f) return false;
+            props.Set_Temperature = v;
+            break;
+        }
+        case TP_Set_Humidity: {
+            float v = strtof(text, &end);
+            if (end == text || *end != '\0') return false;
+            if (v < 0.0f || v > 100.0f) return false;
+            props.Set_Humidity = v;
+            break;
+        }
+        case TP_Set_Config: {
+            if (strlen(text) > 128) return false;
+            props.Set_Config = text;
+            break;
+        }
+        case TP_Pub_Count: {
+            long v = strtol(text, &end, 10);
+            if (end == text || *end != '\0') return false;
+            if (v < 0 || v > 2147483647) return false;
+            props.Pub_Count = (int32_t)v;
+            break;
+        }
+        case TP_Pub_Fail: {
+            long v = strtol(text, &end, 10);
+            if (end == text || *end != '\0') return false;
+            if (v < 0 || v > 2147483647) return false;
+            props.Pub_Fail = (int32_t)v;
+            break;
+        }
+        case TP_Queue_Depth: {
+            long v = strtol(text, &end, 10);
+            if (end == text || *end != '\0') return false;
+            if (v < 0 || v > 1000) return false;
+            props.Queue_Depth = (int32_t)v;
+            break;
+        }
+        case TP_Drop_Count: {
+            long v = strtol(text, &end, 10);
+            if (end == text || *end != '\0') return false;
+            if (v < 0 || v > 2147483647) return false;
+            props.Drop_Count = (int32_t)v;
+            break;
+        }
+        case TP_Reconnects: {
+            long v = strtol(text, &end, 10);
+            if (end == text || *end != '\0') return false;
+            if (v < 0 || v > 2147483647) return false;
+            props.Reconnects = (int32_t)v;
+            break;
+        }
+        case TP_Heap_Min: {
+            long v = strtol(text, &end, 10);
+            if (end == text || *end != '\0') return false;
+            if (v < 0 || v > 2147483647) return false;
+            props.Heap_Min = (int32_t)v;
+            break;
+        }
+        case TP_RSSI: {
+            long v = strtol(text, &end, 10);
+            if (end == text || *end != '\0') return false;
+            if (v < -120 || v > 0) return false;
+            props.RSSI = (int32_t)v;
+            break;
+        }
+        case TP_Loop_Time: {
+            long v = strtol(text, &end, 10);
+            if (end == text || *end != '\0') return false;
+            if (v < 0 || v > 2147483647) return false;
+            props.Loop_Time = (int32_t)v;
+            break;
+        }
+        default:
+            return false;
+    }
+    props.mark(id);
+    return true;
+}
+
+// 将属性值写入obj[key]（浮点数按步长取整，字符串按指针引用）
+inline void thingWriteValue(JsonObject obj, const char* key, const ThingProperties& props, ThingPropertyId id) {
+    switch (id) {
+        case TP_temperature:
+            obj[key] = thingRound(props.temperature, 1);
+            break;
+        case TP_humidity:
+            obj[key] = thingRound(props.humidity, 1);
+            break;
+        case TP_LED:
+            obj[key] = props.LED;
+            break;
+        case TP_Switch:
+            obj[key] = props.Switch;
+            break;
+        case TP_Upload_Data:
+            obj[key] = props.Upload_Data.c_str();
+            break;
+        case TP_Command:
+            obj[key] = props.Command.c_str();
+            break;
+        case TP_Control:
+            obj[key] = props.Control.c_str();
+            break;
+        case TP_Set_Threshold:
+            obj[key] = props.Set_Threshold;
+            break;
+        case TP_Set_Threshold_Float:
+            obj[key] = thingRound(props.Set_Threshold_Float, 2);
+            break;
+        case TP_Set_Temperature:
+            obj[key] = thingRound(props.Set_Temperature, 1);
+            break;
+        case TP_Set_Humidity:
+            obj[key] = thingRound(props.Set_Humidity, 1);
+            break;
+        case TP_Set_Config:
+            obj[key] = props.Set_Config.c_str();
+            break;
+        case TP_Pub_Count:
+            obj[key] = props.Pub_Count;
+            break;
+        case TP_Pub_Fail:
+            obj[key] = props.Pub_Fail;
+            break;
+        case TP_Queue_Depth:
+            obj[key] = props.Queue_Depth;
+            break;
+        case TP_Drop_Count:
+            obj[key] = props.Drop_Count;
+            break;
+        case TP_Reconnects:
+            obj[key] = props.Reconnects;
+            break;
+        case TP_Heap_Min:
+            obj[key] = props.Heap_Min;
+            break;
+        case TP_RSSI:
+            obj[key] = props.RSSI;
+            break;
+        case TP_Loop_Time:
+            obj[key] = props.Loop_Time;
+            break;
+        default:
+            break;
+    }
+}
+
+// 复制单个属性值（含present标记）
+inline void thingCopyValue(ThingProperties& dst, const ThingProperties& src, ThingPropertyId id) {
+    switch (id) {
+        case TP_temperature:
+            dst.temperature = src.temperature;
+            break;
+        case TP_humidity:
+            dst.humidity = src.humidity;
+            break;
+        case TP_LED:
+            dst.LED = src.LED;
+            break;
+        case TP_Switch:
+            dst.Switch = src.Switch;
+            break;
+        case TP_Upload_Data:
+            dst.Upload_Data = src.Upload_Data;
+            break;
+        case TP_Command:
+            dst.Command = src.Command;
+            break;
+        case TP_Control:
+            dst.Control = src.Control;
+            break;
+        case TP_Set_Threshold:
+            dst.Set_Threshold = src.Set_Threshold;
+            break;
+        case TP_Set_Threshold_Float:
+            dst.Set_Threshold_Float = src.Set_Threshold_Float;
+            break;
+        case TP_Set_Temperature:
+            dst.Set_Temperature = src.Set_Temperature;
+            break;
+        case TP_Set_Humidity:
+            dst.Set_Humidity = src.Set_Humidity;
+            break;
+        case TP_Set_Config:
+            dst.Set_Config = src.Set_Config;
+            break;
+        case TP_Pub_Count:
+            dst.Pub_Count = src.Pub_Count;
+            break;
+        case TP_Pub_Fail:
+            dst.Pub_Fail = src.Pub_Fail;
+            break;
+        case TP_Queue_Depth:
+            dst.Queue_Depth = src.Queue_Depth;
+            break;
+        case TP_Drop_Count:
+            dst.Drop_Count = src.Drop_Count;
+            break;
+        case TP_Reconnects:
+            dst.Reconnects = src.Reconnects;
+            break;
+        case TP_Heap_Min:
+            dst.Heap_Min = src.Heap_Min;
+            break;
+        case TP_RSSI:
+            dst.RSSI = src.RSSI;
+            break;
+        case TP_Loop_Time:
+            dst.Loop_Time = src.Loop_Time;
+            break;
+        default:
+            return;
+    }
+    if (src.has(id)) {
+        dst.mark(id);
+    }
+}
+
+// 设置整数属性的值（用于运行指标等设备侧生成的属性），非整数属性返回false
+inline bool thingSetInt(ThingProperties& props, ThingPropertyId id, int32_t value) {
+    switch (id) {
+        case TP_Set_Threshold:
+            props.Set_Threshold = value;
+            break;
+        case TP_Pub_Count:
+            props.Pub_Count = value;
+            break;
+        case TP_Pub_Fail:
+            props.Pub_Fail = value;
+            break;
+        case TP_Queue_Depth:
+            props.Queue_Depth = value;
+            break;
+        case TP_Drop_Count:
+            props.Drop_Count = value;
+            break;
+        case TP_Reconnects:
+            props.Reconnects = value;
+            break;
+        case TP_Heap_Min:
+            props.Heap_Min = value;
+            break;
+        case TP_RSSI:
+            props.RSSI = value;
+            break;
+        case TP_Loop_Time:
+            props.Loop_Time = value;
+            break;
+        default:
+            return false;
+    }
+    props.mark(id);
+    return true;
+}
+
+// 追加JSON字符串（带引号和必要的转义）
+inline void thingAppendJsonString(String& out, const char* str) {
+    out += '"';
+    for (const char* p = str; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            out += '\\';
+            out += *p;
+        } else if ((uint8_t)*p < 0x20) {
+            char escaped[7];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (uint8_t)*p);
+            out += escaped;
+        } else {
+            out += *p;
+        }
+    }
+    out += '"';
+}
+
+// 追加浮点数，按步长保留小数位；NaN与无穷大写为null（与ArduinoJson一致）
+inline void thingAppendFloat(String& out, float value, uint8_t decimals) {
+    if (isnan(value) || isinf(value)) {
+        out += F("null");
+        return;
+    }
+    char buffer[48];
+    dtostrf(value, 1, decimals, buffer);
+    out += buffer;
+}
+
+// 追加属性值的JSON表示
+inline void thingAppendValue(String& out, const ThingProperties& props, ThingPropertyId id) {
+    char buffer[12];
+    switch (id) {
+        case TP_temperature:
+            thingAppendFloat(out, props.temperature, 1);
+            break;
+        case TP_humidity:
+            thingAppendFloat(out, props.humidity, 1);
+            break;
+        case TP_LED:
+            out += props.LED ? F("true") : F("false");
+            break;
+        case TP_Switch:
+            out += props.Switch ? F("true") : F("false");
+            break;
+        case TP_Upload_Data:
+            thingAppendJsonString(out, props.Upload_Data.c_str());
+            break;
+        case TP_Command:
+            thingAppendJsonString(out, props.Command.c_str());
+            break;
+        case TP_Control:
+            thingAppendJsonString(out, props.Control.c_str());
+            break;
+        case TP_Set_Threshold:
+            out += ltoa(props.Set_Threshold, buffer, 10);
+            break;
+        case TP_Set_Threshold_Float:
+            thingAppendFloat(out, props.Set_Threshold_Float, 2);
+            break;
+        case TP_Set_Temperature:
+            thingAppendFloat(out, props.Set_Temperature, 1);
+            break;
+        case TP_Set_Humidity:
+            thingAppendFloat(out, props.Set_Humidity, 1);
+            break;
+        case TP_Set_Config:
+            thingAppendJsonString(out, props.Set_Config.c_str());
+            break;
+        case TP_Pub_Count:
+            out += ltoa(props.Pub_Count, buffer, 10);
+            break;
+        case TP_Pub_Fail:
+            out += ltoa(props.Pub_Fail, buffer, 10);
+            break;
+        case TP_Queue_Depth:
+            out += ltoa(props.Queue_Depth, buffer, 10);
+            break;
+        case TP_Drop_Count:
+            out += ltoa(props.Drop_Count, buffer, 10);
+            break;
+        case TP_Reconnects:
+            out += ltoa(props.Reconnects, buffer, 10);
+            break;
+        case TP_Heap_Min:
+            out += ltoa(props.Heap_Min, buffer, 10);
+            break;
+        case TP_RSSI:
+            out += ltoa(props.RSSI, buffer, 10);
+            break;
+        case TP_Loop_Time:
+            out += ltoa(props.Loop_Time, buffer, 10);
+            break;
+        default:
+            out += F("null");
+            break;
+    }
+    (void)buffer;
+}
+
+// 属性上报JSON的固定部分保存在Flash中，序列化时直接拼接，不经过JsonDocument
+static const char THING_POST_HEAD[] PROGMEM = "{\"id\":";
+static const char THING_POST_VERSION[] PROGMEM = ",\"version\":\"1.0\",\"params\":{";
+static const char THING_POST_TAIL[] PROGMEM = "}}";
+static const char THING_POST_KEY_temperature[] PROGMEM = "\"temperature\":{\"value\":";
+static const char THING_POST_KEY_humidity[] PROGMEM = "\"humidity\":{\"value\":";
+static const char THING_POST_KEY_LED[] PROGMEM = "\"LED\":{\"value\":";
+static const char THING_POST_KEY_Switch[] PROGMEM = "\"Switch\":{\"value\":";
+static const char THING_POST_KEY_Upload_Data[] PROGMEM = "\"Upload_Data\":{\"value\":";
+static const char THING_POST_KEY_Command[] PROGMEM = "\"Command\":{\"value\":";
+static const char THING_POST_KEY_Control[] PROGMEM = "\"Control\":{\"value\":";
+static const char THING_POST_KEY_Set_Threshold[] PROGMEM = "\"Set_Threshold\":{\"value\":";
+static const char THING_POST_KEY_Set_Threshold_Float[] PROGMEM = "\"Set_Threshold_Float\":{\"value\":";
+static const char THING_POST_KEY_Set_Temperature[] PROGMEM = "\"Set_Temperature\":{\"value\":";
+static const char THING_POST_KEY_Set_Humidity[] PROGMEM = "\"Set_Humidity\":{\"value\":";
+static const char THING_POST_KEY_Set_Config[] PROGMEM = "\"Set_Config\":{\"value\":";
+static const char THING_POST_KEY_Pub_Count[] PROGMEM = "\"Pub_Count\":{\"value\":";
+static const char THING_POST_KEY_Pub_Fail[] PROGMEM = "\"Pub_Fail\":{\"value\":";
+static const char THING_POST_KEY_Queue_Depth[] PROGMEM = "\"Queue_Depth\":{\"value\":";
+static const char THING_POST_KEY_Drop_Count[] PROGMEM = "\"Drop_Count\":{\"value\":";
+static const char THING_POST_KEY_Reconnects[] PROGMEM = "\"Reconnects\":{\"value\":";
+static const char THING_POST_KEY_Heap_Min[] PROGMEM = "\"Heap_Min\":{\"value\":";
+static const char THING_POST_KEY_RSSI[] PROGMEM = "\"RSSI\":{\"value\":";
+static const char THING_POST_KEY_Loop_Time[] PROGMEM = "\"Loop_Time\":{\"value\":";
+static const char* const THING_POST_KEYS[TP_COUNT] PROGMEM = {
+    THING_POST_KEY_temperature,
+    THING_POST_KEY_humidity,
+    THING_POST_KEY_LED,
+    THING_POST_KEY_Switch,
+    THING_POST_KEY_Upload_Data,
+    THING_POST_KEY_Command,
+    THING_POST_KEY_Control,
+    THING_POST_KEY_Set_Threshold,
+    THING_POST_KEY_Set_Threshold_Float,
+    THING_POST_KEY_Set_Temperature,
+    THING_POST_KEY_Set_Humidity,
+    THING_POST_KEY_Set_Config,
+    THING_POST_KEY_Pub_Count,
+    THING_POST_KEY_Pub_Fail,
+    THING_POST_KEY_Queue_Depth,
+    THING_POST_KEY_Drop_Count,
+    THING_POST_KEY_Reconnects,
+    THING_POST_KEY_Heap_Min,
+    THING_POST_KEY_RSSI,
+    THING_POST_KEY_Loop_Time,
+};
+// 全部属性同时上报时的JSON长度估算（数值按常见长度计），用于预留String容量
+constexpr size_t THING_POST_MAX_LENGTH = 992;
+
+// 追加已赋值属性的 "key":{"value":v},... 部分（属性上报与网关批量上报共用）
+inline void thingAppendParams(String& out, const ThingProperties& props) {
+    bool first = true;
+    for (uint8_t i = 0; i < TP_COUNT; i++) {
+        ThingPropertyId pid = (ThingPropertyId)i;
+        if (!props.has(pid)) {
+            continue;
+        }
+        if (!first) {
+            out += ',';
+        }
+        first = false;
+        out += FPSTR((const char*)pgm_read_ptr(&THING_POST_KEYS[i]));
+        thingAppendValue(out, props, pid);
+        out += '}';
+    }
+}
+
+// 生成OneNET属性上报JSON，只包含已赋值的属性
+inline void thingSerializePost(const ThingProperties& props, const char* id, String& out) {
+    out.reserve(THING_POST_MAX_LENGTH);
+    out = FPSTR(THING_POST_HEAD);
+    thingAppendJsonString(out, id);
+    out += FPSTR(THING_POST_VERSION);
+    thingAppendParams(out, props);
+    out += FPSTR(THING_POST_TAIL);
+}
+
+// 依次访问已赋值的属性，visitor需为 bool/int32_t/float/String 各提供一个重载:
+//   void operator()(ThingPropertyId id, T value)
+template <class Visitor>
+inline void thingVisit(const ThingProperties& props, Visitor& visitor) {
+    if (props.has(TP_temperature)) visitor(TP_temperature, props.temperature);
+    if (props.has(TP_humidity)) visitor(TP_humidity, props.humidity);
+    if (props.has(TP_LED)) visitor(TP_LED, props.LED);
+    if (props.has(TP_Switch)) visitor(TP_Switch, props.Switch);
+    if (props.has(TP_Upload_Data)) visitor(TP_Upload_Data, props.Upload_Data);
+    if (props.has(TP_Command)) visitor(TP_Command, props.Command);
+    if (props.has(TP_Control)) visitor(TP_Control, props.Control);
+    if (props.has(TP_Set_Threshold)) visitor(TP_Set_Threshold, props.Set_Threshold);
+    if (props.has(TP_Set_Threshold_Float)) visitor(TP_Set_Threshold_Float, props.Set_Threshold_Float);
+    if (props.has(TP_Set_Temperature)) visitor(TP_Set_Temperature, props.Set_Temperature);
+    if (props.has(TP_Set_Humidity)) visitor(TP_Set_Humidity, props.Set_Humidity);
+    if (props.has(TP_Set_Config)) visitor(TP_Set_Config, props.Set_Config);
+    if (props.has(TP_Pub_Count)) visitor(TP_Pub_Count, props.Pub_Count);
+    if (props.has(TP_Pub_Fail)) visitor(TP_Pub_Fail, props.Pub_Fail);
+    if (props.has(TP_Queue_Depth)) visitor(TP_Queue_Depth, props.Queue_Depth);
+    if (props.has(TP_Drop_Count)) visitor(TP_Drop_Count, props.Drop_Count);
+    if (props.has(TP_Reconnects)) visitor(TP_Reconnects, props.Reconnects);
+    if (props.has(TP_Heap_Min)) visitor(TP_Heap_Min, props.Heap_Min);
+    if (props.has(TP_RSSI)) visitor(TP_RSSI, props.RSSI);
+    if (props.has(TP_Loop_Time)) visitor(TP_Loop_Time, props.Loop_Time);
+}
+
+// 非字符串属性的整数表示：整数原值，布尔为0/1，浮点数按步长缩放（供紧凑记录编码）
+inline int32_t thingGetScaled(const ThingProperties& props, ThingPropertyId id) {
+    switch (id) {
+        case TP_temperature: return thingScaleFloat(props.temperature, 1);
+        case TP_humidity: return thingScaleFloat(props.humidity, 1);
+        case TP_LED: return props.LED ? 1 : 0;
+        case TP_Switch: return props.Switch ? 1 : 0;
+        case TP_Set_Threshold: return props.Set_Threshold;
+        case TP_Set_Threshold_Float: return thingScaleFloat(props.Set_Threshold_Float, 2);
+        case TP_Set_Temperature: return thingScaleFloat(props.Set_Temperature, 1);
+        case TP_Set_Humidity: return thingScaleFloat(props.Set_Humidity, 1);
+        case TP_Pub_Count: return props.Pub_Count;
+        case TP_Pub_Fail: return props.Pub_Fail;
+        case TP_Queue_Depth: return props.Queue_Depth;
+        case TP_Drop_Count: return props.Drop_Count;
+        case TP_Reconnects: return props.Reconnects;
+        case TP_Heap_Min: return props.Heap_Min;
+        case TP_RSSI: return props.RSSI;
+        case TP_Loop_Time: return props.Loop_Time;
+        default: return 0;
+    }
+}
+
+// 由整数表示还原属性值（不修改present位图）
+inline void thingSetScaled(ThingProperties& props, ThingPropertyId id, int32_t value) {
+    switch (id) {
+        case TP_temperature: props.temperature = thingUnscaleFloat(value, 1); break;
+        case TP_humidity: props.humidity = thingUnscaleFloat(value, 1); break;
+        case TP_LED: props.LED = value != 0; break;
+        case TP_Switch: props.Switch = value != 0; break;
+        case TP_Set_Threshold: props.Set_Threshold = value; break;
+        case TP_Set_Threshold_Float: props.Set_Threshold_Float = thingUnscaleFloat(value, 2); break;
+        case TP_Set_Temperature: props.Set_Temperature = thingUnscaleFloat(value, 1); break;
+        case TP_Set_Humidity: props.Set_Humidity = thingUnscaleFloat(value, 1); break;
+        case TP_Pub_Count: props.Pub_Count = value; break;
+        case TP_Pub_Fail: props.Pub_Fail = value; break;
+        case TP_Queue_Depth: props.Queue_Depth = value; break;
+        case TP_Drop_Count: props.Drop_Count = value; break;
+        case TP_Reconnects: props.Reconnects = value; break;
+        case TP_Heap_Min: props.Heap_Min = value; break;
+        case TP_RSSI: props.RSSI = value; break;
+        case TP_Loop_Time: props.Loop_Time = value; break;
+        default: break;
+    }
+}
+
+// 字符串属性的存储位置，非字符串属性返回nullptr
+inline String* thingStringField(ThingProperties& props, ThingPropertyId id) {
+    switch (id) {
+        case TP_Upload_Data: return &props.Upload_Data;
+        case TP_Command: return &props.Command;
+        case TP_Control: return &props.Control;
+        case TP_Set_Config: return &props.Set_Config;
+        default: return nullptr;
+    }
+}
+
+inline const String* thingStringField(const ThingProperties& props, ThingPropertyId id) {
+    return thingStringField(const_cast<ThingProperties&>(props), id);
+}
+
+#endif
@@ -29,6 +29,9 @@ public:
     // 检查是否已同步时间
     static bool isTimeSynced();
 
+    // 距下一次NTP更新的时间(ms)
+    static unsigned long getNextUpdateIn(unsigned long now);
+
     // 获取时间同步状态
     static bool getSyncSuccess() { return timeSynced; }
 
@@ -0,0 +1,50 @@
+#ifndef TOPIC_CACHE_H
+#define TOPIC_CACHE_H
+
+#include <Arduino.h>
+#include <vector>
+
+// 物模型相关主题编号
+enum TopicId : uint8_t {
+    TOPIC_POST,              // thing/property/post
+    TOPIC_POST_REPLY,        // thing/property/post/reply
+    TOPIC_SET,               // thing/property/set
+    TOPIC_SET_REPLY,         // thing/property/set_reply
+    TOPIC_GET,               // thing/property/get
+    TOPIC_GET_REPLY,         // thing/property/get_reply
+    TOPIC_DESIRED_GET,       // thing/property/desired/get
+    TOPIC_DESIRED_GET_REPLY, // thing/property/desired/get/reply
+    // 网关子设备主题（GATEWAY_MODE）
+    TOPIC_SUB_LOGIN,         // thing/sub/login
+    TOPIC_SUB_LOGIN_REPLY,   // thing/sub/login/reply
+    TOPIC_SUB_LOGOUT,        // thing/sub/logout
+    TOPIC_SUB_LOGOUT_REPLY,  // thing/sub/logout/reply
+    TOPIC_PACK_POST,         // thing/pack/post
+    TOPIC_PACK_POST_REPLY,   // thing/pack/post/reply
+    TOPIC_SUB_SET,           // thing/sub/property/set
+    TOPIC_SUB_SET_REPLY,     // thing/sub/property/set_reply
+    TOPIC_COUNT
+};
+
+// 主题与消息id缓存：主题在启动时由产品ID和设备名称生成一次，之后只返回指针；
+// 消息id由递增计数器生成，不再每次构造String(millis())
+class TopicCache {
+public:
+    // 按 $sys/{产品ID}/{设备名称}/... 生成全部主题，在MQTT初始化时调用
+    static void begin(const char* productId, const char* deviceName);
+    // 获取主题（begin()之后指针一直有效，可长期保存）
+    static const char* get(TopicId id);
+    // 查找收到的主题对应的编号，不是物模型主题时返回TOPIC_COUNT
+    static TopicId match(const char* topic);
+    // 生成下一个消息id，返回的缓冲区在下一次调用前有效
+    static const char* nextId();
+
+private:
+    static std::vector<char> storage;    // 所有主题连续存放，以'\0'分隔
+    static uint16_t offsets[TOPIC_COUNT];
+    static uint16_t prefixLength;        // "$sys/{产品ID}/{设备名称}" 的长度
+    static uint32_t idCounter;
+    static char idBuffer[11];
+};
+
+#endif
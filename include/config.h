@@ -10,23 +10,104 @@
 // ==================== OneNET平台配置 ====================
 #define MQTT_SERVER "mqtts.heclouds.com"
 #define MQTT_PORT 1883
-#define DEVICE_ID "Carrier"
-#define USERNAME "wyAD40JBtZ"
+#define PRODUCT_ID "wyAD40JBtZ"//产品ID，MQTT主题由产品ID和设备ID在启动时生成
+#define DEVICE_ID "Carrier"//设备名称
+#define USERNAME PRODUCT_ID
 #define PASSWORD "version=2018-10-31&res=products%2FwyAD40JBtZ%2Fdevices%2FCarrier&et=2712538324&method=md5&sign=i75wHA3H5zjivQX5RjdXSA%3D%3D"
 
-// ==================== MQTT主题配置 ====================
-#define PUB_post_TOPIC "$sys/wyAD40JBtZ/Carrier/thing/property/post"
-#define SUB_post_reply_TOPIC "$sys/wyAD40JBtZ/Carrier/thing/property/post/reply"
-#define SUB_set_TOPIC "$sys/wyAD40JBtZ/Carrier/thing/property/set"
-#define PUB_set_reply_TOPIC "$sys/wyAD40JBtZ/Carrier/thing/property/set_reply"
-
 // ==================== 系统参数配置 ====================
-#define SERIAL_BAUD 115200//串口波特率
-#define WIFI_CHECK_INTERVAL 30000//WiFi重连间隔（优化：60秒→30秒）
-#define MQTT_CHECK_INTERVAL 30000//MQTT重连间隔（优化：60秒→30秒）
-#define HEARTBEAT_INTERVAL 30000//心跳包发送间隔
+#define SERIAL_BAUD 115200//串口波特率（支持到921600及以上，需与platformio.ini的monitor_speed一致）
+#define SERIAL_RX_BUFFER_SIZE 2048//串口接收环形缓冲区大小（由UART中断填充）
+#define SERIAL_RX_MAX_BYTES_PER_POLL 512//每次readSerialData最多处理的字节数
+#define RECONNECT_BACKOFF_BASE 2000//WiFi/MQTT断开后重连的最短等待时间(ms)
+#define RECONNECT_BACKOFF_CAP 120000//重连退避的最长等待时间(ms)
+#define WIFI_CONNECT_TIMEOUT 5000//单次WiFi重连的等待时间(ms)
+#define MQTT_KEEPALIVE_MAX 120//信号好时的MQTT保活时间(s)
+#define MQTT_KEEPALIVE_MIN 30//信号差或会话保活超时后的最短保活时间(s)
+#define MQTT_RSSI_GOOD -67//RSSI不低于该值(dBm)时使用MQTT_KEEPALIVE_MAX
+#define MQTT_RSSI_WEAK -80//RSSI低于该值(dBm)时使用MQTT_KEEPALIVE_MIN，两者之间取中间值
+#define MQTT_PUBLISH_QOS 1//上报使用的QoS：0=QoS0（写入TCP即视为成功），1=QoS1（收到PUBACK才算成功，重连后重发）
+#define MQTT_CLEAN_SESSION 0//1=每次连接清除会话，0=持久会话（重连后重发的QoS1消息由服务器去重）
+#define MQTT_QOS1_WINDOW 4//QoS1同时在途（未确认）的PUBLISH数，可用串口指令 QOS_WINDOW n 或 SET 调整
+#define MQTT_QOS1_WINDOW_MAX 16//QoS1在途窗口上限
+#define MQTT_QOS1_ACK_TIMEOUT 10000//等待PUBACK的超时时间(ms)，超时后以DUP标志重发
+#define MQTT_QOS1_MAX_RESEND 3//PUBACK超时后的最大重发次数，超过后放弃该消息
+#define HEARTBEAT_INTERVAL 30000//心跳包（运行指标）发送间隔
+#define METRICS_PIGGYBACK_WINDOW 10000//心跳到期前该时间(ms)内的属性上报捎带运行指标
 #define MAX_MESSAGE_LENGTH 100//最大消息长度
+#define MAX_QUEUE_SIZE 10//消息重传队列条数上限
+#define MAX_RETRY_COUNT 3//队列消息最大重试次数
+#define MQTT_RETRY_DELAY 5000//队列消息发布失败后的重试间隔(ms)
 #define MAX_DATA_BUFFER_SIZE 50//最大数据缓冲区条目数（防止内存溢出）
+#define MQTT_BUFFER_SIZE 1024//MQTT接收环形缓冲区大小（字节），超过该长度的下行报文被跳过
+#define MQTT_CONNECT_TIMEOUT 15000//等待CONNACK的超时时间(ms)
+#define MQTT_TRANSPORT_MERGE_BYTES 128//不超过该长度的相邻报文分段合并后写出，更长的分段(负载)直接写出
+#define REQUEST_CACHE_SIZE 8//缓存最近处理的属性设置请求id及响应的条数，重复请求直接返回原响应
+#define TELEMETRY_QUEUE_BYTES 4096//离线属性上报队列大小（字节），排队期间为紧凑格式，发送时展开为JSON
+#define TELEMETRY_DRAIN_PER_LOOP 4//恢复连接后每轮loop()最多展开发送的排队上报数
+
+// ==================== STM32命令通道配置 ====================
+// 下行数据包格式: <CYZ:序号:key=value:CYZ>（本地规则为 <CYZ:序号:命令:CYZ>），STM32回复 ACK:序号 / NAK:序号
+#define STM32_CMD_WINDOW 4//允许同时在途（未确认）的命令数
+#define STM32_CMD_TIMEOUT 500//等待STM32确认的超时时间(ms)
+#define STM32_CMD_MAX_RETRY 2//确认超时后的最大重发次数
+#define STM32_CMD_QUEUE_SIZE 16//命令队列最大长度
+
+// ==================== 流式上传配置 ====================
+// STREAM模式下每行key=value立即进入微批次，满足任一条件即自动上传
+#define STREAM_BATCH_MAX_BYTES 512//批次JSON字节上限（估算）
+#define STREAM_BATCH_MAX_SAMPLES 20//批次最大样本数
+#define STREAM_BATCH_MAX_LATENCY 200//批次中第一条样本的最大等待时间(ms)
+#define UPLOAD_DATA_TIMEOUT 60000//UPLOAD_DATA模式未收到END的超时时间(ms)
+
+// ==================== 串口流控配置 ====================
+// 0=关闭, 1=XON/XOFF软件流控, 2=RTS硬件流控（FLOW_RTS_PIN需接到STM32的CTS）
+#define FLOW_CONTROL_MODE 1
+#define FLOW_RTS_PIN 15//UART0的RTS引脚，高电平通知STM32暂停发送
+#define FLOW_HIGH_WATERMARK 75//串口接收缓冲区/数据缓冲区/发送队列填充率达到该值(%)时暂停STM32发送
+#define FLOW_LOW_WATERMARK 25//填充率回落到该值(%)以下时恢复
+#define FLOW_MAX_PAUSE 5000//数据缓冲区或发送队列导致的暂停最长持续时间(ms)，超过后恢复STM32发送
+
+// ==================== 网关配置 ====================
+// 网关模式下以 "@子设备名 key=value" 开头的串口行按子设备批量上报（thing/pack/post），
+// 下发给子设备的命令包为 <CYZ@子设备名:序号:key=value:CYZ>；子设备需在OneNET上已绑定到本设备
+#define GATEWAY_MODE 0//0=单设备, 1=网关
+#define GATEWAY_SUB_PRODUCT_ID PRODUCT_ID//子设备所属产品ID（子设备与网关使用同一物模型）
+#define GATEWAY_MAX_SUB_DEVICES 8//子设备表容量
+#define GATEWAY_TAG_MAX_LENGTH 32//子设备名称最大长度
+#define GATEWAY_LOGIN_TIMEOUT 5000//等待登录/登出应答的超时时间(ms)
+#define GATEWAY_LOGIN_RETRY 10000//登录失败后的重试间隔(ms)
+#define GATEWAY_PACK_MAX_BYTES 900//单条pack/post的字节上限，超出时分为多条
+
+// ==================== 属性影子配置 ====================
+#define SHADOW_PERSIST 1//是否将可写属性的影子保存到Flash（EEPROM模拟）
+#define SHADOW_EEPROM_SIZE 768//影子存储区大小（字节），可写字符串属性按最大长度估算
+
+// ==================== 运行参数配置 ====================
+// 本文件中登记在 src/Settings.cpp 注册表里的参数（队列长度、重试、批次、超时等）只是默认值，
+// 可用串口 SET KEY=值 或属性 Set_Config 修改，立即生效并保存到Flash
+#define SETTINGS_EEPROM_OFFSET SHADOW_EEPROM_SIZE//运行参数存储区紧接在影子存储区之后
+#define SETTINGS_EEPROM_SIZE 128//运行参数存储区大小（字节）
+#define EEPROM_TOTAL_SIZE (SHADOW_EEPROM_SIZE + SETTINGS_EEPROM_SIZE)//EEPROM模拟区总大小，各模块begin()时必须一致
+
+// ==================== 本地规则配置 ====================
+// 阈值属性（Set_Temperature等）下发后，STM32上报的样本越过阈值时由ESP8266直接驱动LED/向STM32发送命令
+// 规则定义见 src/RuleEngine.cpp 的注册表
+#define RULE_ENGINE_ENABLE 1//是否启用本地阈值规则
+#define RULE_HYSTERESIS 5//默认回差，按输入属性的步长计（温度/湿度保留1位小数，5即0.5）
+
+// ==================== 串口抓包配置 ====================
+#define TRACE_BUFFER_SIZE 4096//TRACE_START后记录原始接收字节的RAM缓冲区大小（字节）
+
+// ==================== 低功耗配置 ====================
+// 0=不休眠（每轮loop固定delay(5)）, 1=空闲时modem sleep, 2=空闲较长时允许light sleep（串口RX唤醒）
+#define POWER_MODE 2
+#define POWER_IDLE_THRESHOLD 50//串口/MQTT活动后保持唤醒的时间(ms)
+#define POWER_MIN_SLEEP 10//距下一定时事件不足该时间(ms)时不休眠
+#define POWER_LIGHT_SLEEP_MIN 100//可休眠时间达到该值(ms)才进入light sleep
+#define POWER_MAX_SLEEP 5000//单次休眠上限(ms)
+#define POWER_SLEEP_SLICE 20//休眠分片(ms)，分片间检查串口与网络数据，决定提前唤醒的延迟
+#define POWER_DTIM_LISTEN_INTERVAL 3//light sleep时每隔几个DTIM信标唤醒一次射频
 
 // ==================== 日志级别配置 ====================
 // 0=关闭, 1=错误, 2=警告, 3=信息, 4=调试
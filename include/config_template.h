@@ -10,23 +10,96 @@
 // ==================== OneNET平台配置 ====================
 #define MQTT_SERVER "mqtts.heclouds.com"
 #define MQTT_PORT 1883
+#define PRODUCT_ID "YOUR_PRODUCT_ID"
 #define DEVICE_ID "YOUR_DEVICE_ID"
-#define USERNAME "YOUR_PRODUCT_ID"
+#define USERNAME PRODUCT_ID
 #define PASSWORD "YOUR_ENCRYPTED_PASSWORD"
 
-// ==================== MQTT主题配置 ====================
-#define PUB_post_TOPIC "$sys/YOUR_PRODUCT_ID/YOUR_DEVICE_ID/thing/property/post"
-#define SUB_post_reply_TOPIC "$sys/YOUR_PRODUCT_ID/YOUR_DEVICE_ID/thing/property/post/reply"
-#define SUB_set_TOPIC "$sys/YOUR_PRODUCT_ID/YOUR_DEVICE_ID/thing/property/set"
-#define PUB_set_reply_TOPIC "$sys/YOUR_PRODUCT_ID/YOUR_DEVICE_ID/thing/property/set_reply"
-
 // ==================== 系统参数配置 ====================
 #define SERIAL_BAUD 115200
-#define WIFI_CHECK_INTERVAL 30000
-#define MQTT_CHECK_INTERVAL 30000
+#define SERIAL_RX_BUFFER_SIZE 2048
+#define SERIAL_RX_MAX_BYTES_PER_POLL 512
+#define RECONNECT_BACKOFF_BASE 2000
+#define RECONNECT_BACKOFF_CAP 120000
+#define WIFI_CONNECT_TIMEOUT 5000
+#define MQTT_KEEPALIVE_MAX 120
+#define MQTT_KEEPALIVE_MIN 30
+#define MQTT_RSSI_GOOD -67
+#define MQTT_RSSI_WEAK -80
+#define MQTT_PUBLISH_QOS 1
+#define MQTT_CLEAN_SESSION 0
+#define MQTT_QOS1_WINDOW 4
+#define MQTT_QOS1_WINDOW_MAX 16
+#define MQTT_QOS1_ACK_TIMEOUT 10000
+#define MQTT_QOS1_MAX_RESEND 3
 #define HEARTBEAT_INTERVAL 30000
+#define METRICS_PIGGYBACK_WINDOW 10000
 #define MAX_MESSAGE_LENGTH 100
+#define MAX_QUEUE_SIZE 10
+#define MAX_RETRY_COUNT 3
+#define MQTT_RETRY_DELAY 5000
 #define MAX_DATA_BUFFER_SIZE 50
+#define MQTT_BUFFER_SIZE 1024
+#define MQTT_CONNECT_TIMEOUT 15000
+#define MQTT_TRANSPORT_MERGE_BYTES 128
+#define REQUEST_CACHE_SIZE 8
+#define TELEMETRY_QUEUE_BYTES 4096
+#define TELEMETRY_DRAIN_PER_LOOP 4
+
+// ==================== STM32命令通道配置 ====================
+// 下行数据包格式: <CYZ:序号:key=value:CYZ>（本地规则为 <CYZ:序号:命令:CYZ>），STM32回复 ACK:序号 / NAK:序号
+#define STM32_CMD_WINDOW 4
+#define STM32_CMD_TIMEOUT 500
+#define STM32_CMD_MAX_RETRY 2
+#define STM32_CMD_QUEUE_SIZE 16
+
+// ==================== 流式上传配置 ====================
+#define STREAM_BATCH_MAX_BYTES 512
+#define STREAM_BATCH_MAX_SAMPLES 20
+#define STREAM_BATCH_MAX_LATENCY 200
+#define UPLOAD_DATA_TIMEOUT 60000
+
+// ==================== 串口流控配置 ====================
+// 0=关闭, 1=XON/XOFF软件流控, 2=RTS硬件流控
+#define FLOW_CONTROL_MODE 1
+#define FLOW_RTS_PIN 15
+#define FLOW_HIGH_WATERMARK 75
+#define FLOW_LOW_WATERMARK 25
+#define FLOW_MAX_PAUSE 5000
+
+// ==================== 网关配置 ====================
+#define GATEWAY_MODE 0
+#define GATEWAY_SUB_PRODUCT_ID PRODUCT_ID
+#define GATEWAY_MAX_SUB_DEVICES 8
+#define GATEWAY_TAG_MAX_LENGTH 32
+#define GATEWAY_LOGIN_TIMEOUT 5000
+#define GATEWAY_LOGIN_RETRY 10000
+#define GATEWAY_PACK_MAX_BYTES 900
+
+// ==================== 属性影子配置 ====================
+#define SHADOW_PERSIST 1
+#define SHADOW_EEPROM_SIZE 768
+
+// ==================== 运行参数配置 ====================
+#define SETTINGS_EEPROM_OFFSET SHADOW_EEPROM_SIZE
+#define SETTINGS_EEPROM_SIZE 128
+#define EEPROM_TOTAL_SIZE (SHADOW_EEPROM_SIZE + SETTINGS_EEPROM_SIZE)
+
+// ==================== 本地规则配置 ====================
+#define RULE_ENGINE_ENABLE 1
+#define RULE_HYSTERESIS 5
+
+// ==================== 串口抓包配置 ====================
+#define TRACE_BUFFER_SIZE 4096
+
+// ==================== 低功耗配置 ====================
+#define POWER_MODE 2
+#define POWER_IDLE_THRESHOLD 50
+#define POWER_MIN_SLEEP 10
+#define POWER_LIGHT_SLEEP_MIN 100
+#define POWER_MAX_SLEEP 5000
+#define POWER_SLEEP_SLICE 20
+#define POWER_DTIM_LISTEN_INTERVAL 3
 
 // ==================== 日志级别配置 ====================
 // 0=关闭, 1=错误, 2=警告, 3=信息, 4=调试
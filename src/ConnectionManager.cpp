@@ -0,0 +1,153 @@
+#include <ConnectionManager.h>
+#include <PowerManager.h>
+
+/*=====================退避计算========================*/
+
+ReconnectBackoff::ReconnectBackoff(unsigned long base, unsigned long cap)
+    : rngState(1), base(base), cap(cap), current(0) {
+}
+
+void ReconnectBackoff::seed(uint32_t value) {
+    // xorshift的状态不能为0
+    rngState = value != 0 ? value : 0x9E3779B9UL;
+}
+
+uint32_t ReconnectBackoff::nextRandom() {
+    uint32_t x = rngState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rngState = x;
+    return x;
+}
+
+unsigned long ReconnectBackoff::next() {
+    unsigned long upper = current == 0 ? base * 3 : current * 3;
+    if (upper > cap) {
+        upper = cap;
+    }
+    current = base + nextRandom() % (upper - base + 1);
+    return current;
+}
+
+/*=====================连接管理========================*/
+
+ConnectionManager::ConnectionManager(ESP8266WiFiMulti& wifi, MqttHandler& mqtt)
+    : wifiMulti(wifi),
+      mqttHandler(mqtt),
+      wifiBackoff(RECONNECT_BACKOFF_BASE, RECONNECT_BACKOFF_CAP),
+      mqttBackoff(RECONNECT_BACKOFF_BASE, RECONNECT_BACKOFF_CAP) {
+    wifiUp = false;
+    mqttUp = false;
+    nextWifiAttempt = 0;
+    nextMqttAttempt = 0;
+    wifiAttempts = 0;
+    mqttAttempts = 0;
+}
+
+void ConnectionManager::begin() {
+    // 芯片ID区分同一批固件的不同设备，设备ID区分更换模组后的同一设备
+    uint32_t seed = ESP.getChipId();
+    for (const char* p = DEVICE_ID; *p; p++) {
+        seed = (seed ^ (uint8_t)*p) * 16777619UL;
+    }
+    wifiBackoff.seed(seed);
+    mqttBackoff.seed(seed ^ 0x5A5A5A5AUL);
+
+    unsigned long now = millis();
+    wifiUp = WiFi.status() == WL_CONNECTED;
+    mqttUp = mqttHandler.isConnected();
+    if (!wifiUp) {
+        digitalWrite(LED_GPIO_PIN, LOW);//WiFi未连接，LED开
+    }
+    // setup中的首次连接失败时，同样按退避时间错开重试
+    nextWifiAttempt = now + (wifiUp ? 0 : wifiBackoff.next());
+    nextMqttAttempt = now + (mqttUp ? 0 : mqttBackoff.next());
+}
+
+void ConnectionManager::update(unsigned long now) {
+    updateWiFi(now);
+    if (wifiUp) {
+        updateMqtt(now);
+    }
+}
+
+void ConnectionManager::updateWiFi(unsigned long now) {
+    if (WiFi.status() == WL_CONNECTED) {
+        if (!wifiUp) {
+            Serial.println("WiFi已重新连接: " + WiFi.SSID() + " (尝试 " + String(wifiAttempts) + " 次)");
+            wifiUp = true;
+            wifiBackoff.reset();
+            digitalWrite(LED_GPIO_PIN, HIGH);//wifi正常连接提示，关闭LED
+            // WiFi恢复后MQTT立即尝试一次，之后再按退避重试
+            nextMqttAttempt = now;
+        }
+        return;
+    }
+
+    if (wifiUp) {
+        wifiUp = false;
+        mqttUp = false;
+        wifiAttempts = 0;
+        unsigned long delayMs = wifiBackoff.next();
+        nextWifiAttempt = now + delayMs;
+        Serial.println("WiFi连接断开，" + String(delayMs) + "ms后重连");
+        digitalWrite(LED_GPIO_PIN, LOW);//WiFi断开，LED开
+        return;
+    }
+
+    if ((long)(now - nextWifiAttempt) < 0) {
+        return;
+    }
+
+    wifiAttempts++;
+    Serial.println("尝试重连WiFi（第 " + String(wifiAttempts) + " 次）...");
+    if (wifiMulti.run(WIFI_CONNECT_TIMEOUT) != WL_CONNECTED) {
+        unsigned long delayMs = wifiBackoff.next();
+        nextWifiAttempt = millis() + delayMs;
+        Serial.println("WiFi重连失败，" + String(delayMs) + "ms后重试");
+    }
+}
+
+void ConnectionManager::updateMqtt(unsigned long now) {
+    if (mqttHandler.isConnected()) {
+        if (!mqttUp) {
+            mqttUp = true;
+            mqttBackoff.reset();
+        }
+        return;
+    }
+
+    if (mqttUp) {
+        mqttUp = false;
+        mqttAttempts = 0;
+        unsigned long delayMs = mqttBackoff.next();
+        nextMqttAttempt = now + delayMs;
+        Serial.println("MQTT连接断开，" + String(delayMs) + "ms后重连");
+        return;
+    }
+
+    if ((long)(now - nextMqttAttempt) < 0) {
+        return;
+    }
+
+    mqttAttempts++;
+    if (mqttHandler.connect()) {
+        mqttUp = true;
+        mqttBackoff.reset();
+    } else {
+        unsigned long delayMs = mqttBackoff.next();
+        nextMqttAttempt = millis() + delayMs;
+        Serial.println("MQTT重连失败，" + String(delayMs) + "ms后重试");
+    }
+}
+
+unsigned long ConnectionManager::getNextDeadlineIn(unsigned long now) const {
+    if (!wifiUp) {
+        return (long)(nextWifiAttempt - now) > 0 ? nextWifiAttempt - now : 0;
+    }
+    if (!mqttUp) {
+        return (long)(nextMqttAttempt - now) > 0 ? nextMqttAttempt - now : 0;
+    }
+    return POWER_NO_DEADLINE;
+}
@@ -0,0 +1,359 @@
+#include <Gateway.h>
+#include <MqttHandler.h>
+#include <PowerManager.h>
+#include <TopicCache.h>
+#include <Settings.h>
+
+Gateway::Gateway() {
+    mqttHandler = nullptr;
+    packCount = 0;
+    droppedSamples = 0;
+    connected = false;
+}
+//加入子设备相关主题的订阅，连接成功后随其他主题一次性恢复
+void Gateway::begin() {
+    if (mqttHandler == nullptr) {
+        Serial.println("错误: MQTT处理器未初始化!");
+        return;
+    }
+    subDevices.reserve(GATEWAY_MAX_SUB_DEVICES);
+    mqttHandler->subscribe(TopicCache::get(TOPIC_SUB_SET));
+    mqttHandler->subscribe(TopicCache::get(TOPIC_SUB_LOGIN_REPLY));
+    mqttHandler->subscribe(TopicCache::get(TOPIC_SUB_LOGOUT_REPLY));
+    Serial.println("网关模式已开启，子设备上限 " + String(GATEWAY_MAX_SUB_DEVICES) + " 个");
+}
+
+SubDevice* Gateway::find(const char* name) {
+    for (auto& dev : subDevices) {
+        if (dev.name == name) {
+            return &dev;
+        }
+    }
+    return nullptr;
+}
+
+SubDevice* Gateway::findOrAdd(const String& name) {
+    SubDevice* dev = find(name.c_str());
+    if (dev != nullptr) {
+        return dev;
+    }
+    if (subDevices.size() >= GATEWAY_MAX_SUB_DEVICES) {
+        Serial.println("警告: 子设备表已满，忽略子设备: " + name);
+        return nullptr;
+    }
+
+    SubDevice added;
+    added.name = name;
+    added.state = SUB_OFFLINE;
+    added.wantOnline = false;
+    added.requestTime = millis();
+    added.sampleCount = 0;
+    added.batchBytes = 0;
+    added.batchStartTime = 0;
+    subDevices.push_back(added);
+    return &subDevices.back();
+}
+//发送子设备登录请求
+void Gateway::sendLogin(SubDevice& dev, unsigned long now) {
+    dev.requestId = TopicCache::nextId();
+    dev.requestTime = now;
+
+    String payload;
+    payload.reserve(80 + dev.name.length());
+    payload = F("{\"id\":");
+    thingAppendJsonString(payload, dev.requestId.c_str());
+    payload += F(",\"version\":\"1.0\",\"params\":{\"productID\":");
+    thingAppendJsonString(payload, GATEWAY_SUB_PRODUCT_ID);
+    payload += F(",\"deviceName\":");
+    thingAppendJsonString(payload, dev.name.c_str());
+    payload += F("}}");
+
+    Serial.println("子设备登录: " + dev.name);
+    dev.state = mqttHandler->publish(TopicCache::get(TOPIC_SUB_LOGIN), payload.c_str()) ? SUB_LOGIN_PENDING : SUB_OFFLINE;
+}
+//发送子设备登出请求
+void Gateway::sendLogout(SubDevice& dev, unsigned long now) {
+    dev.requestId = TopicCache::nextId();
+    dev.requestTime = now;
+
+    String payload;
+    payload.reserve(80 + dev.name.length());
+    payload = F("{\"id\":");
+    thingAppendJsonString(payload, dev.requestId.c_str());
+    payload += F(",\"version\":\"1.0\",\"params\":{\"productID\":");
+    thingAppendJsonString(payload, GATEWAY_SUB_PRODUCT_ID);
+    payload += F(",\"deviceName\":");
+    thingAppendJsonString(payload, dev.name.c_str());
+    payload += F("}}");
+
+    Serial.println("子设备登出: " + dev.name);
+    if (mqttHandler->publish(TopicCache::get(TOPIC_SUB_LOGOUT), payload.c_str())) {
+        dev.state = SUB_LOGOUT_PENDING;
+    }
+}
+
+void Gateway::login(const String& name) {
+    SubDevice* dev = findOrAdd(name);
+    if (dev == nullptr) {
+        return;
+    }
+    dev->wantOnline = true;
+    if (dev->state == SUB_OFFLINE && connected) {
+        sendLogin(*dev, millis());
+    } else if (dev->state == SUB_ONLINE) {
+        Serial.println("子设备已在线: " + name);
+    }
+}
+
+void Gateway::logout(const String& name) {
+    SubDevice* dev = find(name.c_str());
+    if (dev == nullptr) {
+        Serial.println("未知子设备: " + name);
+        return;
+    }
+    dev->wantOnline = false;
+    if (dev->state == SUB_ONLINE) {
+        // 先上报该子设备未发送的数据
+        flushBatches();
+        sendLogout(*dev, millis());
+    } else if (dev->state == SUB_OFFLINE) {
+        Serial.println("子设备已移除: " + name);
+        subDevices.erase(subDevices.begin() + (dev - subDevices.data()));
+    }
+    // 登录/登出应答未到时，由update()在应答后或超时后继续处理
+}
+//加入样本：每个子设备单独累积批次，任一批次到期时打包全部在线子设备的批次
+bool Gateway::addSample(const String& name, const String& key, const String& value) {
+    SubDevice* dev = findOrAdd(name);
+    if (dev == nullptr) {
+        droppedSamples++;
+        return false;
+    }
+
+    unsigned long now = millis();
+    dev->wantOnline = true;
+    if (dev->state == SUB_OFFLINE && connected) {
+        sendLogin(*dev, now);
+    }
+
+    ThingPropertyId id = thingFindProperty(key.c_str());
+    // 估算该样本在JSON中的长度: "key":{"value":value},
+    size_t sampleBytes = key.length() + value.length() + 16;
+    bool overflow = dev->batchBytes + sampleBytes > (size_t)Settings::get(CFG_STREAM_BATCH_MAX_BYTES);
+
+    // 同一批次内出现重复的键或超出字节上限时先上传
+    if (dev->sampleCount > 0 && (dev->batch.has(id) || overflow) && dev->state == SUB_ONLINE) {
+        flushBatches();
+        overflow = dev->batchBytes + sampleBytes > (size_t)Settings::get(CFG_STREAM_BATCH_MAX_BYTES);
+    }
+
+    // 未登录或上传被推迟时批次继续累积：同一属性只保留最新值，字节超限则丢弃
+    if (dev->sampleCount > 0 && !dev->batch.has(id) && overflow) {
+        Serial.println("警告: 子设备 " + name + " 批次已满，丢弃样本: " + key);
+        droppedSamples++;
+        return false;
+    }
+    if (dev->batch.has(id)) {
+        droppedSamples++;
+    }
+
+    if (dev->sampleCount == 0) {
+        dev->batchStartTime = now;
+    }
+    thingParseText(dev->batch, id, value.c_str());
+    dev->sampleCount++;
+    dev->batchBytes += sampleBytes;
+
+    if (dev->state == SUB_ONLINE && dev->sampleCount >= (size_t)Settings::get(CFG_STREAM_BATCH_MAX_SAMPLES)) {
+        flushBatches();
+    }
+    return true;
+}
+
+void Gateway::clearBatch(SubDevice& dev) {
+    dev.batch.clear();
+    dev.sampleCount = 0;
+    dev.batchBytes = 0;
+    dev.batchStartTime = 0;
+}
+//追加一个子设备的pack/post条目
+void Gateway::appendPackEntry(String& out, const SubDevice& dev) const {
+    out += F("{\"identity\":{\"productID\":");
+    thingAppendJsonString(out, GATEWAY_SUB_PRODUCT_ID);
+    out += F(",\"deviceName\":");
+    thingAppendJsonString(out, dev.name.c_str());
+    out += F("},\"properties\":{");
+    thingAppendParams(out, dev.batch);
+    out += F("}}");
+}
+//将全部在线子设备的批次打包为thing/pack/post，超过GATEWAY_PACK_MAX_BYTES时分为多条
+bool Gateway::flushBatches() {
+    if (mqttHandler == nullptr) {
+        return false;
+    }
+    if (!mqttHandler->isConnected() && mqttHandler->isQueueFull()) {
+        return false;
+    }
+
+    String payload;
+    size_t entries = 0;
+    for (auto& dev : subDevices) {
+        if (dev.state != SUB_ONLINE || dev.sampleCount == 0) {
+            continue;
+        }
+
+        size_t entryBytes = dev.batchBytes + dev.name.length() + 64;
+        if (entries > 0 && payload.length() + entryBytes + 2 > GATEWAY_PACK_MAX_BYTES) {
+            payload += F("]}");
+            mqttHandler->publish(TopicCache::get(TOPIC_PACK_POST), payload.c_str(), true);
+            packCount++;
+            entries = 0;
+        }
+
+        if (entries == 0) {
+            payload.reserve(GATEWAY_PACK_MAX_BYTES);
+            payload = F("{\"id\":");
+            thingAppendJsonString(payload, TopicCache::nextId());
+            payload += F(",\"version\":\"1.0\",\"params\":[");
+        } else {
+            payload += ',';
+        }
+        appendPackEntry(payload, dev);
+        entries++;
+        clearBatch(dev);
+    }
+
+    if (entries > 0) {
+        payload += F("]}");
+        mqttHandler->publish(TopicCache::get(TOPIC_PACK_POST), payload.c_str(), true);
+        packCount++;
+    }
+    return true;
+}
+//批次延迟检查与登录状态维护
+void Gateway::update(unsigned long now) {
+    connected = mqttHandler != nullptr && mqttHandler->isConnected();
+
+    bool due = false;
+    for (auto& dev : subDevices) {
+        if (!connected) {
+            // 网关断线时平台将子设备一并置为离线，重连后由onConnected()重新登录
+            dev.state = SUB_OFFLINE;
+            continue;
+        }
+
+        switch (dev.state) {
+            case SUB_LOGIN_PENDING:
+            case SUB_LOGOUT_PENDING:
+                if (now - dev.requestTime >= GATEWAY_LOGIN_TIMEOUT) {
+                    Serial.println("子设备 " + dev.name + (dev.state == SUB_LOGIN_PENDING ? " 登录" : " 登出") + "应答超时");
+                    dev.state = dev.state == SUB_LOGIN_PENDING ? SUB_OFFLINE : SUB_ONLINE;
+                    dev.requestId = "";
+                }
+                break;
+            case SUB_OFFLINE:
+                if (dev.wantOnline && now - dev.requestTime >= GATEWAY_LOGIN_RETRY) {
+                    sendLogin(dev, now);
+                }
+                break;
+            case SUB_ONLINE:
+                if (dev.sampleCount > 0 && now - dev.batchStartTime >= (unsigned long)Settings::get(CFG_STREAM_BATCH_MAX_LATENCY)) {
+                    due = true;
+                }
+                if (!dev.wantOnline && now - dev.requestTime >= GATEWAY_LOGIN_RETRY) {
+                    sendLogout(dev, now);
+                }
+                break;
+        }
+    }
+
+    if (due) {
+        flushBatches();
+    }
+}
+
+void Gateway::onConnected() {
+    connected = true;
+    unsigned long now = millis();
+    for (auto& dev : subDevices) {
+        dev.state = SUB_OFFLINE;
+        if (dev.wantOnline) {
+            sendLogin(dev, now);
+        }
+    }
+}
+//处理thing/sub/login/reply与thing/sub/logout/reply
+void Gateway::handleLoginReply(const char* payload, unsigned int length, bool isLogin) {
+    StaticJsonDocument<JSON_OBJECT_SIZE(4)> doc;
+    DeserializationError error = deserializeJson(doc, payload, length);
+    if (error) {
+        Serial.println("子设备应答解析失败: " + String(error.c_str()));
+        return;
+    }
+
+    const char* id = doc["id"].as<const char*>();
+    int code = doc["code"] | 0;
+    SubDeviceState pending = isLogin ? SUB_LOGIN_PENDING : SUB_LOGOUT_PENDING;
+    for (auto it = subDevices.begin(); it != subDevices.end(); ++it) {
+        if (it->state != pending || id == nullptr || it->requestId != id) {
+            continue;
+        }
+        it->requestId = "";
+
+        if (code != 200) {
+            Serial.println("子设备 " + it->name + (isLogin ? " 登录" : " 登出") + "失败: " + String(doc["msg"] | ""));
+            // 登录失败按GATEWAY_LOGIN_RETRY重试，登出失败保持在线
+            it->state = isLogin ? SUB_OFFLINE : SUB_ONLINE;
+            it->requestTime = millis();
+            return;
+        }
+
+        if (isLogin) {
+            it->state = SUB_ONLINE;
+            Serial.println("子设备已登录: " + it->name);
+        } else if (!it->wantOnline) {
+            Serial.println("子设备已登出并移除: " + it->name);
+            subDevices.erase(it);
+        } else {
+            // 登出期间又收到了该子设备的数据，重新登录
+            it->state = SUB_OFFLINE;
+        }
+        return;
+    }
+}
+
+bool Gateway::isOnline(const char* name) {
+    SubDevice* dev = find(name);
+    return dev != nullptr && dev->state == SUB_ONLINE;
+}
+
+size_t Gateway::getOnlineCount() const {
+    size_t count = 0;
+    for (const auto& dev : subDevices) {
+        if (dev.state == SUB_ONLINE) {
+            count++;
+        }
+    }
+    return count;
+}
+
+unsigned long Gateway::getNextDeadlineIn(unsigned long now) const {
+    unsigned long next = POWER_NO_DEADLINE;
+    if (!connected) {
+        return next;
+    }
+    for (const auto& dev : subDevices) {
+        unsigned long due = POWER_NO_DEADLINE;
+        if (dev.state == SUB_ONLINE && dev.sampleCount > 0) {
+            due = PowerManager::timeUntil(dev.batchStartTime, Settings::get(CFG_STREAM_BATCH_MAX_LATENCY), now);
+        } else if (dev.state == SUB_LOGIN_PENDING || dev.state == SUB_LOGOUT_PENDING) {
+            due = PowerManager::timeUntil(dev.requestTime, GATEWAY_LOGIN_TIMEOUT, now);
+        } else if (dev.state == SUB_OFFLINE && dev.wantOnline) {
+            due = PowerManager::timeUntil(dev.requestTime, GATEWAY_LOGIN_RETRY, now);
+        }
+        if (due < next) {
+            next = due;
+        }
+    }
+    return next;
+}
@@ -0,0 +1,84 @@
+#include <Metrics.h>
+#include <Settings.h>
+
+// 指标注册表
+struct MetricInfo {
+    ThingPropertyId id;
+    MetricKind kind;
+};
+
+static const MetricInfo METRIC_REGISTRY[] = {
+    {TP_Pub_Count, METRIC_COUNTER},
+    {TP_Pub_Fail, METRIC_COUNTER},
+    {TP_Queue_Depth, METRIC_GAUGE},
+    {TP_Drop_Count, METRIC_GAUGE},
+    {TP_Reconnects, METRIC_COUNTER},
+    {TP_Heap_Min, METRIC_LOW_WATER},
+    {TP_RSSI, METRIC_GAUGE},
+    {TP_Loop_Time, METRIC_PEAK},
+};
+
+int32_t Metrics::values[TP_COUNT] = {0};
+bool Metrics::seen[TP_COUNT] = {false};
+unsigned long Metrics::lastReport = 0;
+
+MetricKind Metrics::kindOf(ThingPropertyId id, bool& registered) {
+    for (const auto& info : METRIC_REGISTRY) {
+        if (info.id == id) {
+            registered = true;
+            return info.kind;
+        }
+    }
+    registered = false;
+    return METRIC_GAUGE;
+}
+
+void Metrics::add(ThingPropertyId id, int32_t delta) {
+    if (id < TP_COUNT) {
+        values[id] += delta;
+    }
+}
+
+void Metrics::set(ThingPropertyId id, int32_t value) {
+    bool registered;
+    MetricKind kind = kindOf(id, registered);
+    if (!registered) {
+        return;
+    }
+
+    if (kind == METRIC_LOW_WATER || kind == METRIC_PEAK) {
+        bool better = kind == METRIC_LOW_WATER ? value < values[id] : value > values[id];
+        if (seen[id] && !better) {
+            return;
+        }
+        seen[id] = true;
+    }
+    values[id] = value;
+}
+
+int32_t Metrics::get(ThingPropertyId id) {
+    return id < TP_COUNT ? values[id] : 0;
+}
+
+bool Metrics::isDue(unsigned long now, unsigned long window) {
+    unsigned long interval = Settings::get(CFG_HEARTBEAT_INTERVAL);
+    unsigned long threshold = window < interval ? interval - window : 0;
+    return now - lastReport >= threshold;
+}
+
+unsigned long Metrics::getNextDueIn(unsigned long now) {
+    unsigned long elapsed = now - lastReport;
+    unsigned long interval = Settings::get(CFG_HEARTBEAT_INTERVAL);
+    return elapsed >= interval ? 0 : interval - elapsed;
+}
+
+void Metrics::collect(ThingProperties& props, unsigned long now) {
+    for (const auto& info : METRIC_REGISTRY) {
+        thingSetInt(props, info.id, values[info.id]);
+        if (info.kind == METRIC_PEAK) {
+            values[info.id] = 0;
+            seen[info.id] = false;
+        }
+    }
+    lastReport = now;
+}
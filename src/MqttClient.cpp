@@ -0,0 +1,232 @@
+#include <MqttClient.h>
+
+MqttClient::MqttClient(MqttTransport& mqttTransport, size_t rxBufferSize)
+    : transport(mqttTransport), decoder(rxBufferSize) {
+    host = nullptr;
+    port = 0;
+    keepAlive = MQTT_KEEPALIVE_MAX;
+    state = MQTT_DISCONNECTED;
+    pingOutstanding = false;
+    lastInActivity = 0;
+    lastOutActivity = 0;
+    nextPacketId = 0;
+    rxPacketCount = 0;
+}
+
+bool MqttClient::write(const MqttIoVec* iov, size_t count) {
+    if (!transport.writev(iov, count)) {
+        return false;
+    }
+    lastOutActivity = millis();
+    return true;
+}
+
+bool MqttClient::writePacket(const uint8_t* data, size_t length) {
+    MqttIoVec iov = {data, length};
+    return write(&iov, 1);
+}
+
+bool MqttClient::connect(const char* clientId, const char* user, const char* pass, bool cleanSession) {
+    if (connected()) {
+        return true;
+    }
+    if (host == nullptr || !transport.open(host, port)) {
+        state = MQTT_CONNECT_FAILED;
+        return false;
+    }
+
+    decoder.reset();
+    pingOutstanding = false;
+    packet.clear();
+    mqttEncodeConnect(packet, clientId, user, pass, keepAlive, cleanSession);
+    if (!writePacket(packet.data(), packet.size())) {
+        transport.close();
+        state = MQTT_CONNECT_FAILED;
+        return false;
+    }
+
+    // 服务器在CONNACK之前不会发送其他报文
+    unsigned long start = millis();
+    while (millis() - start < MQTT_CONNECT_TIMEOUT) {
+        if (!transport.isOpen()) {
+            state = MQTT_CONNECTION_LOST;
+            return false;
+        }
+        size_t space;
+        uint8_t* dst = decoder.writePointer(space);
+        int available = transport.available();
+        if (available > 0 && space > 0) {
+            int n = transport.read(dst, (size_t)available < space ? available : space);
+            if (n > 0) {
+                decoder.commit(n);
+            }
+        }
+
+        MqttPacket ack;
+        MqttDecodeStatus status = decoder.next(ack);
+        if (status == MQTT_DECODE_ERROR) {
+            break;
+        }
+        if (status == MQTT_DECODE_PACKET && ack.type == MQTT_PACKET_CONNACK && ack.length >= 2) {
+            if (ack.body[1] != 0) {
+                transport.close();
+                state = ack.body[1];
+                return false;
+            }
+            lastInActivity = millis();
+            lastOutActivity = lastInActivity;
+            state = MQTT_CONNECTED;
+            return true;
+        }
+        delay(10);
+    }
+
+    transport.close();
+    state = MQTT_CONNECTION_TIMEOUT;
+    return false;
+}
+
+void MqttClient::disconnect() {
+    if (connected()) {
+        uint8_t buf[2];
+        writePacket(buf, mqttEncodeEmpty(buf, MQTT_PACKET_DISCONNECT));
+    }
+    transport.close();
+    state = MQTT_DISCONNECTED;
+}
+
+bool MqttClient::connected() {
+    if (state != MQTT_CONNECTED) {
+        return false;
+    }
+    if (!transport.isOpen()) {
+        transport.close();
+        state = MQTT_CONNECTION_LOST;
+        return false;
+    }
+    return true;
+}
+
+bool MqttClient::loop() {
+    if (!connected()) {
+        return false;
+    }
+
+    drain();
+    if (state != MQTT_CONNECTED) {
+        return false;
+    }
+
+    // 保活：一个保活周期内无收发时发送PINGREQ，再过一个周期仍无PINGRESP则判定超时
+    unsigned long now = millis();
+    unsigned long interval = keepAlive * 1000UL;
+    if (keepAlive > 0 && (now - lastInActivity > interval || now - lastOutActivity > interval)) {
+        if (pingOutstanding) {
+            transport.close();
+            state = MQTT_CONNECTION_TIMEOUT;
+            return false;
+        }
+        uint8_t buf[2];
+        if (writePacket(buf, mqttEncodeEmpty(buf, MQTT_PACKET_PINGREQ))) {
+            // 从发出PINGREQ起重新计时，等待PINGRESP最长一个保活周期
+            lastInActivity = now;
+            pingOutstanding = true;
+        }
+    }
+    return true;
+}
+
+void MqttClient::drain() {
+    while (true) {
+        // 先读满环形缓冲区，再依次处理其中所有完整报文
+        bool received = false;
+        int available;
+        while ((available = transport.available()) > 0) {
+            size_t space;
+            uint8_t* dst = decoder.writePointer(space);
+            if (space == 0) {
+                break;
+            }
+            int n = transport.read(dst, (size_t)available < space ? available : space);
+            if (n <= 0) {
+                break;
+            }
+            decoder.commit(n);
+            received = true;
+        }
+
+        MqttPacket inbound;
+        MqttDecodeStatus status;
+        while ((status = decoder.next(inbound)) == MQTT_DECODE_PACKET) {
+            lastInActivity = millis();
+            rxPacketCount++;
+            handlePacket(inbound);
+        }
+        if (status == MQTT_DECODE_ERROR) {
+            Serial.println("MQTT报文格式错误，断开连接");
+            transport.close();
+            state = MQTT_CONNECTION_LOST;
+            return;
+        }
+        if (!received) {
+            return;
+        }
+    }
+}
+
+void MqttClient::handlePacket(MqttPacket& inbound) {
+    switch (inbound.type) {
+        case MQTT_PACKET_PUBLISH:
+            if (messageCallback) {
+                messageCallback(inbound.topic, inbound.payload, inbound.payloadLength);
+            }
+            if (((inbound.flags >> 1) & 0x03) == 1) {
+                uint8_t buf[4];
+                writePacket(buf, mqttEncodeAck(buf, MQTT_PACKET_PUBACK, inbound.packetId));
+            }
+            break;
+        case MQTT_PACKET_PUBACK:
+            if (ackCallback) {
+                ackCallback(inbound.packetId);
+            }
+            break;
+        case MQTT_PACKET_SUBACK:
+            for (uint32_t i = 2; i < inbound.length; i++) {
+                if (inbound.body[i] == 0x80) {
+                    Serial.println("订阅被服务器拒绝 (packet id " + String(inbound.packetId) + ")");
+                    break;
+                }
+            }
+            break;
+        case MQTT_PACKET_PINGREQ: {
+            uint8_t buf[2];
+            writePacket(buf, mqttEncodeEmpty(buf, MQTT_PACKET_PINGRESP));
+            break;
+        }
+        case MQTT_PACKET_PINGRESP:
+            pingOutstanding = false;
+            break;
+        default:
+            break;
+    }
+}
+
+bool MqttClient::publish(const char* topic, const uint8_t* payload, size_t length,
+                         uint8_t qos, bool dup, uint16_t packetId) {
+    if (!connected()) {
+        return false;
+    }
+    MqttPublishFrame frame;
+    mqttBuildPublish(frame, topic, payload, length, qos, dup, packetId);
+    return write(frame.iov, frame.count);
+}
+
+bool MqttClient::subscribe(const char* const* topics, size_t count, uint8_t qos) {
+    if (!connected() || count == 0) {
+        return false;
+    }
+    nextPacketId = nextPacketId >= 0x7FFF ? 1 : nextPacketId + 1;
+    packet.clear();
+    mqttEncodeSubscribe(packet, nextPacketId, topics, count, qos);
+    return writePacket(packet.data(), packet.size());
+}
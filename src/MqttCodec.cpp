@@ -0,0 +1,270 @@
+#include <MqttCodec.h>
+#include <string.h>
+#include <algorithm>
+
+/*=====================编码========================*/
+
+size_t mqttWriteRemainingLength(uint8_t* out, uint32_t length) {
+    size_t pos = 0;
+    do {
+        uint8_t b = length & 0x7F;
+        length >>= 7;
+        out[pos++] = length > 0 ? (b | 0x80) : b;
+    } while (length > 0);
+    return pos;
+}
+
+void mqttBuildPublish(MqttPublishFrame& frame, const char* topic, const uint8_t* payload, size_t length,
+                      uint8_t qos, bool dup, uint16_t packetId) {
+    size_t topicLength = strlen(topic);
+    uint32_t remaining = 2 + topicLength + (qos > 0 ? 2 : 0) + length;
+
+    uint8_t flags = (qos & 0x03) << 1;
+    if (dup) {
+        flags |= 0x08;
+    }
+    frame.header[0] = (MQTT_PACKET_PUBLISH << 4) | flags;
+    size_t headerLength = 1 + mqttWriteRemainingLength(frame.header + 1, remaining);
+    frame.header[headerLength++] = topicLength >> 8;
+    frame.header[headerLength++] = topicLength & 0xFF;
+
+    frame.count = 0;
+    frame.iov[frame.count++] = {frame.header, headerLength};
+    frame.iov[frame.count++] = {(const uint8_t*)topic, topicLength};
+    if (qos > 0) {
+        frame.packetId[0] = packetId >> 8;
+        frame.packetId[1] = packetId & 0xFF;
+        frame.iov[frame.count++] = {frame.packetId, 2};
+    }
+    if (length > 0) {
+        frame.iov[frame.count++] = {payload, length};
+    }
+}
+
+static void appendFixedHeader(std::vector<uint8_t>& out, uint8_t header, uint32_t remaining) {
+    uint8_t buf[5];
+    buf[0] = header;
+    size_t n = 1 + mqttWriteRemainingLength(buf + 1, remaining);
+    out.insert(out.end(), buf, buf + n);
+}
+
+static void appendString(std::vector<uint8_t>& out, const char* str) {
+    size_t length = strlen(str);
+    out.push_back(length >> 8);
+    out.push_back(length & 0xFF);
+    out.insert(out.end(), (const uint8_t*)str, (const uint8_t*)str + length);
+}
+
+void mqttEncodeConnect(std::vector<uint8_t>& out, const char* clientId, const char* user, const char* pass,
+                       uint16_t keepAlive, bool cleanSession) {
+    uint32_t remaining = 10 + 2 + strlen(clientId);
+    uint8_t connectFlags = cleanSession ? 0x02 : 0x00;
+    if (user != nullptr) {
+        remaining += 2 + strlen(user);
+        connectFlags |= 0x80;
+        if (pass != nullptr) {
+            remaining += 2 + strlen(pass);
+            connectFlags |= 0x40;
+        }
+    }
+
+    out.reserve(out.size() + remaining + 5);
+    appendFixedHeader(out, MQTT_PACKET_CONNECT << 4, remaining);
+    static const uint8_t protocol[] = {0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04};
+    out.insert(out.end(), protocol, protocol + sizeof(protocol));
+    out.push_back(connectFlags);
+    out.push_back(keepAlive >> 8);
+    out.push_back(keepAlive & 0xFF);
+    appendString(out, clientId);
+    if (user != nullptr) {
+        appendString(out, user);
+        if (pass != nullptr) {
+            appendString(out, pass);
+        }
+    }
+}
+
+void mqttEncodeSubscribe(std::vector<uint8_t>& out, uint16_t packetId, const char* const* topics, size_t count,
+                         uint8_t qos) {
+    uint32_t remaining = 2;
+    for (size_t i = 0; i < count; i++) {
+        remaining += 2 + strlen(topics[i]) + 1;
+    }
+
+    out.reserve(out.size() + remaining + 5);
+    appendFixedHeader(out, (MQTT_PACKET_SUBSCRIBE << 4) | 0x02, remaining); // 固定报头标志位为0010
+    out.push_back(packetId >> 8);
+    out.push_back(packetId & 0xFF);
+    for (size_t i = 0; i < count; i++) {
+        appendString(out, topics[i]);
+        out.push_back(qos);
+    }
+}
+
+size_t mqttEncodeAck(uint8_t* out, MqttPacketType type, uint16_t packetId) {
+    out[0] = type << 4;
+    out[1] = 2;
+    out[2] = packetId >> 8;
+    out[3] = packetId & 0xFF;
+    return 4;
+}
+
+size_t mqttEncodeEmpty(uint8_t* out, MqttPacketType type) {
+    out[0] = type << 4;
+    out[1] = 0;
+    return 2;
+}
+
+/*=====================解码========================*/
+
+MqttDecoder::MqttDecoder(size_t size) {
+    capacity = size;
+    ring = new uint8_t[capacity];
+    reset();
+    oversizeCount = 0;
+}
+
+MqttDecoder::~MqttDecoder() {
+    delete[] ring;
+}
+
+void MqttDecoder::reset() {
+    head = 0;
+    count = 0;
+    skipRemaining = 0;
+}
+
+void MqttDecoder::drop(size_t n) {
+    head = (head + n) % capacity;
+    count -= n;
+}
+
+uint8_t* MqttDecoder::writePointer(size_t& space) {
+    if (count == 0) {
+        head = 0; // 缓冲区已空，从头写入以获得最大的连续空间
+    }
+    size_t tail = (head + count) % capacity;
+    if (count == capacity) {
+        space = 0;
+    } else if (tail >= head) {
+        space = capacity - tail;
+    } else {
+        space = head - tail;
+    }
+    return ring + tail;
+}
+
+void MqttDecoder::commit(size_t n) {
+    count += n;
+}
+
+size_t MqttDecoder::feed(const uint8_t* data, size_t length) {
+    size_t written = 0;
+    while (written < length) {
+        size_t space;
+        uint8_t* dst = writePointer(space);
+        if (space == 0) {
+            break;
+        }
+        size_t n = std::min(space, length - written);
+        memcpy(dst, data + written, n);
+        commit(n);
+        written += n;
+    }
+    return written;
+}
+
+MqttDecodeStatus MqttDecoder::next(MqttPacket& packet) {
+    while (true) {
+        if (skipRemaining > 0) {
+            size_t n = std::min((size_t)skipRemaining, count);
+            drop(n);
+            skipRemaining -= n;
+            if (skipRemaining > 0) {
+                return MQTT_DECODE_NEED_MORE;
+            }
+        }
+        if (count < 2) {
+            return MQTT_DECODE_NEED_MORE;
+        }
+
+        // 剩余长度最多4字节
+        uint32_t length = 0;
+        uint8_t shift = 0;
+        size_t pos = 1;
+        while (true) {
+            if (pos > 4) {
+                return MQTT_DECODE_ERROR;
+            }
+            if (pos >= count) {
+                return MQTT_DECODE_NEED_MORE;
+            }
+            uint8_t b = at(pos++);
+            length |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) {
+                break;
+            }
+            shift += 7;
+        }
+
+        size_t total = pos + length;
+        if (total > capacity) {
+            // 放不进缓冲区的报文整体跳过，连接继续可用
+            oversizeCount++;
+            skipRemaining = total;
+            continue;
+        }
+        if (count < total) {
+            return MQTT_DECODE_NEED_MORE;
+        }
+        if (head + total > capacity) {
+            std::rotate(ring, ring + head, ring + capacity);
+            head = 0;
+        }
+
+        uint8_t* start = ring + head;
+        drop(total);
+
+        packet.type = start[0] >> 4;
+        packet.flags = start[0] & 0x0F;
+        packet.body = start + pos;
+        packet.length = length;
+        packet.packetId = 0;
+        packet.topic = nullptr;
+        packet.payload = nullptr;
+        packet.payloadLength = 0;
+
+        if (packet.type != MQTT_PACKET_PUBLISH) {
+            if (length >= 2 && (packet.type == MQTT_PACKET_PUBACK || packet.type == MQTT_PACKET_SUBACK ||
+                                packet.type == MQTT_PACKET_UNSUBACK)) {
+                packet.packetId = ((uint16_t)packet.body[0] << 8) | packet.body[1];
+            }
+            return MQTT_DECODE_PACKET;
+        }
+
+        if (length < 2) {
+            return MQTT_DECODE_ERROR;
+        }
+        uint8_t* body = packet.body;
+        uint16_t topicLength = ((uint16_t)body[0] << 8) | body[1];
+        uint32_t offset = 2 + topicLength;
+        uint8_t qos = (packet.flags >> 1) & 0x03;
+        if (qos > 0) {
+            if (offset + 2 > length) {
+                return MQTT_DECODE_ERROR;
+            }
+            packet.packetId = ((uint16_t)body[offset] << 8) | body[offset + 1];
+            offset += 2;
+        }
+        if (offset > length) {
+            return MQTT_DECODE_ERROR;
+        }
+        // 主题前移一字节覆盖长度字段，空出的最后一字节写入'\0'，供回调直接当C字符串使用
+        memmove(body + 1, body + 2, topicLength);
+        body[1 + topicLength] = '\0';
+        packet.topic = (char*)(body + 1);
+        packet.payload = body + offset;
+        packet.payloadLength = length - offset;
+        return MQTT_DECODE_PACKET;
+    }
+}
@@ -1,12 +1,29 @@
 #include <MqttHandler.h>
+#include <SerialHandler.h>
 #include <config.h>
+#include <TopicCache.h>
+#include <Gateway.h>
+#include <RuleEngine.h>
 //构造函数
 MqttHandler::MqttHandler(WiFiClient* client) {
     wifiClient = client;
-    mqttClient = new PubSubClient(*wifiClient);
+    transport = new WiFiMqttTransport(*wifiClient);
+    mqttClient = new MqttClient(*transport, MQTT_BUFFER_SIZE);
     propertySetCallback = nullptr;
+    connectCount = 0;
+    keepAlive = MQTT_KEEPALIVE_MAX;
+    keepAliveLimit = MQTT_KEEPALIVE_MAX;
+    sessionUp = false;
     lastPublishAttempt = 0;
     publishRetryCount = 0;
+    droppedMessageCount = 0;
+    telemetryRetryTime = 0;
+    serialHandler = nullptr;
+    gateway = nullptr;
+    ruleEngine = nullptr;
+    currentCommandSeq = 0;
+    currentResultCode = 0;
+    pendingLedState = -1;
 }
 //析构函数
 MqttHandler::~MqttHandler() {
@@ -14,13 +31,31 @@ MqttHandler::~MqttHandler() {
         delete mqttClient;
         mqttClient = nullptr;
     }
+    if (transport != nullptr) {
+        delete transport;
+        transport = nullptr;
+    }
 }
 //初始化MQTT连接
 bool MqttHandler::init() {
+    TopicCache::begin(PRODUCT_ID, DEVICE_ID);
     mqttClient->setServer(MQTT_SERVER, MQTT_PORT);
-    mqttClient->setCallback([this](char* topic, byte* payload, unsigned int length) {
+    mqttClient->setCallback([this](char* topic, uint8_t* payload, unsigned int length) {
         this->mqttCallback(topic, payload, length);
     });
+    mqttClient->setAckCallback([this](uint16_t packetId) {
+        this->inflight.ack(packetId);
+    });
+    // 运行参数在setup开始时已载入，这里应用到构造时按默认值创建的对象
+    inflight.setWindowSize(Settings::get(CFG_MQTT_QOS1_WINDOW));
+    shadow.begin();
+    // 用Flash中恢复的阈值编译本地规则，开机后未联网也能按上次的阈值动作
+    if (ruleEngine != nullptr) {
+        ruleEngine->compile(shadow.getReported());
+    }
+    // 属性影子相关主题：应答property/get，接收期望值
+    addSubscription(TopicCache::get(TOPIC_GET));
+    addSubscription(TopicCache::get(TOPIC_DESIRED_GET_REPLY));
     Serial.println("MQTT客户端初始化完成");
     return true;
 }
@@ -34,29 +69,105 @@ bool MqttHandler::connect(const char *topic) {
         return true;
     }
 
-    Serial.println("正在连接MQTT服务器...");
+    if (topic != nullptr) {
+        addSubscription(topic);
+    }
+
+    // 上一次会话因保活超时断开（多为NAT/运营商网关回收了空闲连接），缩短保活上限
+    if (sessionUp && mqttClient->getState() == MQTT_CONNECTION_TIMEOUT && keepAliveLimit > MQTT_KEEPALIVE_MIN) {
+        keepAliveLimit = keepAliveLimit / 2 > MQTT_KEEPALIVE_MIN ? keepAliveLimit / 2 : MQTT_KEEPALIVE_MIN;
+        Serial.println("上次会话保活超时，保活上限降为 " + String(keepAliveLimit) + "s");
+    }
+    sessionUp = false;
+    keepAlive = chooseKeepAlive(WiFi.RSSI());
+    mqttClient->setKeepAlive(keepAlive);
+
+    Serial.println("正在连接MQTT服务器... (保活 " + String(keepAlive) + "s)");
 
     String clientId = DEVICE_ID; // 使用设备ID作为客户端ID
-    if (mqttClient->connect(clientId.c_str(), USERNAME, PASSWORD)) {
+    // MQTT_CLEAN_SESSION为0时使用持久会话，重连后重发的QoS1消息由服务器按packet id去重
+    if (mqttClient->connect(clientId.c_str(), USERNAME, PASSWORD, MQTT_CLEAN_SESSION)) {
         Serial.println("MQTT连接成功!");
+        sessionUp = true;
+        if (connectCount > 0) {
+            Metrics::add(TP_Reconnects);
+        }
+        connectCount++;
 
-        if (mqttClient->subscribe(topic)) {
-            Serial.println("成功订阅主题: " + String(topic));
-        } else {
-            Serial.println("订阅主题失败: " + String(topic));
+        restoreSubscriptions();
+#if MQTT_PUBLISH_QOS == 1
+        inflight.resendAll(*mqttClient, millis());
+#endif
+        requestDesiredProperties();
+        if (gateway != nullptr) {
+            gateway->onConnected();
         }
 
         return true;
     } else {
         Serial.print("MQTT连接失败，状态码: ");
-        Serial.println(mqttClient->state());
+        Serial.println(mqttClient->getState());
         return false;
     }
 }
+//按信号强度选择保活时间：信号好时延长以减少唤醒和流量，信号差时缩短以尽快发现断链
+uint16_t MqttHandler::chooseKeepAlive(int32_t rssi) {
+    uint16_t value;
+    if (rssi >= MQTT_RSSI_GOOD) {
+        value = MQTT_KEEPALIVE_MAX;
+    } else if (rssi >= MQTT_RSSI_WEAK) {
+        value = (MQTT_KEEPALIVE_MAX + MQTT_KEEPALIVE_MIN) / 2;
+    } else {
+        value = MQTT_KEEPALIVE_MIN;
+    }
+    return value < keepAliveLimit ? value : keepAliveLimit;
+}
+//加入订阅列表（按内容去重，主题宏在不同源文件中的地址可能不同）
+void MqttHandler::addSubscription(const char* topic) {
+    for (const char* existing : subscriptions) {
+        if (strcmp(existing, topic) == 0) {
+            return;
+        }
+    }
+    subscriptions.push_back(topic);
+}
+//用一个SUBSCRIBE报文恢复全部订阅，只需一次往返
+bool MqttHandler::restoreSubscriptions() {
+    if (subscriptions.empty()) {
+        return true;
+    }
+    bool ok = mqttClient->subscribe(subscriptions.data(), subscriptions.size());
+    Serial.println(String(ok ? "已恢复 " : "恢复订阅失败: ") + String(subscriptions.size()) + " 个主题订阅");
+    return ok;
+}
 //保持MQTT心跳
 void MqttHandler::loop() {
     mqttClient->loop();
+#if MQTT_PUBLISH_QOS == 1
+    if (mqttClient->connected()) {
+        inflight.checkTimeouts(*mqttClient, millis());
+    }
+#endif
     processMessageQueue();
+    processTelemetryQueue();
+}
+//距下一个定时事件的时间，供低功耗管理器决定休眠时长
+unsigned long MqttHandler::getNextDeadlineIn(unsigned long now) const {
+    // 每1/3保活周期调用一次loop()，PINGREQ最迟在1.33倍保活周期内发出，服务器1.5倍后才断开
+    unsigned long next = keepAlive * 1000UL / 3;
+    for (const auto& msg : messageQueue) {
+        unsigned long due = msg.nextAttemptTime > now ? msg.nextAttemptTime - now : 0;
+        if (due < next) {
+            next = due;
+        }
+    }
+#if MQTT_PUBLISH_QOS == 1
+    unsigned long due = inflight.getNextDeadlineIn(now);
+    if (due < next) {
+        next = due;
+    }
+#endif
+    return next;
 }
 //处理消息队列
 void MqttHandler::processMessageQueue() {
@@ -69,19 +180,27 @@ void MqttHandler::processMessageQueue() {
     // 从队列尾部开始处理（FIFO）
     for (auto it = messageQueue.begin(); it != messageQueue.end(); ) {
         if (currentTime >= it->nextAttemptTime) {
-            bool success = mqttClient->publish(it->topic.c_str(), it->payload.c_str());
+#if MQTT_PUBLISH_QOS == 1
+            if (inflight.isFull()) {
+                break; // 发送窗口已满，等待PUBACK
+            }
+#endif
+            bool success = sendPublish(it->topic.c_str(), it->payload.c_str());
 
             if (success) {
                 Serial.println("队列消息发布成功: " + it->topic);
                 it = messageQueue.erase(it);
             } else {
+                Metrics::add(TP_Pub_Fail);
                 it->retryCount++;
-                if (it->retryCount >= MAX_RETRY_COUNT) {
+                if (it->retryCount >= Settings::get(CFG_MAX_RETRY_COUNT)) {
                     Serial.println("队列消息发布失败（已达最大重试次数）: " + it->topic);
+                    droppedMessageCount++;
                     it = messageQueue.erase(it);
                 } else {
-                    it->nextAttemptTime = currentTime + 5000; // 5秒后重试
-                    Serial.println("队列消息发布失败，将在5秒后重试: " + it->topic + " (重试: " + String(it->retryCount) + ")");
+                    unsigned long retryDelay = Settings::get(CFG_MQTT_RETRY_DELAY);
+                    it->nextAttemptTime = currentTime + retryDelay;
+                    Serial.println("队列消息发布失败，将在" + String(retryDelay) + "ms后重试: " + it->topic + " (重试: " + String(it->retryCount) + ")");
                     ++it;
                 }
             }
@@ -90,13 +209,83 @@ void MqttHandler::processMessageQueue() {
         }
     }
 }
+//依次展开排队的属性上报并发送，每轮最多TELEMETRY_DRAIN_PER_LOOP（运行参数）条
+void MqttHandler::processTelemetryQueue() {
+    if (telemetryQueue.empty() || !mqttClient->connected() || (long)(millis() - telemetryRetryTime) < 0) {
+        return;
+    }
+
+    ThingProperties props;
+    String payload;
+    int drainLimit = Settings::get(CFG_TELEMETRY_DRAIN_PER_LOOP);
+    for (int i = 0; i < drainLimit && !telemetryQueue.empty(); i++) {
+#if MQTT_PUBLISH_QOS == 1
+        if (inflight.isFull()) {
+            break; // 发送窗口已满，等待PUBACK
+        }
+#endif
+        if (!telemetryQueue.peek(props)) {
+            Serial.println("警告: 属性上报队列记录损坏，丢弃 " + String(telemetryQueue.size()) + " 条");
+            droppedMessageCount += telemetryQueue.size();
+            telemetryQueue.clear();
+            break;
+        }
+        thingSerializePost(props, TopicCache::nextId(), payload);
+        if (!sendPublish(TopicCache::get(TOPIC_POST), payload.c_str())) {
+            Metrics::add(TP_Pub_Fail);
+            telemetryRetryTime = millis() + 2000;
+            break;
+        }
+        telemetryQueue.pop(payload.length());
+        if (telemetryQueue.empty()) {
+            Serial.println("排队的属性上报已全部发送 (压缩比 " + String(telemetryQueue.getRatioX10() / 10.0, 1) + ")");
+        }
+    }
+}
+//按重传队列与属性上报队列中较高者计算填充率
+int MqttHandler::getQueueLevel() const {
+    int level = messageQueue.size() * 100 / getQueueCapacity();
+    int telemetryLevel = telemetryQueue.getBytes() * 100 / telemetryQueue.getCapacity();
+    return telemetryLevel > level ? telemetryLevel : level;
+}
+//按MQTT_PUBLISH_QOS发送：QoS0写出即成功，QoS1进入发送窗口，收到PUBACK后才计为发布成功
+bool MqttHandler::sendPublish(const char* topic, const char* payload) {
+#if MQTT_PUBLISH_QOS == 1
+    if (!mqttClient->connected()) {
+        return false;
+    }
+    return inflight.publish(*mqttClient, topic, payload, millis());
+#else
+    if (!mqttClient->publish(topic, (const uint8_t*)payload, strlen(payload))) {
+        return false;
+    }
+    Metrics::add(TP_Pub_Count);
+    return true;
+#endif
+}
+//加入重传队列，队列已满时丢弃
+bool MqttHandler::enqueueMessage(const char* topic, const char* payload, unsigned long delayMs) {
+    if (messageQueue.size() >= getQueueCapacity()) {
+        Serial.println("警告: 消息队列已满，丢弃消息: " + String(topic));
+        droppedMessageCount++;
+        return false;
+    }
+    PendingMessage msg;
+    msg.topic = String(topic);
+    msg.payload = String(payload);
+    msg.retryCount = 0;
+    msg.nextAttemptTime = millis() + delayMs;
+    messageQueue.push_back(msg);
+    return true;
+}
 //发布消息到指定主题
 bool MqttHandler::publish(const char* topic, const char* payload, bool queued) {
     if (!mqttClient->connected()) {
         // 如果未连接且允许队列模式，加入队列
         if (queued) {
-            if (messageQueue.size() >= MAX_QUEUE_SIZE) {
+            if (messageQueue.size() >= getQueueCapacity()) {
                 Serial.println("警告: 消息队列已满，丢弃消息: " + String(topic));
+                droppedMessageCount++;
                 return false;
             }
             PendingMessage msg;
@@ -111,15 +300,34 @@ bool MqttHandler::publish(const char* topic, const char* payload, bool queued) {
         return false;
     }
 
-    bool result = mqttClient->publish(topic, payload);
+#if MQTT_PUBLISH_QOS == 1
+    if (inflight.isFull()) {
+        // 发送窗口已满时直接排队，由loop()在PUBACK到达后发送，不在此阻塞等待
+        return enqueueMessage(topic, payload, 0);
+    }
+#endif
+
+    bool result = sendPublish(topic, payload);
     if (result) {
-        Serial.println("MQTT发布成功 [" + String(topic) + "]: " + String(payload));
+        // 分段输出日志，避免为每条消息拼接临时String
+#if MQTT_PUBLISH_QOS == 1
+        Serial.print(F("MQTT已发送，等待PUBACK ["));
+#else
+        Serial.print(F("MQTT发布成功 ["));
+#endif
+        Serial.print(topic);
+        Serial.print(F("]: "));
+        Serial.println(payload);
         publishRetryCount = 0;
     } else {
-        Serial.println("MQTT发布失败 [" + String(topic) + "]: " + String(payload));
+        Serial.print(F("MQTT发布失败 ["));
+        Serial.print(topic);
+        Serial.print(F("]: "));
+        Serial.println(payload);
+        Metrics::add(TP_Pub_Fail);
 
         // 失败时加入队列
-        if (messageQueue.size() < MAX_QUEUE_SIZE) {
+        if (messageQueue.size() < getQueueCapacity()) {
             PendingMessage msg;
             msg.topic = String(topic);
             msg.payload = String(payload);
@@ -129,10 +337,14 @@ bool MqttHandler::publish(const char* topic, const char* payload, bool queued) {
             Serial.println("消息已加入重传队列: " + String(topic));
         } else {
             Serial.println("警告: 消息队列已满，丢弃消息: " + String(topic));
+            droppedMessageCount++;
         }
 
         if (publishRetryCount < 3) {
             publishRetryCount++;
+            if (serialHandler != nullptr) {
+                serialHandler->updateFlowControl();
+            }
             delay(1000);
             return publish(topic, payload, false);
         } else {
@@ -144,10 +356,11 @@ bool MqttHandler::publish(const char* topic, const char* payload, bool queued) {
 //订阅主题
 bool MqttHandler::subscribe(const char* topic)
 {
+    addSubscription(topic);
     if (!mqttClient->connected()) {
         return false;
     }
-    if(mqttClient->subscribe(topic)){
+    if(mqttClient->subscribe(&topic, 1)){
         Serial.println("成功订阅主题: " + String(topic));
         return true;
     }
@@ -168,63 +381,114 @@ void MqttHandler::sendHeartbeat() {
         return;
     }
 
-    StaticJsonDocument<256> doc;
-    doc["device_id"] = DEVICE_ID;
-    doc["status"] = "online";
-    doc["timestamp"] = millis();
+    ThingProperties props;
+    collectMetrics(props);
+    shadow.report(props);
 
     String message;
-    serializeJson(doc, message);
-
-    publish(PUB_post_TOPIC, message.c_str());
+    thingSerializePost(props, TopicCache::nextId(), message);
+    publish(TopicCache::get(TOPIC_POST), message.c_str());
+}
+//采样当前状态类指标，连同计数器一起写入props
+void MqttHandler::collectMetrics(ThingProperties& props) {
+    unsigned long drops = getDroppedMessageCount();
+    if (serialHandler != nullptr) {
+        drops += serialHandler->getDroppedLineCount();
+    }
+    Metrics::set(TP_Queue_Depth, messageQueue.size() + telemetryQueue.size());
+    Metrics::set(TP_Drop_Count, drops);
+    Metrics::set(TP_RSSI, WiFi.RSSI());
+    Metrics::set(TP_Heap_Min, ESP.getFreeHeap());
+    Metrics::collect(props, millis());
 }
 
 /*=======================OneNET回调处理========================*/
 
-//发送设备属性设置响应
-void MqttHandler::sendPropertySetResponse(const String& requestId, int code, const String& message) {
-    StaticJsonDocument<512> responseDoc;
+// thingVisit的访问器：按物模型类型转发到MqttHandler，并记录每个属性对应的STM32命令
+struct ThingApplyVisitor {
+    MqttHandler* handler;
+    PendingSetReply* reply;
 
-    if (requestId.length() > 0) {
-        responseDoc["id"] = requestId;
-    } else {
-        responseDoc["id"] = String(millis());
-    }
+    template <class T>
+    void operator()(ThingPropertyId id, const T& value) {
+        handler->currentCommandSeq = 0;
+        handler->currentResultCode = 0;
+        handler->currentResultMessage = "";
+        handler->applyThingProperty(id, value);
 
-    responseDoc["code"] = code;
+        for (auto& result : reply->results) {
+            if (result.name == THING_PROPERTIES[id].key) {
+                if (handler->currentResultCode != 0) {
+                    result.code = handler->currentResultCode;
+                }
+                result.seq = handler->currentCommandSeq;
+                break;
+            }
+        }
+        if (handler->currentResultMessage.length() > 0) {
+            reply->message = handler->currentResultMessage;
+        }
+    }
+};
 
-    if (code == 200) {
-        responseDoc["message"] = "success";
+//发送设备属性设置响应，results不为空时附带每个属性的结果码
+void MqttHandler::sendPropertySetResponse(const String& requestId, int code, const char* message,
+                                          const std::vector<PropertySetResult>* results, TopicId replyTopic) {
+    String responsePayload;
+    responsePayload.reserve(48 + requestId.length() + (results ? results->size() * 24 : 0));
 
-        JsonObject data = responseDoc.createNestedObject("data");
-        data["result"] = message;
+    responsePayload += "{\"id\":";
+    thingAppendJsonString(responsePayload, requestId.length() > 0 ? requestId.c_str() : TopicCache::nextId());
+    responsePayload += ",\"code\":";
+    responsePayload += code;
+    responsePayload += ",\"msg\":";
+    thingAppendJsonString(responsePayload, message);
 
-        JsonObject deviceStatus = data.createNestedObject("deviceStatus");
-        deviceStatus["设备名称"] = "我的ESP8266设备";
-        deviceStatus["uptime"] = millis() / 1000;
-        deviceStatus["freeHeap"] = ESP.getFreeHeap();
-    } else {
-        responseDoc["message"] = message;
+    if (results != nullptr && !results->empty()) {
+        responsePayload += ",\"data\":{";
+        for (size_t i = 0; i < results->size(); i++) {
+            if (i > 0) {
+                responsePayload += ',';
+            }
+            thingAppendJsonString(responsePayload, (*results)[i].name.c_str());
+            responsePayload += ':';
+            responsePayload += (*results)[i].code;
+        }
+        responsePayload += '}';
     }
-
-    String responsePayload;
-    serializeJson(responseDoc, responsePayload);
+    responsePayload += '}';
 
     Serial.println("\r\n");
     Serial.println("开始发送设备属性设置响应...");
 
-    publish(PUB_set_reply_TOPIC, responsePayload.c_str());
+    requestCache.complete(requestId, replyTopic, responsePayload);
+    publish(TopicCache::get(replyTopic), responsePayload.c_str());
+}
+//重复的属性设置请求不再执行：已响应的直接返回原响应，仍在等待STM32确认的忽略（确认后统一响应）
+bool MqttHandler::replayDuplicate(const String& requestId, TopicId replyTopic) {
+    const CachedReply* cached = requestCache.checkDuplicate(requestId, replyTopic);
+    if (cached == nullptr) {
+        return false;
+    }
+    Serial.println("重复的属性设置请求 id=" + requestId + "，不再执行 (累计 " +
+                   String(requestCache.getDuplicateCount()) + " 次)");
+    if (cached->reply.length() > 0) {
+        publish(TopicCache::get(replyTopic), cached->reply.c_str());
+    }
+    return true;
 }
 //MQTT消息回调函数
-void MqttHandler::mqttCallback(char* topic, byte* payload, unsigned int length) {
+void MqttHandler::mqttCallback(char* topic, uint8_t* payload, unsigned int length) {
 
     String topicStr = String(topic);
     String payloadStr = "";
 
-    for (unsigned int i = 0; i < length && i < MAX_MESSAGE_LENGTH; i++) {
+    // 日志与用户回调只保留前MAX_MESSAGE_LENGTH字节，属性设置使用完整负载
+    unsigned int maxLength = Settings::get(CFG_MAX_MESSAGE_LENGTH);
+    for (unsigned int i = 0; i < length && i < maxLength; i++) {
         payloadStr += (char)payload[i];
     }
-    if (length > MAX_MESSAGE_LENGTH) {
+    if (length > maxLength) {
         payloadStr += "...(消息过长，已截断)";
     }
     Serial.print("收到消息【");
@@ -237,19 +501,45 @@ void MqttHandler::mqttCallback(char* topic, byte* payload, unsigned int length)
     propertySetCallback(topicStr,payloadStr);
     }
     //是否是属性设置回调
-    if (strcmp(topic, SUB_set_TOPIC) == 0) {
-    handlePropertySetCommand(topicStr,payloadStr);
+    TopicId topicId = TopicCache::match(topic);
+    switch (topicId) {
+        case TOPIC_SET:
+            handlePropertySetCommand((char*)payload, length);
+            break;
+        case TOPIC_GET:
+            handlePropertyGetCommand((char*)payload, length);
+            break;
+        case TOPIC_DESIRED_GET_REPLY:
+            handleDesiredGetReply((char*)payload, length);
+            break;
+        case TOPIC_SUB_SET:
+            handleSubPropertySetCommand((char*)payload, length);
+            break;
+        case TOPIC_SUB_LOGIN_REPLY:
+        case TOPIC_SUB_LOGOUT_REPLY:
+            if (gateway != nullptr) {
+                gateway->handleLoginReply((const char*)payload, length, topicId == TOPIC_SUB_LOGIN_REPLY);
+            }
+            break;
+        default:
+            break;
     }
 }
-//处理设备属性设置指令
-void MqttHandler::handlePropertySetCommand(const String& topic, const String& payload) {
+//处理设备属性设置指令：先整体校验，再批量应用，最后响应
+void MqttHandler::handlePropertySetCommand(char* payload, unsigned int length) {
 
     Serial.println("\r\n");
-    Serial.println("开始处理设备属性设置响应...");
+    Serial.println("开始处理设备属性设置指令...");
 
-    StaticJsonDocument<512> doc;
-    DeserializationError error = deserializeJson(doc, payload);
+    // 零拷贝解析，字符串直接引用接收缓冲区，容量由物模型在编译期确定
+    StaticJsonDocument<THING_SET_JSON_CAPACITY> doc;
+    DeserializationError error = deserializeJson(doc, payload, length);
 
+    if (error == DeserializationError::NoMemory) {
+        Serial.println("属性数量超出物模型定义");
+        sendPropertySetResponse("", 400, "属性数量超出物模型定义");
+        return;
+    }
     if (error) {
         Serial.println("JSON解析失败: " + String(error.c_str()));
         sendPropertySetResponse("", 400, "JSON解析失败");
@@ -257,56 +547,395 @@ void MqttHandler::handlePropertySetCommand(const String& topic, const String& pa
     }
 
     String requestId = doc["id"] | "";
+    if (replayDuplicate(requestId, TOPIC_SET_REPLY)) {
+        return;
+    }
+    requestCache.begin(requestId, TOPIC_SET_REPLY);
 
-    if (!doc.containsKey("params")) {
+    JsonObject params = doc["params"];
+    if (params.isNull()) {
         Serial.println("请求中缺少params参数");
         sendPropertySetResponse(requestId, 400, "缺少params参数");
         return;
     }
-    sendPropertySetResponse(requestId, 200, "success");
 
-    JsonObject params = doc["params"];
-    Serial.println("\r\n");
+    // 1.校验：按物模型检查类型、范围与可写性，任一不通过则整体拒绝，不应用任何属性
+    ThingProperties props;
+    std::vector<PropertySetResult> results;
+    results.reserve(params.size());
+    bool allValid = true;
+    for (JsonPair kv : params) {
+        PropertySetResult result;
+        result.name = kv.key().c_str();
+        result.code = thingReadValue(props, thingFindProperty(kv.key().c_str()), kv.value());
+        result.seq = 0;
+        if (result.code != 200) {
+            Serial.println("属性校验失败: " + result.name + " (" + String(result.code) + ")");
+            allValid = false;
+        }
+        results.push_back(result);
+    }
+    if (!allValid) {
+        sendPropertySetResponse(requestId, 400, "属性校验失败", &results);
+        return;
+    }
+
+    // 2.应用
+    PendingSetReply reply;
+    reply.requestId = requestId;
+    reply.replyTopic = TOPIC_SET_REPLY;
+    reply.mode = SET_REPLY_COMMIT;
+    reply.applied = props;
+    reply.results = results;
     Serial.println("本次设置了以下属性:");
+    applyProperties(reply);
+
+    // 3.响应，STM32确认后才把执行成功的属性写入影子
+    finishPropertySet(reply);
+}
+//处理网关子设备的属性设置：校验后按 key=value 转发给该子设备的串口端点，确认后响应
+void MqttHandler::handleSubPropertySetCommand(char* payload, unsigned int length) {
+    Serial.println("\r\n");
+    Serial.println("开始处理子设备属性设置指令...");
+
+    // {"id","version","params":{"productID","deviceName","params":{...}}}
+    StaticJsonDocument<JSON_OBJECT_SIZE(3) + THING_SET_JSON_CAPACITY> doc;
+    DeserializationError error = deserializeJson(doc, payload, length);
+    if (error) {
+        Serial.println("JSON解析失败: " + String(error.c_str()));
+        sendPropertySetResponse("", 400, "JSON解析失败", nullptr, TOPIC_SUB_SET_REPLY);
+        return;
+    }
+
+    String requestId = doc["id"] | "";
+    if (replayDuplicate(requestId, TOPIC_SUB_SET_REPLY)) {
+        return;
+    }
+    requestCache.begin(requestId, TOPIC_SUB_SET_REPLY);
+    const char* deviceName = doc["params"]["deviceName"].as<const char*>();
+    JsonObject params = doc["params"]["params"];
+    if (deviceName == nullptr || params.isNull()) {
+        sendPropertySetResponse(requestId, 400, "缺少params参数", nullptr, TOPIC_SUB_SET_REPLY);
+        return;
+    }
+    if (gateway == nullptr || serialHandler == nullptr || !gateway->isOnline(deviceName)) {
+        Serial.println("子设备未登录: " + String(deviceName));
+        sendPropertySetResponse(requestId, 404, "子设备未登录", nullptr, TOPIC_SUB_SET_REPLY);
+        return;
+    }
 
+    // 子设备使用网关的物模型，校验规则与网关自身的属性设置一致
+    ThingProperties props;
+    std::vector<PropertySetResult> results;
+    results.reserve(params.size());
+    bool allValid = true;
     for (JsonPair kv : params) {
-        String propertyName = String(kv.key().c_str());
-        JsonVariant propertyValue = kv.value();
+        PropertySetResult result;
+        result.name = kv.key().c_str();
+        result.code = thingReadValue(props, thingFindProperty(kv.key().c_str()), kv.value());
+        result.seq = 0;
+        if (result.code != 200) {
+            allValid = false;
+        }
+        results.push_back(result);
+    }
+    if (!allValid) {
+        sendPropertySetResponse(requestId, 400, "属性校验失败", &results, TOPIC_SUB_SET_REPLY);
+        return;
+    }
 
-        Serial.print("  ");
-        Serial.print(propertyName);
-        Serial.print(" = ");
-        processPropertySetValue(propertyName, propertyValue);
+    // 网关不了解子设备的执行机构，属性原样以 key=value 发给带标签的串口端点
+    size_t i = 0;
+    for (JsonPair kv : params) {
+        String command = kv.key().c_str();
+        command += '=';
+        if (kv.value().is<const char*>()) {
+            command += kv.value().as<const char*>();
+        } else {
+            serializeJson(kv.value(), command);
+        }
+        Serial.println("  " + String(deviceName) + ": " + command);
+        results[i].seq = serialHandler->sendStm32Command(command, false, deviceName);
+        if (results[i].seq == 0) {
+            results[i].code = 503;
+        }
+        i++;
     }
+    serialHandler->flushStm32Commands();
+
+    PendingSetReply reply;
+    reply.requestId = requestId;
+    reply.replyTopic = TOPIC_SUB_SET_REPLY;
+    reply.mode = SET_REPLY_ONLY;
+    reply.results = results;
+    finishPropertySet(reply);
 }
-//根据设备属性值的类型进行不同的处理选择
-void MqttHandler::processPropertySetValue(const String& propertyName, const JsonVariant& propertyValue) {
-    /*根据值的类型进行不同的处理*/
-    if (propertyValue.is<const char*>()) {
-        // 处理字符串类型属性
-        String value = propertyValue.as<String>();
-        Serial.println(value);
-        handleDeviceProperty_String(propertyName, value);//调用处理设备属性的函数，传入属性名和属性值
+//批量应用属性：GPIO与STM32命令在全部属性处理完后统一刷新
+// 属性影子在最终结果确定后由commitProperties更新
+void MqttHandler::applyProperties(PendingSetReply& reply) {
+    pendingLedState = -1;
+    ThingApplyVisitor visitor = {this, &reply};
+    thingVisit(reply.applied, visitor);
+    if (pendingLedState >= 0) {
+        digitalWrite(LED_GPIO_PIN, pendingLedState);
     }
-    else if (propertyValue.is<int>()) {
-        // 处理整数类型属性
-        int value = propertyValue.as<int>();
-        Serial.println(value);
-        handleDeviceProperty(propertyName, String(value));
+    if (serialHandler != nullptr) {
+        serialHandler->flushStm32Commands();
     }
-    else if (propertyValue.is<float>()) {
-        // 处理浮点数类型属性
-        float value = propertyValue.as<float>();
-        Serial.println(value, 2);
-        handleDeviceProperty(propertyName, String(value));
+}
+//将最终结果为200的属性写入属性影子，post为true时同时上报（上报时更新影子）
+void MqttHandler::commitProperties(const ThingProperties& applied, const std::vector<PropertySetResult>& results,
+                                   bool post) {
+    ThingProperties committed;
+    for (const auto& result : results) {
+        ThingPropertyId id = thingFindProperty(result.name.c_str());
+        if (result.code == 200 && id != TP_COUNT && applied.has(id)) {
+            thingCopyValue(committed, applied, id);
+        }
     }
-    else if (propertyValue.is<bool>()) {
-        // 处理布尔类型属性
-        bool value = propertyValue.as<bool>();
-        Serial.println(value ? "true" : "false");
-        handleDeviceProperty(propertyName, String(value ? "true" : "false"));
+    if (committed.empty()) {
+        return;
+    }
+
+    if (post) {
+        postProperties(committed, true);
+    } else {
+        shadow.report(committed);
+    }
+    shadow.save();
+    if (ruleEngine != nullptr) {
+        ruleEngine->compile(shadow.getReported());
     }
 }
+//应答云端属性获取请求，直接读取属性影子
+void MqttHandler::handlePropertyGetCommand(char* payload, unsigned int length) {
+    StaticJsonDocument<JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(TP_COUNT)> request;
+    DeserializationError error = deserializeJson(request, payload, length);
+    if (error) {
+        Serial.println("属性获取请求解析失败: " + String(error.c_str()));
+        return;
+    }
+
+    const PropertyShadow& constShadow = shadow;
+    const ThingProperties& reported = constShadow.getReported();
+
+    String replyPayload;
+    replyPayload.reserve(THING_POST_MAX_LENGTH);
+    replyPayload = F("{\"id\":");
+    const char* requestId = request["id"].as<const char*>();
+    thingAppendJsonString(replyPayload, requestId != nullptr ? requestId : "");
+    replyPayload += F(",\"code\":200,\"msg\":\"success\",\"data\":{");
+    bool first = true;
+    for (JsonVariant key : request["params"].as<JsonArray>()) {
+        ThingPropertyId id = thingFindProperty(key.as<const char*>());
+        if (id == TP_COUNT || !reported.has(id)) {
+            continue;
+        }
+        if (!first) {
+            replyPayload += ',';
+        }
+        first = false;
+        thingAppendJsonString(replyPayload, THING_PROPERTIES[id].key);
+        replyPayload += ':';
+        thingAppendValue(replyPayload, reported, id);
+    }
+    replyPayload += F("}}");
+    publish(TopicCache::get(TOPIC_GET_REPLY), replyPayload.c_str());
+}
+//请求所有可写属性的期望值
+void MqttHandler::requestDesiredProperties() {
+    StaticJsonDocument<JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(THING_WRITABLE_COUNT)> request;
+    request["id"] = TopicCache::nextId();
+    request["version"] = "1.0";
+    JsonArray params = request.createNestedArray("params");
+    for (const auto& info : THING_PROPERTIES) {
+        if (info.writable) {
+            params.add(info.key);
+        }
+    }
+
+    String requestPayload;
+    serializeJson(request, requestPayload);
+    Serial.println("请求云端期望属性值...");
+    publish(TopicCache::get(TOPIC_DESIRED_GET), requestPayload.c_str());
+}
+//处理期望值应答：应用比影子新的期望值，并上报应用后的状态
+void MqttHandler::handleDesiredGetReply(char* payload, unsigned int length) {
+    StaticJsonDocument<JSON_OBJECT_SIZE(4) + JSON_OBJECT_SIZE(THING_WRITABLE_COUNT) +
+                       THING_WRITABLE_COUNT * JSON_OBJECT_SIZE(2)> doc;
+    DeserializationError error = deserializeJson(doc, payload, length);
+    if (error) {
+        Serial.println("期望值应答解析失败: " + String(error.c_str()));
+        return;
+    }
+    if ((doc["code"] | 0) != 200) {
+        Serial.println("获取期望值失败: " + String(doc["msg"] | ""));
+        return;
+    }
+
+    PendingSetReply reply;
+    reply.replyTopic = TOPIC_SET_REPLY;
+    reply.mode = SET_COMMIT_POST;
+    ThingProperties& toApply = reply.applied;
+    std::vector<PropertySetResult>& results = reply.results;
+    for (JsonPair kv : doc["data"].as<JsonObject>()) {
+        ThingPropertyId id = thingFindProperty(kv.key().c_str());
+        ThingProperties desired;
+        if (id == TP_COUNT || thingReadValue(desired, id, kv.value()["value"]) != 200) {
+            continue;
+        }
+        if (shadow.acceptDesired(id, desired, kv.value()["version"] | 0UL)) {
+            thingCopyValue(toApply, desired, id);
+            PropertySetResult result;
+            result.name = THING_PROPERTIES[id].key;
+            result.code = 200;
+            result.seq = 0;
+            results.push_back(result);
+        }
+    }
+
+    if (toApply.empty()) {
+        Serial.println("设备状态已与云端期望值一致");
+        return;
+    }
+
+    Serial.println("应用云端期望属性值:");
+    applyProperties(reply);
+    // STM32确认后只上报执行成功的属性
+    finishPropertySet(reply);
+}
+//上报属性，同时更新属性影子
+bool MqttHandler::postProperties(const ThingProperties& props, bool queued) {
+    if (props.empty()) {
+        return false;
+    }
+
+    const ThingProperties* toPost = &props;
+    ThingProperties merged;
+    if (Metrics::isDue(millis(), METRICS_PIGGYBACK_WINDOW)) {
+        // 心跳即将到期，运行指标随本次上报一起发送，省去一次单独的发布
+        merged = props;
+        collectMetrics(merged);
+        toPost = &merged;
+    }
+    shadow.report(*toPost);
+
+    bool backlog = !mqttClient->connected() || !telemetryQueue.empty();
+#if MQTT_PUBLISH_QOS == 1
+    backlog = backlog || inflight.isFull();
+#endif
+    if (queued && backlog) {
+        // 离线或已有积压时以紧凑格式排队（保持上报顺序），发送时再展开为JSON
+        if (!telemetryQueue.push(*toPost)) {
+            Serial.println("警告: 属性上报队列已满，丢弃本次上报");
+            return false;
+        }
+        return true;
+    }
+
+    String payload;
+    thingSerializePost(*toPost, TopicCache::nextId(), payload);
+    return publish(TopicCache::get(TOPIC_POST), payload.c_str(), queued);
+}
+//所有STM32命令都已确认时立即完成，否则挂起等待确认
+void MqttHandler::finishPropertySet(PendingSetReply& reply) {
+    bool waiting = false;
+    bool allSuccess = true;
+    for (const auto& result : reply.results) {
+        if (result.seq != 0) {
+            waiting = true;
+        }
+        if (result.code != 200) {
+            allSuccess = false;
+        }
+    }
+
+    if (waiting) {
+        pendingSetReplies.push_back(reply);
+        Serial.println("等待STM32确认后响应");
+        return;
+    }
+
+    if (reply.mode != SET_REPLY_ONLY) {
+        commitProperties(reply.applied, reply.results, reply.mode == SET_COMMIT_POST);
+    }
+    if (reply.mode == SET_COMMIT_POST) {
+        return;
+    }
+    if (allSuccess) {
+        sendPropertySetResponse(reply.requestId, 200, "success", &reply.results, reply.replyTopic);
+    } else if (reply.message.length() > 0) {
+        sendPropertySetResponse(reply.requestId, 400, reply.message.c_str(), &reply.results, reply.replyTopic);
+    } else {
+        sendPropertySetResponse(reply.requestId, 500, "部分属性执行失败", &reply.results, reply.replyTopic);
+    }
+}
+//STM32命令结果通知，某请求的命令全部完成后发送响应
+void MqttHandler::onStm32CommandResult(uint16_t seq, bool success) {
+    for (auto it = pendingSetReplies.begin(); it != pendingSetReplies.end(); ++it) {
+        for (auto& result : it->results) {
+            if (result.seq != seq) {
+                continue;
+            }
+            result.seq = 0;
+            if (!success) {
+                result.code = 500;
+            }
+
+            PendingSetReply reply = *it;
+            pendingSetReplies.erase(it);
+            finishPropertySet(reply);
+            return;
+        }
+    }
+}
+//本地规则驱动LED，property/get读到的LED与引脚状态一致
+// 只更新内存中的影子，之后其他属性保存时Flash中仍为云端设置的LED值：规则可能频繁触发/恢复，重启后由规则重新求值
+void MqttHandler::applyRuleLed(bool on) {
+    pendingLedState = -1;
+    handleDeviceProperty(THING_PROPERTIES[TP_LED].key, on ? "true" : "false");
+    if (pendingLedState >= 0) {
+        digitalWrite(LED_GPIO_PIN, pendingLedState);
+    }
+
+    ThingProperties props;
+    props.LED = on;
+    props.mark(TP_LED);
+    shadow.report(props, false);
+}
+//发送属性给STM32（只入队，由属性设置流程统一刷新）
+// 命令内容为 key=value，与下发给子设备的格式一致，STM32按key区分属性
+bool MqttHandler::sendStm32Command(const String& propertyName, const String& value) {
+    if (serialHandler == nullptr) {
+        Serial.println("错误: 串口处理器未初始化!");
+        currentResultCode = 503;
+        return false;
+    }
+    uint16_t seq = serialHandler->sendStm32Command(propertyName + "=" + value, false);
+    if (seq == 0) {
+        currentResultCode = 503;
+        return false;
+    }
+    currentCommandSeq = seq;
+    return true;
+}
+//按物模型类型应用属性值
+void MqttHandler::applyThingProperty(ThingPropertyId id, bool value) {
+    Serial.println("  " + String(THING_PROPERTIES[id].key) + " = " + (value ? "true" : "false"));
+    handleDeviceProperty(THING_PROPERTIES[id].key, value ? "true" : "false");
+}
+void MqttHandler::applyThingProperty(ThingPropertyId id, int32_t value) {
+    Serial.println("  " + String(THING_PROPERTIES[id].key) + " = " + String(value));
+    handleDeviceProperty_Int(THING_PROPERTIES[id].key, value);
+}
+void MqttHandler::applyThingProperty(ThingPropertyId id, float value) {
+    Serial.println("  " + String(THING_PROPERTIES[id].key) + " = " + String(value, 2));
+    handleDeviceProperty_Float(THING_PROPERTIES[id].key, value);
+}
+void MqttHandler::applyThingProperty(ThingPropertyId id, const String& value) {
+    Serial.println("  " + String(THING_PROPERTIES[id].key) + " = " + value);
+    handleDeviceProperty_String(THING_PROPERTIES[id].key, value);
+}
 
 /*=====================具体的回调逻辑处理函数========================*/
 
@@ -314,7 +943,7 @@ void MqttHandler::processPropertySetValue(const String& propertyName, const Json
 void MqttHandler::handleDeviceProperty(const String& propertyName, const String& value) {
     if (propertyName == "LED" || propertyName == "Switch") {
         bool state = (value == "on" || value == "true" || value == "1" || value == "HIGH");
-        digitalWrite(LED_GPIO_PIN, state ? LOW:HIGH);
+        pendingLedState = state ? LOW : HIGH; // 批量应用结束后统一写入
         Serial.print("标识符:"+propertyName+"，其设置值为: ");
         Serial.println(value);
     }
@@ -327,7 +956,7 @@ void MqttHandler::handleDeviceProperty(const String& propertyName, const String&
 }
 //2.处理字符串类型属性
 void MqttHandler::handleDeviceProperty_String(const String& propertyName, const String& value) {
-    // 处理字符串类型属性（向STM32发送命令，自定义的数据包<CYZ:XXX:CYZ>）
+    // 处理字符串类型属性（向STM32发送命令，数据包<CYZ:序号:key=value:CYZ>）
     
     Serial.print("标识符:"+propertyName+"，其值设置为: ");
     Serial.println(value);
@@ -336,17 +965,28 @@ void MqttHandler::handleDeviceProperty_String(const String& propertyName, const
         // 这里可以添加实际的逻辑
         if (value == "Upload_on") {
             Serial.println("控制开始一次数据上传...");
-            Serial.println("发送数据上传数据包：<CYZ:" + value + ":CYZ>");
+            sendStm32Command(propertyName, value);
         } else {
-            Serial.println("不属于当前标识符的有效命令：<CYZ:unknown_command:CYZ>");
+            Serial.println("不属于当前标识符的有效命令: " + value);
         }
         
     }
     // 可以添加其他标识符属性的处理逻辑
     //else if {...}
+    else if(propertyName == "Set_Config") {
+        // 运行参数：KEY=值[,KEY=值]，全部有效时才应用
+        String message;
+        if (Settings::assign(value, message)) {
+            Serial.println("运行参数已更新: " + message);
+        } else {
+            Serial.println("运行参数设置失败: " + message);
+            currentResultCode = 400;
+            currentResultMessage = message;
+        }
+    }
     else if(propertyName == "Command" || propertyName == "Control") {
         //发送指令给STM32控制
-        Serial.println("发送命令数据包：<CYZ:" + value + ":CYZ>");
+        sendStm32Command(propertyName, value);
     }
     else {
         // 其他字符串属性
@@ -359,14 +999,13 @@ void MqttHandler::handleDeviceProperty_String(const String& propertyName, const
 }
 //3.处理整数类型属性
 void MqttHandler::handleDeviceProperty_Int(const String& propertyName, int value) {
-    // 处理整数类型属性（向STM32发送命令，自定义的数据包<CYZ:XXX:CYZ>）
+    // 处理整数类型属性（向STM32发送命令，数据包<CYZ:序号:key=value:CYZ>）
     
     Serial.print("标识符:"+propertyName+"，其设置值为: ");
     Serial.println(value);
     //根据不同标识符进行不同处理
     if(propertyName == "Set_Threshold") { 
-        // 这里可以添加实际的逻辑
-        Serial.println("发送设置阈值数据包：<CYZ:" + String(value) + ":CYZ>");
+        sendStm32Command(propertyName, String(value));
     }
     // 可以添加其他整数属性的处理逻辑
     //else if {...}
@@ -385,11 +1024,11 @@ void MqttHandler::handleDeviceProperty_Float(const String& propertyName, float v
     Serial.println(value, 2);
 
     if (propertyName == "Set_Threshold_Float") {
-        Serial.println("发送设置浮点阈值数据包：<CYZ:" + String(value, 2) + ":CYZ>");
+        sendStm32Command(propertyName, String(value, 2));
     } else if (propertyName == "Set_Temperature") {
-        Serial.println("设置温度阈值: " + String(value, 2));
+        Serial.println("设置温度阈值: " + String(value, 2) + "（本地规则）");
     } else if (propertyName == "Set_Humidity") {
-        Serial.println("设置湿度阈值: " + String(value, 2));
+        Serial.println("设置湿度阈值: " + String(value, 2) + "（本地规则）");
     } else {
         Serial.print("未知浮点数属性: ");
         Serial.print(propertyName);
@@ -0,0 +1,116 @@
+#include <MqttQos.h>
+#include <Metrics.h>
+#include <PowerManager.h>
+
+/*=====================QoS1发送窗口========================*/
+
+MqttInflight::MqttInflight() {
+    // packet id从0x8000开始分配，与MqttClient订阅使用的1~0x7FFF错开
+    nextPacketId = 0x8000;
+    windowSize = MQTT_QOS1_WINDOW;
+    ackCount = 0;
+    resendCount = 0;
+    dropCount = 0;
+}
+
+void MqttInflight::setWindowSize(uint8_t size) {
+    if (size < 1) {
+        size = 1;
+    }
+    if (size > MQTT_QOS1_WINDOW_MAX) {
+        size = MQTT_QOS1_WINDOW_MAX;
+    }
+    windowSize = size;
+}
+//分配未被在途消息占用的packet id（0x8000~0xFFFF循环）
+uint16_t MqttInflight::allocatePacketId() {
+    while (true) {
+        uint16_t id = nextPacketId;
+        nextPacketId = nextPacketId == 0xFFFF ? 0x8000 : nextPacketId + 1;
+
+        bool inUse = false;
+        for (const auto& msg : messages) {
+            if (msg.packetId == id) {
+                inUse = true;
+                break;
+            }
+        }
+        if (!inUse) {
+            return id;
+        }
+    }
+}
+bool MqttInflight::writePublish(MqttClient& client, const InflightMessage& msg, bool dup) {
+    return client.publish(msg.topic.c_str(), (const uint8_t*)msg.payload.c_str(), msg.payload.length(),
+                          1, dup, msg.packetId);
+}
+
+bool MqttInflight::publish(MqttClient& client, const char* topic, const char* payload, unsigned long now) {
+    InflightMessage msg;
+    msg.packetId = allocatePacketId();
+    msg.topic = topic;
+    msg.payload = payload;
+    msg.sentTime = now;
+    msg.resendCount = 0;
+
+    if (!writePublish(client, msg, false)) {
+        return false;
+    }
+    messages.push_back(msg);
+    return true;
+}
+
+void MqttInflight::ack(uint16_t packetId) {
+    for (auto it = messages.begin(); it != messages.end(); ++it) {
+        if (it->packetId == packetId) {
+            messages.erase(it);
+            ackCount++;
+            Metrics::add(TP_Pub_Count);
+            return;
+        }
+    }
+}
+
+void MqttInflight::resendAll(MqttClient& client, unsigned long now) {
+    if (messages.empty()) {
+        return;
+    }
+    Serial.println("重发 " + String(messages.size()) + " 条未确认的QoS1消息");
+    for (auto& msg : messages) {
+        writePublish(client, msg, true);
+        msg.sentTime = now;
+        resendCount++;
+    }
+}
+
+void MqttInflight::checkTimeouts(MqttClient& client, unsigned long now) {
+    for (auto it = messages.begin(); it != messages.end(); ) {
+        if (now - it->sentTime < MQTT_QOS1_ACK_TIMEOUT) {
+            ++it;
+            continue;
+        }
+        if (it->resendCount >= MQTT_QOS1_MAX_RESEND) {
+            Serial.println("QoS1消息确认超时（已达最大重发次数）: " + it->topic);
+            Metrics::add(TP_Pub_Fail);
+            dropCount++;
+            it = messages.erase(it);
+            continue;
+        }
+        it->resendCount++;
+        it->sentTime = now;
+        resendCount++;
+        writePublish(client, *it, true);
+        ++it;
+    }
+}
+
+unsigned long MqttInflight::getNextDeadlineIn(unsigned long now) const {
+    unsigned long next = POWER_NO_DEADLINE;
+    for (const auto& msg : messages) {
+        unsigned long due = PowerManager::timeUntil(msg.sentTime, MQTT_QOS1_ACK_TIMEOUT, now);
+        if (due < next) {
+            next = due;
+        }
+    }
+    return next;
+}
@@ -0,0 +1,37 @@
+#include <MqttTransport.h>
+
+bool WiFiMqttTransport::open(const char* host, uint16_t port) {
+    if (client.connect(host, port) != 1) {
+        return false;
+    }
+    // 关闭Nagle，报头与负载分两次写出时负载不必等待报头段被确认
+    client.setNoDelay(true);
+    return true;
+}
+
+bool WiFiMqttTransport::writev(const MqttIoVec* iov, size_t count) {
+    // 报头、主题、packet id等小分段拼在栈上一次写出，负载等大分段直接写出不拷贝
+    uint8_t merged[MQTT_TRANSPORT_MERGE_BYTES];
+    size_t used = 0;
+    for (size_t i = 0; i < count; i++) {
+        const MqttIoVec& segment = iov[i];
+        if (used + segment.length <= sizeof(merged)) {
+            memcpy(merged + used, segment.data, segment.length);
+            used += segment.length;
+            continue;
+        }
+        if (used > 0) {
+            if (client.write(merged, used) != used) {
+                return false;
+            }
+            used = 0;
+        }
+        if (segment.length <= sizeof(merged)) {
+            memcpy(merged, segment.data, segment.length);
+            used = segment.length;
+        } else if (client.write(segment.data, segment.length) != segment.length) {
+            return false;
+        }
+    }
+    return used == 0 || client.write(merged, used) == used;
+}
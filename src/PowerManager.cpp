@@ -0,0 +1,97 @@
+#include <PowerManager.h>
+
+//构造函数
+PowerManager::PowerManager(PowerClock clock) : clock(clock) {
+    startTime = clock();
+    lastActivity = startTime;
+    sleepStart = 0;
+    sleepMillis = 0;
+    wakeCount = 0;
+    eventWakeCount = 0;
+    lightSleepCount = 0;
+    sleeping = false;
+}
+
+unsigned long PowerManager::timeUntil(unsigned long start, unsigned long interval, unsigned long now) {
+    unsigned long elapsed = now - start;
+    return elapsed >= interval ? 0 : interval - elapsed;
+}
+//休眠决策
+PowerDecision PowerManager::decide(const PowerInputs& inputs) {
+    PowerDecision decision;
+
+    // 有未处理的数据或刚有活动：保持唤醒，立即继续下一轮loop
+    if (inputs.pendingWork || inputs.idleFor < POWER_IDLE_THRESHOLD) {
+        decision.mode = POWER_AWAKE;
+        decision.duration = 0;
+        return decision;
+    }
+
+    unsigned long available = inputs.nextDeadlineIn;
+    if (available > POWER_MAX_SLEEP) {
+        available = POWER_MAX_SLEEP;
+    }
+
+    // 距下一事件太近，休眠切换不划算，短暂等待
+    if (available < POWER_MIN_SLEEP) {
+        decision.mode = POWER_AWAKE;
+        decision.duration = available;
+        return decision;
+    }
+
+#if POWER_MODE >= 2
+    if (available >= POWER_LIGHT_SLEEP_MIN) {
+        decision.mode = POWER_LIGHT_SLEEP;
+        decision.duration = available;
+        return decision;
+    }
+#endif
+
+    decision.mode = POWER_MODEM_SLEEP;
+    decision.duration = available;
+    return decision;
+}
+
+void PowerManager::noteActivity() {
+    lastActivity = clock();
+}
+
+PowerDecision PowerManager::plan(unsigned long nextDeadlineIn, bool pendingWork) {
+    unsigned long current = clock();
+
+    PowerInputs inputs;
+    inputs.idleFor = current - lastActivity;
+    inputs.nextDeadlineIn = nextDeadlineIn;
+    inputs.pendingWork = pendingWork;
+    PowerDecision decision = decide(inputs);
+
+    if (decision.mode != POWER_AWAKE) {
+        sleeping = true;
+        sleepStart = current;
+        if (decision.mode == POWER_LIGHT_SLEEP) {
+            lightSleepCount++;
+        }
+    }
+    return decision;
+}
+
+void PowerManager::wake(bool byEvent) {
+    if (!sleeping) {
+        return;
+    }
+    sleeping = false;
+    sleepMillis += clock() - sleepStart;
+    wakeCount++;
+    if (byEvent) {
+        eventWakeCount++;
+        lastActivity = clock();
+    }
+}
+
+int PowerManager::getAwakeRatio() const {
+    unsigned long total = clock() - startTime;
+    if (total == 0) {
+        return 100;
+    }
+    return (int)((unsigned long long)(total - sleepMillis) * 100 / total);
+}
@@ -0,0 +1,122 @@
+#include <PropertyShadow.h>
+#include <EEPROM.h>
+
+// Flash中影子存储区的头部标记
+static const uint16_t SHADOW_MAGIC = 0x5348; // "SH"
+// 存储格式: {"key":{"v":值,"r":上报版本},...}，只保存可写属性
+// 期望版本不保存，开机后总是按云端期望值重新应用一次，保证执行器与云端一致
+static const size_t SHADOW_JSON_CAPACITY = JSON_OBJECT_SIZE(THING_WRITABLE_COUNT) + THING_WRITABLE_COUNT * JSON_OBJECT_SIZE(2);
+
+//构造函数
+PropertyShadow::PropertyShadow() {
+    for (uint8_t i = 0; i < TP_COUNT; i++) {
+        reportedVersion[i] = 0;
+        desiredVersion[i] = 0;
+    }
+    dirty = false;
+}
+//从Flash载入影子
+void PropertyShadow::begin() {
+#if SHADOW_PERSIST
+    // 与运行参数共用同一块EEPROM模拟区，大小必须一致，否则begin()会重新分配并丢弃未提交的修改
+    EEPROM.begin(EEPROM_TOTAL_SIZE);
+
+    uint16_t magic = EEPROM.read(0) | (EEPROM.read(1) << 8);
+    uint16_t length = EEPROM.read(2) | (EEPROM.read(3) << 8);
+    if (magic != SHADOW_MAGIC || length == 0 || length > SHADOW_EEPROM_SIZE - 4) {
+        Serial.println("属性影子: Flash中没有有效数据");
+        return;
+    }
+
+    // 复制到可写缓冲区后零拷贝解析，字符串值由thingReadValue复制
+    std::vector<char> json(length + 1, '\0');
+    for (uint16_t i = 0; i < length; i++) {
+        json[i] = (char)EEPROM.read(4 + i);
+    }
+
+    StaticJsonDocument<SHADOW_JSON_CAPACITY> doc;
+    if (deserializeJson(doc, json.data(), length)) {
+        Serial.println("属性影子: Flash数据解析失败");
+        return;
+    }
+
+    int restored = 0;
+    for (JsonPair kv : doc.as<JsonObject>()) {
+        ThingPropertyId id = thingFindProperty(kv.key().c_str());
+        JsonObject entry = kv.value();
+        if (id == TP_COUNT || entry.isNull()) {
+            continue;
+        }
+        if (thingReadValue(reported, id, entry["v"]) == 200) {
+            reportedVersion[id] = entry["r"] | 0UL;
+            restored++;
+        }
+    }
+    persisted = reported;
+    Serial.println("属性影子: 已从Flash恢复 " + String(restored) + " 个属性");
+#endif
+}
+//合并上报/应用后的属性值
+void PropertyShadow::report(const ThingProperties& props, bool persist) {
+    for (uint8_t i = 0; i < TP_COUNT; i++) {
+        ThingPropertyId id = (ThingPropertyId)i;
+        if (!props.has(id)) {
+            continue;
+        }
+        thingCopyValue(reported, props, id);
+        reportedVersion[i]++;
+        if (persist && THING_PROPERTIES[i].writable) {
+            thingCopyValue(persisted, props, id);
+            dirty = true;
+        }
+    }
+}
+//记录比影子新的云端期望值
+bool PropertyShadow::acceptDesired(ThingPropertyId id, const ThingProperties& props, uint32_t version) {
+    if (id >= TP_COUNT || !props.has(id) || version <= desiredVersion[id]) {
+        return false;
+    }
+    thingCopyValue(desired, props, id);
+    desiredVersion[id] = version;
+    return true;
+}
+//将可写属性保存到Flash
+void PropertyShadow::save() {
+#if SHADOW_PERSIST
+    if (!dirty) {
+        return;
+    }
+    dirty = false;
+
+    StaticJsonDocument<SHADOW_JSON_CAPACITY> doc;
+    JsonObject root = doc.to<JsonObject>();
+    for (uint8_t i = 0; i < TP_COUNT; i++) {
+        ThingPropertyId id = (ThingPropertyId)i;
+        if (!THING_PROPERTIES[i].writable || !persisted.has(id)) {
+            continue;
+        }
+        JsonObject entry = root.createNestedObject(THING_PROPERTIES[i].key);
+        thingWriteValue(entry, "v", persisted, id);
+        entry["r"] = reportedVersion[i];
+    }
+
+    String json;
+    serializeJson(doc, json);
+    if (json.length() > SHADOW_EEPROM_SIZE - 4) {
+        Serial.println("属性影子: 数据超出存储区大小，未保存");
+        return;
+    }
+
+    EEPROM.write(0, SHADOW_MAGIC & 0xFF);
+    EEPROM.write(1, SHADOW_MAGIC >> 8);
+    EEPROM.write(2, json.length() & 0xFF);
+    EEPROM.write(3, json.length() >> 8);
+    for (unsigned int i = 0; i < json.length(); i++) {
+        EEPROM.write(4 + i, json[i]);
+    }
+    // EEPROM库只在内容变化时才擦写Flash
+    if (!EEPROM.commit()) {
+        Serial.println("属性影子: 写入Flash失败");
+    }
+#endif
+}
@@ -0,0 +1,57 @@
+#include <RequestCache.h>
+
+RequestCache::RequestCache() {
+    for (auto& entry : entries) {
+        entry.replyTopic = TOPIC_COUNT;
+        entry.lastUsed = 0;
+    }
+    useCounter = 0;
+    duplicateCount = 0;
+}
+
+CachedReply* RequestCache::find(const String& requestId, TopicId replyTopic) {
+    if (requestId.length() == 0) {
+        return nullptr;
+    }
+    for (auto& entry : entries) {
+        if (entry.lastUsed != 0 && entry.replyTopic == replyTopic && entry.requestId == requestId) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const CachedReply* RequestCache::checkDuplicate(const String& requestId, TopicId replyTopic) {
+    CachedReply* entry = find(requestId, replyTopic);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+    duplicateCount++;
+    entry->lastUsed = ++useCounter;
+    return entry;
+}
+
+void RequestCache::begin(const String& requestId, TopicId replyTopic) {
+    if (requestId.length() == 0) {
+        return;
+    }
+
+    // 优先使用空槽，否则挤出最久未使用的记录
+    CachedReply* slot = &entries[0];
+    for (auto& entry : entries) {
+        if (entry.lastUsed < slot->lastUsed) {
+            slot = &entry;
+        }
+    }
+    slot->requestId = requestId;
+    slot->replyTopic = replyTopic;
+    slot->reply = "";
+    slot->lastUsed = ++useCounter;
+}
+
+void RequestCache::complete(const String& requestId, TopicId replyTopic, const String& reply) {
+    CachedReply* entry = find(requestId, replyTopic);
+    if (entry != nullptr) {
+        entry->reply = reply;
+    }
+}
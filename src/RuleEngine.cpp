@@ -0,0 +1,124 @@
+#include <RuleEngine.h>
+#include <SerialHandler.h>
+#include <MqttHandler.h>
+
+// 规则注册表：同一输入属性可以有多条规则，按注册顺序求值
+// STM32命令以 <CYZ:序号:命令:CYZ> 下发，与云端下发的命令共用同一通道和确认机制
+static const RuleDef RULE_REGISTRY[] = {
+    {TP_temperature, RULE_ABOVE, TP_Set_Temperature, RULE_HYSTERESIS, true, "TEMP_HIGH", "TEMP_OK"},
+    {TP_humidity, RULE_ABOVE, TP_Set_Humidity, RULE_HYSTERESIS, false, "HUMI_HIGH", "HUMI_OK"},
+};
+
+static const size_t RULE_REGISTRY_COUNT = sizeof(RULE_REGISTRY) / sizeof(RULE_REGISTRY[0]);
+
+//构造函数：按输入属性分组生成求值表，阈值在compile()时填入
+RuleEngine::RuleEngine() {
+    serialHandler = nullptr;
+    mqttHandler = nullptr;
+    fireCount = 0;
+    maxLatency = 0;
+
+    slots.reserve(RULE_REGISTRY_COUNT);
+    for (uint8_t i = 0; i < TP_COUNT; i++) {
+        firstSlot[i] = slots.size();
+        for (uint8_t r = 0; r < RULE_REGISTRY_COUNT; r++) {
+            if (RULE_REGISTRY[r].input == i) {
+                RuleSlot slot = {0, 0, r, false, false};
+                slots.push_back(slot);
+            }
+        }
+    }
+    firstSlot[TP_COUNT] = slots.size();
+}
+//按阈值属性的当前取值重新编译求值表
+void RuleEngine::compile(const ThingProperties& thresholds) {
+    for (auto& slot : slots) {
+        const RuleDef& def = RULE_REGISTRY[slot.rule];
+        int32_t scaled = thresholds.has(def.threshold) ? thingGetScaled(thresholds, def.threshold) : THING_SCALED_NULL;
+        if (scaled == THING_SCALED_NULL) {
+            slot.armed = false;
+            slot.active = false;
+            continue;
+        }
+
+        // 阈值与输入的小数位数可能不同（如Set_Threshold_Float保留2位），统一换算为输入属性的步长
+        uint8_t inputDecimals = THING_PROPERTIES[def.input].decimals;
+        uint8_t thresholdDecimals = THING_PROPERTIES[def.threshold].decimals;
+        int32_t limit = scaled;
+        if (inputDecimals != thresholdDecimals) {
+            limit = thingScaleFloat(thingUnscaleFloat(scaled, thresholdDecimals), inputDecimals);
+        }
+
+        // 阈值改变后保持当前状态，由下一个样本按新阈值决定是否恢复
+        slot.enterLimit = limit;
+        slot.exitLimit = def.op == RULE_ABOVE ? limit - def.hysteresis : limit + def.hysteresis;
+        slot.armed = true;
+    }
+}
+//求值一个样本，只检查以该属性为输入的规则
+void RuleEngine::ingest(ThingPropertyId id, const ThingProperties& props) {
+    if (id >= TP_COUNT || firstSlot[id] == firstSlot[id + 1]) {
+        return;
+    }
+
+    unsigned long start = micros();
+    int32_t value = thingGetScaled(props, id);
+    if (value == THING_SCALED_NULL) {
+        return;
+    }
+
+    for (uint8_t i = firstSlot[id]; i < firstSlot[id + 1]; i++) {
+        RuleSlot& slot = slots[i];
+        if (!slot.armed) {
+            continue;
+        }
+        const RuleDef& def = RULE_REGISTRY[slot.rule];
+        bool above = def.op == RULE_ABOVE;
+        // 只在越过阈值（触发）或越过回差（恢复）时执行动作，阈值附近抖动的样本不会反复触发
+        if (!slot.active && (above ? value > slot.enterLimit : value < slot.enterLimit)) {
+            slot.active = true;
+            runAction(def, true, start);
+        } else if (slot.active && (above ? value <= slot.exitLimit : value >= slot.exitLimit)) {
+            slot.active = false;
+            runAction(def, false, start);
+        }
+    }
+}
+//执行规则动作，start为样本开始求值的时间(us)
+void RuleEngine::runAction(const RuleDef& def, bool enter, unsigned long start) {
+    fireCount++;
+    if (def.led && mqttHandler != nullptr) {
+        mqttHandler->applyRuleLed(enter);
+    }
+    const char* command = enter ? def.enterCommand : def.exitCommand;
+    if (command != nullptr && serialHandler != nullptr) {
+        serialHandler->sendStm32Command(command);
+    }
+    // 耗时不含下面的日志输出
+    unsigned long latency = micros() - start;
+    if (latency > maxLatency) {
+        maxLatency = latency;
+    }
+    Serial.println("本地规则" + String(enter ? "触发" : "恢复") + ": " + String(THING_PROPERTIES[def.input].key) +
+                   (def.op == RULE_ABOVE ? " > " : " < ") + String(THING_PROPERTIES[def.threshold].key));
+}
+
+size_t RuleEngine::getArmedCount() const {
+    size_t count = 0;
+    for (const auto& slot : slots) {
+        if (slot.armed) {
+            count++;
+        }
+    }
+    return count;
+}
+
+size_t RuleEngine::getActiveCount() const {
+    size_t count = 0;
+    for (const auto& slot : slots) {
+        if (slot.active) {
+            count++;
+        }
+    }
+    return count;
+}
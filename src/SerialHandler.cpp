@@ -1,4 +1,6 @@
 #include <SerialHandler.h>
+#include <TopicCache.h>
+#include <Settings.h>
 
 // 前向声明
 extern ESP8266WiFiMulti wifiMulti;
@@ -8,25 +10,61 @@ SerialHandler::SerialHandler() {
     serialBuffer.reserve(256);
     currentState = NORMAL_MODE;
     uploadStartTime = 0;
+    batchStartTime = 0;
+    batchBytes = 0;
     mqttHandler = nullptr;
+    powerManager = nullptr;
+    gateway = nullptr;
+    ruleEngine = nullptr;
+    sampleId = TP_COUNT;
+    nextCommandSeq = 1;
+    flowPaused = false;
+    flowBufferIgnored = false;
+    flowPauseStart = 0;
+    flowPauseCount = 0;
+    droppedLineCount = 0;
+    rxByteCount = 0;
+    rxOverrunCount = 0;
+    rxErrorCount = 0;
 }
 //初始化串口
 void SerialHandler::init() {
+    // 接收缓冲区必须在begin()之前设置，UART中断将数据写入该环形缓冲区
+    Serial.setRxBufferSize(SERIAL_RX_BUFFER_SIZE);
     Serial.begin(SERIAL_BAUD);
     delay(300);
-    Serial.println("串口初始化完成");
+    Serial.println("串口初始化完成，波特率: " + String(SERIAL_BAUD) +
+                   "，接收缓冲区: " + String(Serial.getRxBufferSize()) + " 字节");
     clearDataBuffer();
+#if FLOW_CONTROL_MODE == 2
+    pinMode(FLOW_RTS_PIN, OUTPUT);
+    digitalWrite(FLOW_RTS_PIN, LOW);
+#endif
 }
-//读取串口数据
+//读取串口数据（从中断填充的环形缓冲区中批量取出）
 void SerialHandler::readSerialData() {
-    if (Serial.available()) {
-        while (Serial.available()) {
-            char c = Serial.read();
+    checkRxErrors();
+
+    char chunk[64];
+    size_t budget = SERIAL_RX_MAX_BYTES_PER_POLL;
+
+    while (budget > 0 && Serial.available() > 0) {
+        size_t count = Serial.read(chunk, budget < sizeof(chunk) ? budget : sizeof(chunk));
+        if (count == 0) {
+            break;
+        }
+        budget -= count;
+        rxByteCount += count;
+        trace.record(chunk, count);
+
+        for (size_t i = 0; i < count; i++) {
+            char c = chunk[i];
 
             // 缓冲区溢出保护：超过256字节时丢弃新数据
             if (serialBuffer.length() >= 256) {
                 Serial.println("警告: 串口缓冲区溢出，丢弃数据");
                 serialBuffer = "";
+                droppedLineCount++;
                 continue;
             }
 
@@ -34,26 +72,107 @@ void SerialHandler::readSerialData() {
 
             if (c == '\n' || c == '\r') {
                 if (serialBuffer.length() > 1) {
-                    if (currentState == UPLOAD_DATA_MODE) {
-                        String trimmedData = serialBuffer;
-                        trimmedData.trim();
-
-                        if (trimmedData.equalsIgnoreCase("END")) {
-                            processEndCommand();
-                        } else if (trimmedData.equalsIgnoreCase("CANCEL")) {
-                            processCancelCommand();
-                        } else {
-                            processKeyValueData(trimmedData);
-                        }
-                    } else {
-                        processSerialCommand(serialBuffer);
-                    }
+                    trace.lineStart();
+                    processLine(serialBuffer);
+                    trace.lineEnd(serialBuffer.length());
                 }
                 serialBuffer = "";
+                updateFlowControl();
             }
         }
     }
 }
+//按当前模式分发一行数据
+void SerialHandler::processLine(const String& line) {
+    String trimmedData = line;
+    trimmedData.trim();
+
+    // STM32的命令确认在任何模式下都优先处理
+    if (processAckLine(trimmedData)) {
+        // 已处理
+    } else if (trimmedData.startsWith("@")) {
+        // 子设备数据不受UPLOAD/STREAM模式影响，按子设备单独批量上传
+        processTaggedLine(trimmedData);
+    } else if (currentState == UPLOAD_DATA_MODE) {
+        if (trimmedData.equalsIgnoreCase("END")) {
+            processEndCommand();
+        } else if (trimmedData.equalsIgnoreCase("CANCEL")) {
+            processCancelCommand();
+        } else {
+            processKeyValueData(trimmedData);
+        }
+    } else if (currentState == STREAM_MODE) {
+        if (trimmedData.equalsIgnoreCase("END") || trimmedData.equalsIgnoreCase("STOP")) {
+            processStopStreamCommand();
+        } else if (trimmedData.equalsIgnoreCase("CANCEL")) {
+            processCancelCommand();
+        } else {
+            processStreamData(trimmedData);
+        }
+    } else {
+        processSerialCommand(trimmedData);
+    }
+}
+//处理子设备行 "@子设备名 key=value" / "@子设备名 LOGIN" / "@子设备名 LOGOUT"
+void SerialHandler::processTaggedLine(const String& line) {
+    if (gateway == nullptr) {
+        Serial.println("网关模式未开启，忽略: " + line);
+        droppedLineCount++;
+        return;
+    }
+
+    int space = line.indexOf(' ');
+    if (space < 0) {
+        space = line.indexOf('\t');
+    }
+    String tag = line.substring(1, space > 0 ? space : line.length());
+    if (tag.length() == 0 || tag.length() > GATEWAY_TAG_MAX_LENGTH || space < 0) {
+        Serial.println("格式错误，请使用格式: @子设备名 key=value");
+        return;
+    }
+    for (unsigned int i = 0; i < tag.length(); i++) {
+        char c = tag.charAt(i);
+        if (!(isalnum(c) || c == '_' || c == '-')) {
+            Serial.println("错误: 子设备名包含无效字符 '" + String(c) + "'");
+            return;
+        }
+    }
+
+    String body = line.substring(space + 1);
+    body.trim();
+    if (body.equalsIgnoreCase("LOGIN")) {
+        gateway->login(tag);
+        return;
+    }
+    if (body.equalsIgnoreCase("LOGOUT")) {
+        gateway->logout(tag);
+        return;
+    }
+
+    String key, value;
+    char separator;
+    if (!validateKeyValueFormat(body, key, value, separator)) {
+        Serial.println("格式错误，请使用格式: @子设备名 key=value");
+        return;
+    }
+    if (!gateway->addSample(tag, key, value)) {
+        droppedLineCount++;
+    }
+}
+//检查接收环形缓冲区溢出和UART硬件错误
+void SerialHandler::checkRxErrors() {
+    if (Serial.hasOverrun()) {
+        rxOverrunCount++;
+        Serial.println("警告: 串口接收缓冲区溢出，数据已丢失");
+        // 丢失的字节可能在行中间，丢弃当前不完整的行
+        serialBuffer = "";
+        droppedLineCount++;
+    }
+    if (Serial.hasRxError()) {
+        rxErrorCount++;
+        Serial.println("警告: 串口接收错误（FIFO溢出或帧错误）");
+    }
+}
 //处理串口命令
 void SerialHandler::processSerialCommand(String command) {
     command.trim();// 去除前后空格
@@ -62,25 +181,136 @@ void SerialHandler::processSerialCommand(String command) {
         Serial.println("处理指令: " + command);
         processUploadDataCommand();
         
+    } else if (command == "STREAM") {
+        Serial.println("处理指令: " + command);
+        processStreamCommand();
+
     } else if (command.equals("GET_TIME")) {
         // 返回当前时间戳
         Serial.println("time:" + String(SimpleTime::getTimestamp()));
     } else if (command == "STATUS") {
         Serial.println("处理指令: " + command);
         String status = "WiFi:" + String(isWiFiConnected() ? "OK" : "FAIL") + 
-                       ",DataBuffer:" + String(dataBuffer.size());
+                       ",Mode:" + String(currentState == STREAM_MODE ? "STREAM" :
+                                         currentState == UPLOAD_DATA_MODE ? "UPLOAD" : "NORMAL") +
+                       ",DataBuffer:" + String(dataBuffer.size()) +
+                       ",Stm32Cmd:" + String(commandQueue.size()) +
+                       ",Fill:" + String(getFillLevel()) + "%" +
+                       ",Flow:" + String(flowPaused ? "PAUSED" : "OK") +
+                       ",Pauses:" + String(flowPauseCount) +
+                       ",SerialDrops:" + String(droppedLineCount) +
+                       ",RxBytes:" + String(rxByteCount) +
+                       ",RxOverrun:" + String(rxOverrunCount) +
+                       ",RxError:" + String(rxErrorCount) +
+                       ",MqttDrops:" + String(mqttHandler ? mqttHandler->getDroppedMessageCount() : 0) +
+                       ",DupSets:" + String(mqttHandler ? mqttHandler->getDuplicateCount() : 0);
+        if (mqttHandler != nullptr) {
+            const TelemetryQueue& telemetry = mqttHandler->getTelemetryQueue();
+            status += ",TelemetryQ:" + String(telemetry.size()) + "/" + String(telemetry.getBytes()) + "B" +
+                      ",Ratio:" + String(telemetry.getRatioX10() / 10.0, 1);
+        }
+#if MQTT_PUBLISH_QOS == 1
+        if (mqttHandler != nullptr) {
+            MqttInflight& inflight = mqttHandler->getInflight();
+            status += ",Inflight:" + String(inflight.size()) + "/" + String(inflight.getWindowSize()) +
+                      ",PubAcks:" + String(inflight.getAckCount()) +
+                      ",Resends:" + String(inflight.getResendCount());
+        }
+#endif
+        if (ruleEngine != nullptr) {
+            status += ",Rules:" + String(ruleEngine->getArmedCount()) + "/" + String(ruleEngine->getRuleCount()) +
+                      ",RuleFires:" + String(ruleEngine->getFireCount()) +
+                      ",RuleMaxUs:" + String(ruleEngine->getMaxLatency());
+        }
+        if (gateway != nullptr) {
+            status += ",SubDevices:" + String(gateway->getOnlineCount()) + "/" + String(gateway->getSubDeviceCount()) +
+                      ",Packs:" + String(gateway->getPackCount()) +
+                      ",SubDrops:" + String(gateway->getDroppedSamples());
+        }
+        if (powerManager != nullptr) {
+            status += ",Awake:" + String(powerManager->getAwakeRatio()) + "%" +
+                      ",Wakes:" + String(powerManager->getWakeCount()) +
+                      ",EventWakes:" + String(powerManager->getEventWakeCount()) +
+                      ",LightSleeps:" + String(powerManager->getLightSleepCount());
+        }
         Serial.println(status);
+    } else if (command.startsWith("QOS_WINDOW")) {
+        // QOS_WINDOW n：调整QoS1在途窗口，用于测试不同窗口下的吞吐
+        if (mqttHandler != nullptr) {
+            long size = command.substring(10).toInt();
+            if (size > 0) {
+                // 直接修改发送窗口，不经过运行参数注册表：否则之后SET其他参数时会把该值一并保存到Flash
+                // 需要保存时用 SET MQTT_QOS1_WINDOW=n
+                mqttHandler->getInflight().setWindowSize(size > MQTT_QOS1_WINDOW_MAX ? MQTT_QOS1_WINDOW_MAX : size);
+            }
+            Serial.println("QoS1窗口: " + String(mqttHandler->getInflight().getWindowSize()));
+        }
+    } else if (command == "SET" || command.startsWith("SET ")) {
+        // SET：列出运行参数；SET KEY=值[,KEY=值]（或 SET KEY 值）：修改并保存；SET DEFAULTS：恢复默认值
+        String args = command.substring(3);
+        args.trim();
+        if (args.length() == 0) {
+            for (uint8_t i = 0; i < SETTING_COUNT; i++) {
+                const SettingInfo& setting = Settings::info((SettingId)i);
+                Serial.println("  " + String(setting.key) + "=" + String(Settings::get((SettingId)i)) +
+                               " (默认 " + String(setting.defaultValue) + "，范围 " +
+                               String(setting.minValue) + "~" + String(setting.maxValue) + ")");
+            }
+        } else if (args.equalsIgnoreCase("DEFAULTS")) {
+            Settings::resetDefaults();
+            Serial.println("运行参数已恢复默认值");
+        } else {
+            int space = args.indexOf(' ');
+            if (args.indexOf('=') < 0 && space > 0) {
+                args = args.substring(0, space) + "=" + args.substring(space + 1);
+            }
+            String message;
+            if (Settings::assign(args, message)) {
+                Serial.println("运行参数已更新: " + message);
+            } else {
+                Serial.println("错误: " + message);
+            }
+        }
+    } else if (command == "TRACE_START") {
+        trace.start();
+    } else if (command == "TRACE_STOP") {
+        trace.stop();
+    } else if (command == "TRACE_DUMP") {
+        if (trace.isActive()) {
+            trace.stop();
+        }
+        trace.dump();
+    } else if (command == "PARSE_STATS") {
+        trace.printStats();
+    } else if (command == "PARSE_STATS_RESET") {
+        trace.resetStats();
+        Serial.println("解析统计已清零");
     } else if (command == "HELP") {
         Serial.println("处理指令: " + command);
         Serial.println("支持的指令:");
         Serial.println("  UPLOAD_DATA - 进入数据上传模式");
+        Serial.println("  STREAM - 进入流式上传模式");
         Serial.println("  GET_TIME - 获取当前时间戳");
         Serial.println("  STATUS - 获取状态");
+        Serial.println("  TRACE_START/TRACE_STOP/TRACE_DUMP - 串口抓包开始/停止/输出");
+        Serial.println("  PARSE_STATS/PARSE_STATS_RESET - 输出/清零解析耗时统计");
+        Serial.println("  QOS_WINDOW n - 设置QoS1在途窗口大小（不带参数时查询）");
+        Serial.println("  SET [KEY=值,...] - 查询/修改运行参数（保存到Flash），SET DEFAULTS 恢复默认值");
         Serial.println("  HELP - 显示帮助");
         Serial.println("\n数据上传模式下:");
         Serial.println("  key=value 或 key:value - 添加键值对数据");
         Serial.println("  END - 结束数据上传并发送到OneNET");
         Serial.println("  CANCEL - 取消数据上传");
+        Serial.println("\n流式上传模式下:");
+        Serial.println("  key=value 或 key:value - 样本立即进入批次，按大小/数量/延迟自动上传");
+        Serial.println("  END 或 STOP - 上传剩余数据并退出流式模式");
+        Serial.println("  CANCEL - 丢弃未上传的数据并退出");
+        Serial.println("\nSTM32命令确认:");
+        Serial.println("  ACK:序号 / NAK:序号 - 确认或拒绝 <CYZ:序号:key=value:CYZ> 数据包（本地规则为 <CYZ:序号:命令:CYZ>）");
+        Serial.println("\n网关模式下（任何模式均可）:");
+        Serial.println("  @子设备名 key=value - 子设备样本，按子设备批量上传");
+        Serial.println("  @子设备名 LOGIN / LOGOUT - 子设备上线/下线");
+        Serial.println("  下发给子设备的数据包为 <CYZ@子设备名:序号:key=value:CYZ>");
     }
     else {
         Serial.println("处理指令: " + command);
@@ -134,6 +364,18 @@ bool SerialHandler::validateKeyValueFormat(const String& data, String& key, Stri
             return false;
         }
     }
+
+    // 按物模型检查属性是否存在、值是否符合类型与范围
+    ThingPropertyId id = thingFindProperty(key.c_str());
+    if (id == TP_COUNT) {
+        Serial.println("错误: 物模型中没有属性 '" + key + "'");
+        return false;
+    }
+    if (!thingParseText(sample, id, value.c_str())) {
+        Serial.println("错误: 属性 " + key + " 的值 '" + value + "' 与物模型类型或范围不符");
+        return false;
+    }
+    sampleId = id;
     
     return true;
 }
@@ -148,9 +390,15 @@ void SerialHandler::processKeyValueData(const String& data) {
         return;
     }
 
+    // 本地规则在缓冲与上传之前求值，缓冲区已满或断网时同样生效
+    if (ruleEngine != nullptr) {
+        ruleEngine->ingest(sampleId, sample);
+    }
+
     // 检查缓冲区大小限制
-    if (dataBuffer.size() >= MAX_DATA_BUFFER_SIZE) {
-        Serial.println("警告: 数据缓冲区已满（最大" + String(MAX_DATA_BUFFER_SIZE) + "条），请先上传数据");
+    if (dataBuffer.size() >= (size_t)Settings::get(CFG_MAX_DATA_BUFFER_SIZE)) {
+        Serial.println("警告: 数据缓冲区已满（最大" + String(Settings::get(CFG_MAX_DATA_BUFFER_SIZE)) + "条），请先上传数据");
+        droppedLineCount++;
         return;
     }
 
@@ -171,26 +419,29 @@ void SerialHandler::processEndCommand() {
 
     if (dataBuffer.empty()) {
         Serial.println("没有数据需要上传");
+    } else if (publishDataBuffer(false)) {
+        Serial.println("成功上传到OneNET");
     } else {
-        String jsonPayload = generateJsonPayload();
-        Serial.println("生成JSON数据: " + jsonPayload);
-
-        if (mqttHandler == nullptr) {
-            Serial.println("错误: MQTT处理器未初始化!");
-            return;
-        }
-        if (jsonPayload.length() == 0) {
-            Serial.println("警告: 要发布的数据为空!");
-            return;
-        }
-        if(mqttHandler->publish(PUB_post_TOPIC, jsonPayload.c_str())) {
-            Serial.println("成功上传到OneNET");
-        }else {
-            Serial.println("上传到OneNET失败");
-        }
+        Serial.println("上传到OneNET失败");
+    }
 
+    clearDataBuffer();
     currentState = NORMAL_MODE;
+}
+//将数据缓冲区生成JSON并发布，queued为true时断线期间进入重传队列
+bool SerialHandler::publishDataBuffer(bool queued) {
+    if (mqttHandler == nullptr) {
+        Serial.println("错误: MQTT处理器未初始化!");
+        return false;
+    }
+    ThingProperties props;
+    collectProperties(props);
+    if (props.empty()) {
+        Serial.println("警告: 要发布的数据为空!");
+        return false;
     }
+    Serial.println("上报 " + String(dataBuffer.size()) + " 条属性数据");
+    return mqttHandler->postProperties(props, queued);
 }
 //取消命令处理
 void SerialHandler::processCancelCommand() {
@@ -202,68 +453,356 @@ void SerialHandler::processCancelCommand() {
     
     Serial.println("已返回正常模式");
 }
-// 生成符合OneNET格式的JSON数据
-String SerialHandler::generateJsonPayload() const {
-    StaticJsonDocument<1024> doc;
+//进入流式上传模式
+void SerialHandler::processStreamCommand() {
+    Serial.println("进入流式上传模式...");
+    Serial.println("每行 key=value 立即进入批次，满 " + String(Settings::get(CFG_STREAM_BATCH_MAX_SAMPLES)) + " 条/" +
+                   String(Settings::get(CFG_STREAM_BATCH_MAX_BYTES)) + " 字节或等待 " + String(Settings::get(CFG_STREAM_BATCH_MAX_LATENCY)) + "ms 自动上传");
+    Serial.println("输入 'END' 或 'STOP' 上传剩余数据并退出，输入 'CANCEL' 丢弃并退出");
 
-    doc["id"] = String(millis());
-    doc["version"] = "1.0";
+    clearDataBuffer();
+    currentState = STREAM_MODE;
+}
+//流式样本处理：加入当前批次，达到字节或数量上限时立即上传
+void SerialHandler::processStreamData(const String& data) {
+    String key, value;
+    char separator;
 
-    JsonObject params = doc.createNestedObject("params");
+    if (!validateKeyValueFormat(data, key, value, separator)) {
+        Serial.println("格式错误，请使用格式: key=value 或 key:value");
+        return;
+    }
+
+    // 本地规则在缓冲与上传之前求值，缓冲区已满或断网时同样生效
+    if (ruleEngine != nullptr) {
+        ruleEngine->ingest(sampleId, sample);
+    }
 
+    // 同一批次内出现重复的键时先上传，避免后一个样本覆盖前一个
     for (const auto& kv : dataBuffer) {
-        if (kv.isValid) {
-            JsonObject paramValue = params[kv.key].to<JsonObject>();
-        if (isInteger(kv.value)) {
-            paramValue["value"] = kv.value.toInt();
+        if (kv.key == key) {
+            flushStreamBatch();
+            break;
         }
-        else if (isFloat(kv.value)) {
-            // 强制对齐步长0.1：先四舍五入到1位小数，确保是0.1的整数倍
-            double value = kv.value.toDouble();
-            long roundedTenths = lround(value * 10.0);
-            double rounded = roundedTenths / 10.0;
-            // 调试输出：打印原始值和四舍五入后的值
-            //Serial.println("  浮点数处理: " + kv.value + " -> " + String(value, 8) + " -> " + String(rounded, 8));
-            paramValue["value"] = rounded;
+    }
+
+    // 估算该样本在JSON中的长度: "key":{"value":value},
+    size_t sampleBytes = key.length() + value.length() + 16;
+    if (!dataBuffer.empty() && batchBytes + sampleBytes > (size_t)Settings::get(CFG_STREAM_BATCH_MAX_BYTES)) {
+        flushStreamBatch();
+    }
+
+    // 上传被推迟（发送队列已满）时批次继续累积，缓冲区满后才丢弃
+    if (dataBuffer.size() >= (size_t)Settings::get(CFG_MAX_DATA_BUFFER_SIZE)) {
+        Serial.println("警告: 数据缓冲区已满，丢弃样本: " + key);
+        droppedLineCount++;
+        return;
+    }
+
+    if (dataBuffer.empty()) {
+        batchStartTime = millis();
+    }
+
+    KeyValueData kvData;
+    kvData.key = key;
+    kvData.value = value;
+    kvData.isValid = true;
+    dataBuffer.push_back(kvData);
+    batchBytes += sampleBytes;
+
+    if (dataBuffer.size() >= (size_t)Settings::get(CFG_STREAM_BATCH_MAX_SAMPLES)) {
+        flushStreamBatch();
+    }
+}
+//上传流式批次；MQTT断线且发送队列已满时保留批次，稍后重试
+bool SerialHandler::flushStreamBatch() {
+    if (dataBuffer.empty()) {
+        return true;
+    }
+    if (mqttHandler != nullptr && !mqttHandler->isConnected() && mqttHandler->isQueueFull()) {
+        return false;
+    }
+    publishDataBuffer(true);
+    clearDataBuffer();
+    return true;
+}
+//退出流式上传模式，上传剩余数据
+void SerialHandler::processStopStreamCommand() {
+    Serial.println("\n结束流式上传模式");
+    if (!dataBuffer.empty()) {
+        publishDataBuffer(true);
+    }
+    clearDataBuffer();
+    currentState = NORMAL_MODE;
+    Serial.println("已返回正常模式");
+}
+//流式批次的延迟上限与UPLOAD_DATA模式的超时检查
+void SerialHandler::checkUploadTimers() {
+    unsigned long currentTime = millis();
+
+    if (currentState == STREAM_MODE) {
+        if (!dataBuffer.empty() && currentTime - batchStartTime >= (unsigned long)Settings::get(CFG_STREAM_BATCH_MAX_LATENCY)) {
+            flushStreamBatch();
         }
-        else {
-            paramValue["value"] = kv.value;
+    } else if (currentState == UPLOAD_DATA_MODE) {
+        if (currentTime - uploadStartTime >= (unsigned long)Settings::get(CFG_UPLOAD_DATA_TIMEOUT)) {
+            Serial.println("\n数据上传模式超时，未收到END");
+            processEndCommand();
+        }
+    }
+}
+// 将数据缓冲区中的有效数据按物模型类型解析到props
+void SerialHandler::collectProperties(ThingProperties& props) const {
+    for (const auto& kv : dataBuffer) {
+        if (kv.isValid) {
+            thingParseText(props, thingFindProperty(kv.key.c_str()), kv.value.c_str());
         }
-     }
-  }
+    }
+}
+// 生成符合OneNET格式的JSON数据（按物模型类型序列化，容量在编译期确定）
+String SerialHandler::generateJsonPayload() const {
+    ThingProperties props;
+    collectProperties(props);
+    if (props.empty()) {
+        return "";
+    }
+
     String jsonStr;
-    serializeJson(doc, jsonStr);
+    thingSerializePost(props, TopicCache::nextId(), jsonStr);
     return jsonStr;
 }
 
 void SerialHandler::clearDataBuffer() {
     dataBuffer.clear();
-    uploadStartTime = 0;
+    batchStartTime = 0;
+    batchBytes = 0;
 }
 
 bool SerialHandler::isWiFiConnected() {
     return (wifiMulti.run() == WL_CONNECTED);
 }
-// 判断字符串是否为整数
-bool SerialHandler::isInteger(const String& value) const {
-    for (unsigned int j = 0; j < value.length(); j++) {
-        if (!isdigit(value.charAt(j)) && value.charAt(j) != '-') {
-            return false;
+
+/*=====================STM32命令通道========================*/
+
+//周期性处理，在loop()中调用
+void SerialHandler::update() {
+    processCommandQueue();
+    checkUploadTimers();
+    updateFlowControl();
+}
+//距下一个定时事件的时间，供低功耗管理器决定休眠时长
+unsigned long SerialHandler::getNextDeadlineIn(unsigned long now) const {
+    unsigned long next = POWER_NO_DEADLINE;
+
+    if (currentState == STREAM_MODE && !dataBuffer.empty()) {
+        next = PowerManager::timeUntil(batchStartTime, Settings::get(CFG_STREAM_BATCH_MAX_LATENCY), now);
+    } else if (currentState == UPLOAD_DATA_MODE) {
+        next = PowerManager::timeUntil(uploadStartTime, Settings::get(CFG_UPLOAD_DATA_TIMEOUT), now);
+    }
+
+    int inFlight = 0;
+    bool hasQueued = false;
+    for (const auto& cmd : commandQueue) {
+        if (cmd.state == CMD_IN_FLIGHT) {
+            inFlight++;
+            unsigned long due = PowerManager::timeUntil(cmd.sentTime, Settings::get(CFG_STM32_CMD_TIMEOUT), now);
+            if (due < next) {
+                next = due;
+            }
+        } else {
+            hasQueued = true;
         }
     }
-    return value.length() > 0;
+    // 有排队命令且窗口未满，需要立即发送
+    if (hasQueued && inFlight < STM32_CMD_WINDOW) {
+        next = 0;
+    }
+    return next;
 }
-// 判断字符串是否为浮点数
-bool SerialHandler::isFloat(const String& value) const {
-    int dotCount = 0;
-    for (unsigned int j = 0; j < value.length(); j++) {
-        char c = value.charAt(j);
-        if (c == '.') {
-            dotCount++;
-        } else if (!isdigit(c) && c != '-') {
-            return false;
+//将命令加入队列，flush为true时在途窗口未满立即发送
+uint16_t SerialHandler::sendStm32Command(const String& payload, bool flush, const char* tag) {
+    if (commandQueue.size() >= STM32_CMD_QUEUE_SIZE) {
+        Serial.println("警告: STM32命令队列已满，丢弃命令: " + payload);
+        return 0;
+    }
+
+    Stm32Command cmd;
+    cmd.seq = nextCommandSeq;
+    cmd.payload = payload;
+    cmd.tag = tag != nullptr ? tag : "";
+    cmd.state = CMD_QUEUED;
+    cmd.retryCount = 0;
+    cmd.sentTime = 0;
+    commandQueue.push_back(cmd);
+
+    // 序号0保留为"无效"，回绕时跳过
+    nextCommandSeq++;
+    if (nextCommandSeq == 0) {
+        nextCommandSeq = 1;
+    }
+
+    if (flush) {
+        processCommandQueue();
+    }
+    return cmd.seq;
+}
+//处理确认超时与重发，并在窗口允许时发送排队中的命令
+void SerialHandler::processCommandQueue() {
+    if (commandQueue.empty()) {
+        return;
+    }
+
+    unsigned long currentTime = millis();
+    std::vector<uint16_t> failedSeqs;
+    String frames; // 本轮要发送的数据包，合并为一次串口写入
+    int inFlight = 0;
+
+    for (auto it = commandQueue.begin(); it != commandQueue.end(); ) {
+        if (it->state == CMD_IN_FLIGHT && currentTime - it->sentTime >= (unsigned long)Settings::get(CFG_STM32_CMD_TIMEOUT)) {
+            if (it->retryCount >= STM32_CMD_MAX_RETRY) {
+                Serial.println("STM32命令确认超时（已达最大重发次数）: seq=" + String(it->seq));
+                failedSeqs.push_back(it->seq);
+                it = commandQueue.erase(it);
+                continue;
+            }
+            it->retryCount++;
+            Serial.println("STM32命令确认超时，重发: seq=" + String(it->seq) + " (重试: " + String(it->retryCount) + ")");
+            writeCommandFrame(*it, frames);
+        }
+        if (it->state == CMD_IN_FLIGHT) {
+            inFlight++;
+        }
+        ++it;
+    }
+
+    // 按入队顺序填满在途窗口
+    for (auto& cmd : commandQueue) {
+        if (inFlight >= STM32_CMD_WINDOW) {
+            break;
+        }
+        if (cmd.state == CMD_QUEUED) {
+            writeCommandFrame(cmd, frames);
+            inFlight++;
+        }
+    }
+
+    if (frames.length() > 0) {
+        Serial.print(frames);
+        if (powerManager != nullptr) {
+            powerManager->noteActivity();
+        }
+    }
+
+    // 队列遍历结束后再通知，避免回调中修改队列
+    if (mqttHandler != nullptr) {
+        for (uint16_t seq : failedSeqs) {
+            mqttHandler->onStm32CommandResult(seq, false);
         }
     }
-    return dotCount == 1 && value.length() > 1;
 }
+//生成命令数据包 <CYZ:序号:命令:CYZ>（子设备为 <CYZ@子设备名:序号:命令:CYZ>），追加到待发送缓冲
+// 属性设置的命令为 key=value，本地规则的命令为注册表中的命令名（不含'='）
+void SerialHandler::writeCommandFrame(Stm32Command& cmd, String& frames) {
+    frames += "<CYZ";
+    if (cmd.tag.length() > 0) {
+        frames += '@';
+        frames += cmd.tag;
+    }
+    frames += ":" + String(cmd.seq) + ":" + cmd.payload + ":CYZ>\r\n";
+    cmd.state = CMD_IN_FLIGHT;
+    cmd.sentTime = millis();
+}
+//解析STM32确认行 ACK:序号 / NAK:序号，不是确认行时返回false
+bool SerialHandler::processAckLine(const String& line) {
+    bool isAck = line.startsWith("ACK:");
+    if (!isAck && !line.startsWith("NAK:")) {
+        return false;
+    }
 
+    long seq = line.substring(4).toInt();
+    for (auto it = commandQueue.begin(); it != commandQueue.end(); ++it) {
+        if (it->state == CMD_IN_FLIGHT && it->seq == seq) {
+            commandQueue.erase(it);
+            if (!isAck) {
+                Serial.println("STM32拒绝命令: seq=" + String(seq));
+            }
+            if (mqttHandler != nullptr) {
+                mqttHandler->onStm32CommandResult((uint16_t)seq, isAck);
+            }
+            // 窗口腾出空位，立即发送下一条
+            processCommandQueue();
+            return true;
+        }
+    }
+
+    Serial.println("警告: 收到未知序号的确认: " + line);
+    return true;
+}
+
+/*=====================串口流控========================*/
+
+//串口接收缓冲区的填充率(%)
+int SerialHandler::getRxLevel() const {
+    return Serial.available() * 100 / SERIAL_RX_BUFFER_SIZE;
+}
+//数据缓冲区与MQTT发送队列中较高的填充率(%)
+// UPLOAD_DATA模式下数据缓冲区要收到END才上传清空，暂停STM32只会让END发不过来，因此不计入
+int SerialHandler::getBufferLevel() const {
+    int level = 0;
+    if (currentState != UPLOAD_DATA_MODE) {
+        level = dataBuffer.size() * 100 / Settings::get(CFG_MAX_DATA_BUFFER_SIZE);
+    }
+    if (mqttHandler != nullptr) {
+        int queueLevel = mqttHandler->getQueueLevel();
+        if (queueLevel > level) {
+            level = queueLevel;
+        }
+    }
+    return level;
+}
+//驱动流控的填充率(%)：串口接收缓冲区，以及未因暂停超时被豁免的数据缓冲区/发送队列，取较高者
+int SerialHandler::getFillLevel() const {
+    int level = getRxLevel();
+    if (!flowBufferIgnored) {
+        int bufferLevel = getBufferLevel();
+        if (bufferLevel > level) {
+            level = bufferLevel;
+        }
+    }
+    return level;
+}
+//按填充率和高低水位（带滞回）暂停或恢复STM32发送
+void SerialHandler::updateFlowControl() {
+#if FLOW_CONTROL_MODE != 0
+    if (flowBufferIgnored && getBufferLevel() <= FLOW_LOW_WATERMARK) {
+        flowBufferIgnored = false;
+    }
+    int level = getFillLevel();
+
+    if (!flowPaused && level >= FLOW_HIGH_WATERMARK) {
+        setFlowPaused(true);
+    } else if (flowPaused && level <= FLOW_LOW_WATERMARK) {
+        setFlowPaused(false);
+    } else if (flowPaused && getRxLevel() < FLOW_HIGH_WATERMARK && millis() - flowPauseStart >= FLOW_MAX_PAUSE) {
+        // 数据缓冲区或发送队列长时间无法排空（如断网时队列已满、流式批次被保留），不再因它们暂停，
+        // 否则STM32的确认行一直发不过来，设备也无法睡眠；已满后新数据按溢出处理
+        flowBufferIgnored = true;
+        setFlowPaused(false);
+        Serial.println("串口流控: 暂停超过" + String(FLOW_MAX_PAUSE) + "ms，数据缓冲区与发送队列暂不参与流控");
+    }
+#endif
+}
+//发送XOFF/XON或拉高/拉低RTS
+void SerialHandler::setFlowPaused(bool paused) {
+    flowPaused = paused;
+    if (paused) {
+        flowPauseCount++;
+        flowPauseStart = millis();
+    }
+#if FLOW_CONTROL_MODE == 1
+    Serial.write((uint8_t)(paused ? 0x13 : 0x11)); // XOFF / XON
+#elif FLOW_CONTROL_MODE == 2
+    digitalWrite(FLOW_RTS_PIN, paused ? HIGH : LOW);
+#endif
+    LOG_DEBUG(paused ? "串口流控: 暂停STM32发送" : "串口流控: 恢复STM32发送");
+}
@@ -0,0 +1,160 @@
+#include <SerialTrace.h>
+
+#ifdef TRACE_ALLOC_COUNT
+#include <stdlib.h>
+
+// 通过链接器--wrap统计堆分配次数（含String扩容），只在抓包/基准测试固件中启用
+static volatile uint32_t allocCounter = 0;
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void* __real_calloc(size_t count, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    allocCounter++;
+    return __real_malloc(size);
+}
+void* __wrap_realloc(void* ptr, size_t size) {
+    allocCounter++;
+    return __real_realloc(ptr, size);
+}
+void* __wrap_calloc(size_t count, size_t size) {
+    allocCounter++;
+    return __real_calloc(count, size);
+}
+}
+
+uint32_t serialTraceAllocCount() {
+    return allocCounter;
+}
+#else
+uint32_t serialTraceAllocCount() {
+    return 0;
+}
+#endif
+
+//构造函数
+SerialTrace::SerialTrace() {
+    active = false;
+    lastRecordTime = 0;
+    recordCount = 0;
+    lostBytes = 0;
+    resetStats();
+}
+//开始抓包
+void SerialTrace::start() {
+    buffer.clear();
+    buffer.reserve(TRACE_BUFFER_SIZE);
+    recordCount = 0;
+    lostBytes = 0;
+    lastRecordTime = millis();
+    active = true;
+    Serial.println("开始串口抓包，缓冲区 " + String(TRACE_BUFFER_SIZE) + " 字节");
+}
+//停止抓包
+void SerialTrace::stop() {
+    active = false;
+    Serial.println("停止串口抓包: " + String(recordCount) + " 条记录，" + String(buffer.size()) +
+                   " 字节，丢失 " + String(lostBytes) + " 字节");
+}
+
+void SerialTrace::writeVarint(uint32_t value) {
+    while (value >= 0x80) {
+        buffer.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back((uint8_t)value);
+}
+//记录一段原始字节，缓冲区放不下时只计数
+void SerialTrace::record(const char* data, size_t length) {
+    if (!active || length == 0) {
+        return;
+    }
+    // 头部最多 5+5 字节
+    if (buffer.size() + length + 10 > TRACE_BUFFER_SIZE) {
+        lostBytes += length;
+        return;
+    }
+
+    unsigned long now = millis();
+    writeVarint(now - lastRecordTime);
+    writeVarint(length);
+    buffer.insert(buffer.end(), (const uint8_t*)data, (const uint8_t*)data + length);
+    lastRecordTime = now;
+    recordCount++;
+}
+//以十六进制行输出抓包数据，每行32字节
+void SerialTrace::dump() const {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+
+    Serial.println("TRACE_BEGIN records=" + String(recordCount) + ",bytes=" + String(buffer.size()) +
+                   ",lost=" + String(lostBytes));
+    uint16_t sum = 0;
+    char line[6 + 64 + 1];
+    memcpy(line, "TRACE:", 6);
+    for (size_t offset = 0; offset < buffer.size(); offset += 32) {
+        size_t count = buffer.size() - offset < 32 ? buffer.size() - offset : 32;
+        for (size_t i = 0; i < count; i++) {
+            uint8_t b = buffer[offset + i];
+            line[6 + i * 2] = HEX_DIGITS[b >> 4];
+            line[6 + i * 2 + 1] = HEX_DIGITS[b & 0x0F];
+            sum += b;
+        }
+        line[6 + count * 2] = '\0';
+        Serial.println(line);
+        yield();
+    }
+    Serial.println("TRACE_END sum=" + String(sum));
+}
+
+void SerialTrace::lineStart() {
+    skipLine = false;
+    lineStartAllocs = serialTraceAllocCount();
+    lineStartMicros = micros();
+}
+
+void SerialTrace::lineEnd(size_t bytes) {
+    if (skipLine) {
+        return;
+    }
+    unsigned long elapsed = micros() - lineStartMicros;
+    allocCount += serialTraceAllocCount() - lineStartAllocs;
+    lineCount++;
+    lineBytes += bytes;
+    totalMicros += elapsed;
+    if (elapsed > maxMicros) {
+        maxMicros = elapsed;
+    }
+    uint32_t freeHeap = ESP.getFreeHeap();
+    if (freeHeap < minFreeHeap) {
+        minFreeHeap = freeHeap;
+    }
+}
+//输出解析统计，AllocsPerLine为-1表示固件未启用分配计数
+void SerialTrace::printStats() const {
+#ifdef TRACE_ALLOC_COUNT
+    String allocs = lineCount ? String((float)allocCount / lineCount, 2) : String("0");
+#else
+    String allocs = "-1";
+#endif
+    Serial.println("Lines:" + String(lineCount) +
+                   ",Bytes:" + String(lineBytes) +
+                   ",AvgUs:" + String(lineCount ? totalMicros / lineCount : 0) +
+                   ",MaxUs:" + String(maxMicros) +
+                   ",TotalUs:" + String(totalMicros) +
+                   ",AllocsPerLine:" + allocs +
+                   ",HeapMin:" + String(lineCount ? minFreeHeap : ESP.getFreeHeap()));
+}
+
+void SerialTrace::resetStats() {
+    lineCount = 0;
+    lineBytes = 0;
+    totalMicros = 0;
+    maxMicros = 0;
+    allocCount = 0;
+    minFreeHeap = 0xFFFFFFFF;
+    lineStartMicros = 0;
+    lineStartAllocs = 0;
+    skipLine = true;
+}
@@ -0,0 +1,231 @@
+#include <Settings.h>
+#include <EEPROM.h>
+
+// 运行参数注册表，顺序与SettingId一致
+static const SettingInfo SETTING_REGISTRY[SETTING_COUNT] = {
+    {"MAX_QUEUE_SIZE", MAX_QUEUE_SIZE, 1, 50},
+    {"MAX_RETRY_COUNT", MAX_RETRY_COUNT, 1, 20},
+    {"MQTT_RETRY_DELAY", MQTT_RETRY_DELAY, 100, 600000},
+    {"MAX_DATA_BUFFER_SIZE", MAX_DATA_BUFFER_SIZE, 1, 200},
+    {"MAX_MESSAGE_LENGTH", MAX_MESSAGE_LENGTH, 16, 1024},
+    {"STREAM_BATCH_MAX_BYTES", STREAM_BATCH_MAX_BYTES, 64, 4096},
+    {"STREAM_BATCH_MAX_SAMPLES", STREAM_BATCH_MAX_SAMPLES, 1, 200},
+    {"STREAM_BATCH_MAX_LATENCY", STREAM_BATCH_MAX_LATENCY, 0, 60000},
+    {"UPLOAD_DATA_TIMEOUT", UPLOAD_DATA_TIMEOUT, 1000, 600000},
+    {"TELEMETRY_QUEUE_BYTES", TELEMETRY_QUEUE_BYTES, 256, 16384},
+    {"TELEMETRY_DRAIN_PER_LOOP", TELEMETRY_DRAIN_PER_LOOP, 1, 32},
+    {"MQTT_QOS1_WINDOW", MQTT_QOS1_WINDOW, 1, MQTT_QOS1_WINDOW_MAX},
+    {"STM32_CMD_TIMEOUT", STM32_CMD_TIMEOUT, 50, 10000},
+    {"HEARTBEAT_INTERVAL", HEARTBEAT_INTERVAL, 5000, 3600000},
+};
+
+// Flash中运行参数存储区的头部标记与格式版本
+static const uint16_t SETTINGS_MAGIC = 0x4643; // "CF"
+static const uint8_t SETTINGS_LAYOUT_VERSION = 1;
+static const size_t SETTINGS_HEADER_SIZE = 4;
+static const size_t SETTINGS_ENTRY_SIZE = 5;
+
+static_assert(SETTINGS_HEADER_SIZE + SETTING_COUNT * SETTINGS_ENTRY_SIZE + 2 <= SETTINGS_EEPROM_SIZE,
+              "SETTINGS_EEPROM_SIZE不足以保存全部运行参数");
+
+int32_t Settings::values[SETTING_COUNT] = {0};
+void (*Settings::changeCallback)(SettingId id) = nullptr;
+
+// CRC-16/CCITT-FALSE
+static uint16_t crc16(uint16_t crc, uint8_t b) {
+    crc ^= (uint16_t)b << 8;
+    for (uint8_t i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+//从Flash载入运行参数
+void Settings::begin() {
+    for (uint8_t i = 0; i < SETTING_COUNT; i++) {
+        values[i] = SETTING_REGISTRY[i].defaultValue;
+    }
+
+    EEPROM.begin(EEPROM_TOTAL_SIZE);
+    const int base = SETTINGS_EEPROM_OFFSET;
+    uint16_t magic = EEPROM.read(base) | (EEPROM.read(base + 1) << 8);
+    uint8_t version = EEPROM.read(base + 2);
+    uint8_t count = EEPROM.read(base + 3);
+    size_t length = SETTINGS_HEADER_SIZE + count * SETTINGS_ENTRY_SIZE;
+    if (magic != SETTINGS_MAGIC || length + 2 > SETTINGS_EEPROM_SIZE) {
+        Serial.println("运行参数: Flash中没有保存的参数，使用默认值");
+        return;
+    }
+    if (version != SETTINGS_LAYOUT_VERSION) {
+        Serial.println("运行参数: 存储格式版本 " + String(version) + " 不支持，使用默认值");
+        return;
+    }
+
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc = crc16(crc, EEPROM.read(base + i));
+    }
+    uint16_t stored = EEPROM.read(base + length) | (EEPROM.read(base + length + 1) << 8);
+    if (crc != stored) {
+        Serial.println("运行参数: Flash数据校验失败，使用默认值");
+        return;
+    }
+
+    int restored = 0;
+    for (uint8_t n = 0; n < count; n++) {
+        int pos = base + SETTINGS_HEADER_SIZE + n * SETTINGS_ENTRY_SIZE;
+        uint8_t id = EEPROM.read(pos);
+        uint32_t value = 0;
+        for (uint8_t b = 0; b < 4; b++) {
+            value |= (uint32_t)EEPROM.read(pos + 1 + b) << (8 * b);
+        }
+        // 新固件缩小了范围或删除了参数时，对应的旧值被忽略
+        if (id < SETTING_COUNT && set((SettingId)id, (int32_t)value)) {
+            restored++;
+        } else {
+            Serial.println("运行参数: 忽略无效的保存值 (编号 " + String(id) + ")");
+        }
+    }
+    Serial.println("运行参数: 已从Flash恢复 " + String(restored) + " 个参数");
+}
+//修改参数，超出范围时不修改
+bool Settings::set(SettingId id, int32_t value) {
+    if (id >= SETTING_COUNT) {
+        return false;
+    }
+    const SettingInfo& setting = SETTING_REGISTRY[id];
+    if (value < setting.minValue || value > setting.maxValue) {
+        return false;
+    }
+    if (values[id] != value) {
+        values[id] = value;
+        if (changeCallback != nullptr) {
+            changeCallback(id);
+        }
+    }
+    return true;
+}
+//按名称查找参数
+SettingId Settings::find(const char* key) {
+    for (uint8_t i = 0; i < SETTING_COUNT; i++) {
+        if (strcasecmp(key, SETTING_REGISTRY[i].key) == 0) {
+            return (SettingId)i;
+        }
+    }
+    return SETTING_COUNT;
+}
+
+const SettingInfo& Settings::info(SettingId id) {
+    return SETTING_REGISTRY[id < SETTING_COUNT ? id : 0];
+}
+//解析并应用 "KEY=值[,KEY=值...]"
+bool Settings::assign(const String& text, String& message) {
+    SettingId ids[SETTING_COUNT];
+    int32_t parsed[SETTING_COUNT];
+    uint8_t count = 0;
+
+    // 先全部校验，任一项无效时都不修改，避免只应用了一部分
+    int start = 0;
+    while (start < (int)text.length()) {
+        int end = start;
+        while (end < (int)text.length() && text.charAt(end) != ',' && text.charAt(end) != ';') {
+            end++;
+        }
+        String item = text.substring(start, end);
+        start = end + 1;
+        item.trim();
+        if (item.length() == 0) {
+            continue;
+        }
+
+        int equalPos = item.indexOf('=');
+        if (equalPos <= 0) {
+            message = "格式错误: " + item + "，应为 KEY=值";
+            return false;
+        }
+        String key = item.substring(0, equalPos);
+        String valueText = item.substring(equalPos + 1);
+        key.trim();
+        valueText.trim();
+
+        SettingId id = find(key.c_str());
+        if (id == SETTING_COUNT) {
+            message = "未知参数: " + key;
+            return false;
+        }
+        char* endPtr = nullptr;
+        long value = strtol(valueText.c_str(), &endPtr, 10);
+        const SettingInfo& setting = SETTING_REGISTRY[id];
+        if (valueText.length() == 0 || *endPtr != '\0' || value < setting.minValue || value > setting.maxValue) {
+            message = "参数 " + String(setting.key) + " 的值 '" + valueText + "' 无效，范围 " +
+                      String(setting.minValue) + "~" + String(setting.maxValue);
+            return false;
+        }
+        if (count >= SETTING_COUNT) {
+            message = "参数过多";
+            return false;
+        }
+        ids[count] = id;
+        parsed[count] = value;
+        count++;
+    }
+
+    if (count == 0) {
+        message = "没有要修改的参数";
+        return false;
+    }
+    message = "";
+    for (uint8_t i = 0; i < count; i++) {
+        set(ids[i], parsed[i]);
+        if (i > 0) {
+            message += ',';
+        }
+        message += String(SETTING_REGISTRY[ids[i]].key) + "=" + String(parsed[i]);
+    }
+    if (!save()) {
+        message += "（保存到Flash失败，重启后恢复原值）";
+    }
+    return true;
+}
+//恢复默认值
+void Settings::resetDefaults() {
+    for (uint8_t i = 0; i < SETTING_COUNT; i++) {
+        set((SettingId)i, SETTING_REGISTRY[i].defaultValue);
+    }
+    save();
+}
+//保存与默认值不同的参数
+bool Settings::save() {
+    const int base = SETTINGS_EEPROM_OFFSET;
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < SETTING_COUNT; i++) {
+        if (values[i] == SETTING_REGISTRY[i].defaultValue) {
+            continue;
+        }
+        int pos = base + SETTINGS_HEADER_SIZE + count * SETTINGS_ENTRY_SIZE;
+        EEPROM.write(pos, i);
+        for (uint8_t b = 0; b < 4; b++) {
+            EEPROM.write(pos + 1 + b, ((uint32_t)values[i] >> (8 * b)) & 0xFF);
+        }
+        count++;
+    }
+    EEPROM.write(base, SETTINGS_MAGIC & 0xFF);
+    EEPROM.write(base + 1, SETTINGS_MAGIC >> 8);
+    EEPROM.write(base + 2, SETTINGS_LAYOUT_VERSION);
+    EEPROM.write(base + 3, count);
+
+    size_t length = SETTINGS_HEADER_SIZE + count * SETTINGS_ENTRY_SIZE;
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc = crc16(crc, EEPROM.read(base + i));
+    }
+    EEPROM.write(base + length, crc & 0xFF);
+    EEPROM.write(base + length + 1, crc >> 8);
+
+    // EEPROM库只在内容变化时才擦写Flash
+    if (!EEPROM.commit()) {
+        Serial.println("运行参数: 写入Flash失败");
+        return false;
+    }
+    return true;
+}
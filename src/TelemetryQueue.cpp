@@ -0,0 +1,165 @@
+#include <TelemetryQueue.h>
+
+// 属性值按uint32编码；present位图的宽度随物模型属性数变化（超过32个属性时为uint64）
+template <class T>
+static void writeVarint(std::vector<uint8_t>& out, T value) {
+    while (value >= 0x80) {
+        out.push_back((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(value);
+}
+
+template <class T>
+static bool readVarint(const uint8_t* data, size_t length, size_t& pos, T& value) {
+    value = 0;
+    for (uint8_t shift = 0; shift < sizeof(T) * 8; shift += 7) {
+        if (pos >= length) {
+            return false;
+        }
+        uint8_t b = data[pos++];
+        value |= (T)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 有符号差值映射为无符号数，绝对值小的差值编码后也短
+static uint32_t zigzagEncode(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t zigzagDecode(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+TelemetryQueue::TelemetryQueue() {
+    scratch.reserve(64);
+    clear();
+    droppedCount = 0;
+    encodedBytes = 0;
+    expandedBytes = 0;
+}
+
+void TelemetryQueue::clear() {
+    buffer.clear();
+    head = 0;
+    recordCount = 0;
+    peekLength = 0;
+    maxRecordLength = 32;
+    for (uint8_t i = 0; i < TP_COUNT; i++) {
+        encodeBase[i] = 0;
+        decodeBase[i] = 0;
+    }
+}
+
+bool TelemetryQueue::push(const ThingProperties& props) {
+    int32_t values[TP_COUNT];
+    scratch.clear();
+    writeVarint(scratch, props.present);
+    for (uint8_t i = 0; i < TP_COUNT; i++) {
+        ThingPropertyId id = (ThingPropertyId)i;
+        values[i] = encodeBase[i];
+        if (!props.has(id)) {
+            continue;
+        }
+        const String* str = thingStringField(props, id);
+        if (str != nullptr) {
+            writeVarint(scratch, str->length());
+            scratch.insert(scratch.end(), (const uint8_t*)str->c_str(), (const uint8_t*)str->c_str() + str->length());
+        } else {
+            values[i] = thingGetScaled(props, id);
+            // 按无符号数相减，跨越int32范围的差值回绕后仍能还原
+            writeVarint(scratch, zigzagEncode((int32_t)((uint32_t)values[i] - (uint32_t)encodeBase[i])));
+        }
+    }
+
+    if (scratch.size() > maxRecordLength) {
+        maxRecordLength = scratch.size();
+    }
+    if (getBytes() + scratch.size() > getCapacity()) {
+        droppedCount++;
+        return false;
+    }
+
+    // 已出队的部分超过一半时前移剩余数据，避免buffer无限增长
+    if (head > 0 && head >= buffer.size() / 2) {
+        buffer.erase(buffer.begin(), buffer.begin() + head);
+        head = 0;
+    }
+    buffer.insert(buffer.end(), scratch.begin(), scratch.end());
+    memcpy(encodeBase, values, sizeof(encodeBase));
+    recordCount++;
+    return true;
+}
+
+bool TelemetryQueue::peek(ThingProperties& props) {
+    if (recordCount == 0) {
+        return false;
+    }
+
+    const uint8_t* data = buffer.data() + head;
+    size_t length = buffer.size() - head;
+    size_t pos = 0;
+    decltype(props.present) present;
+    if (!readVarint(data, length, pos, present)) {
+        return false;
+    }
+
+    props.clear();
+    memcpy(peekBase, decodeBase, sizeof(peekBase));
+    for (uint8_t i = 0; i < TP_COUNT; i++) {
+        ThingPropertyId id = (ThingPropertyId)i;
+        if (!((present >> i) & 1)) {
+            continue;
+        }
+        uint32_t value;
+        if (!readVarint(data, length, pos, value)) {
+            return false;
+        }
+        String* str = thingStringField(props, id);
+        if (str != nullptr) {
+            if (value > length - pos) {
+                return false;
+            }
+            str->reserve(value);
+            *str = "";
+            str->concat((const char*)data + pos, value);
+            pos += value;
+        } else {
+            peekBase[i] = (int32_t)((uint32_t)decodeBase[i] + (uint32_t)zigzagDecode(value));
+            thingSetScaled(props, id, peekBase[i]);
+        }
+    }
+    props.present = present;
+    peekLength = pos;
+    return true;
+}
+
+void TelemetryQueue::pop(size_t expandedLength) {
+    if (recordCount == 0) {
+        return;
+    }
+    if (peekLength == 0) {
+        ThingProperties props;
+        if (!peek(props)) {
+            // 记录损坏，后续记录的差值基准已无法确定，整体丢弃
+            droppedCount += recordCount;
+            clear();
+            return;
+        }
+    }
+
+    encodedBytes += peekLength;
+    expandedBytes += expandedLength;
+    memcpy(decodeBase, peekBase, sizeof(decodeBase));
+    head += peekLength;
+    peekLength = 0;
+    recordCount--;
+    if (recordCount == 0) {
+        buffer.clear();
+        head = 0;
+    }
+}
@@ -12,6 +12,8 @@ const unsigned long SimpleTime::NTP_UPDATE_INTERVAL = 3600000;
 // 初始化
 void SimpleTime::begin() {
     timeClient.setTimeOffset(8 * 3600);
+    // NTPClient默认每60秒请求一次，统一为每小时一次，避免频繁唤醒射频
+    timeClient.setUpdateInterval(NTP_UPDATE_INTERVAL);
     timeClient.begin();
 
     Serial.println("时间模块初始化完成");
@@ -94,3 +96,8 @@ bool SimpleTime::isTimeSynced() {
     return timeSynced && (wifiMulti.run() == WL_CONNECTED);
 }
 
+// 距下一次NTP更新的时间(ms)
+unsigned long SimpleTime::getNextUpdateIn(unsigned long now) {
+    unsigned long elapsed = now - lastNTPUpdate;
+    return elapsed >= NTP_UPDATE_INTERVAL ? 0 : NTP_UPDATE_INTERVAL - elapsed;
+}
@@ -0,0 +1,96 @@
+#include <TopicCache.h>
+
+// 主题后缀，保存在Flash中
+static const char SUFFIX_POST[] PROGMEM = "/thing/property/post";
+static const char SUFFIX_POST_REPLY[] PROGMEM = "/thing/property/post/reply";
+static const char SUFFIX_SET[] PROGMEM = "/thing/property/set";
+static const char SUFFIX_SET_REPLY[] PROGMEM = "/thing/property/set_reply";
+static const char SUFFIX_GET[] PROGMEM = "/thing/property/get";
+static const char SUFFIX_GET_REPLY[] PROGMEM = "/thing/property/get_reply";
+static const char SUFFIX_DESIRED_GET[] PROGMEM = "/thing/property/desired/get";
+static const char SUFFIX_DESIRED_GET_REPLY[] PROGMEM = "/thing/property/desired/get/reply";
+static const char SUFFIX_SUB_LOGIN[] PROGMEM = "/thing/sub/login";
+static const char SUFFIX_SUB_LOGIN_REPLY[] PROGMEM = "/thing/sub/login/reply";
+static const char SUFFIX_SUB_LOGOUT[] PROGMEM = "/thing/sub/logout";
+static const char SUFFIX_SUB_LOGOUT_REPLY[] PROGMEM = "/thing/sub/logout/reply";
+static const char SUFFIX_PACK_POST[] PROGMEM = "/thing/pack/post";
+static const char SUFFIX_PACK_POST_REPLY[] PROGMEM = "/thing/pack/post/reply";
+static const char SUFFIX_SUB_SET[] PROGMEM = "/thing/sub/property/set";
+static const char SUFFIX_SUB_SET_REPLY[] PROGMEM = "/thing/sub/property/set_reply";
+
+static const char* const TOPIC_SUFFIXES[TOPIC_COUNT] PROGMEM = {
+    SUFFIX_POST,
+    SUFFIX_POST_REPLY,
+    SUFFIX_SET,
+    SUFFIX_SET_REPLY,
+    SUFFIX_GET,
+    SUFFIX_GET_REPLY,
+    SUFFIX_DESIRED_GET,
+    SUFFIX_DESIRED_GET_REPLY,
+    SUFFIX_SUB_LOGIN,
+    SUFFIX_SUB_LOGIN_REPLY,
+    SUFFIX_SUB_LOGOUT,
+    SUFFIX_SUB_LOGOUT_REPLY,
+    SUFFIX_PACK_POST,
+    SUFFIX_PACK_POST_REPLY,
+    SUFFIX_SUB_SET,
+    SUFFIX_SUB_SET_REPLY,
+};
+
+std::vector<char> TopicCache::storage;
+uint16_t TopicCache::offsets[TOPIC_COUNT] = {0};
+uint16_t TopicCache::prefixLength = 0;
+uint32_t TopicCache::idCounter = 0;
+char TopicCache::idBuffer[11] = {0};
+
+void TopicCache::begin(const char* productId, const char* deviceName) {
+    size_t productLength = strlen(productId);
+    size_t deviceLength = strlen(deviceName);
+    prefixLength = 5 + productLength + 1 + deviceLength;
+
+    size_t total = 0;
+    for (uint8_t i = 0; i < TOPIC_COUNT; i++) {
+        total += prefixLength + strlen_P((const char*)pgm_read_ptr(&TOPIC_SUFFIXES[i])) + 1;
+    }
+
+    storage.assign(total, '\0');
+    char* p = storage.data();
+    for (uint8_t i = 0; i < TOPIC_COUNT; i++) {
+        offsets[i] = p - storage.data();
+        memcpy(p, "$sys/", 5);
+        memcpy(p + 5, productId, productLength);
+        p[5 + productLength] = '/';
+        memcpy(p + 6 + productLength, deviceName, deviceLength);
+        p += prefixLength;
+        const char* suffix = (const char*)pgm_read_ptr(&TOPIC_SUFFIXES[i]);
+        strcpy_P(p, suffix);
+        p += strlen_P(suffix) + 1;
+    }
+}
+
+const char* TopicCache::get(TopicId id) {
+    return storage.data() + offsets[id];
+}
+
+TopicId TopicCache::match(const char* topic) {
+    // 所有主题前缀相同，前缀不符时直接返回
+    if (storage.empty() || strncmp(topic, storage.data(), prefixLength) != 0) {
+        return TOPIC_COUNT;
+    }
+    const char* suffix = topic + prefixLength;
+    for (uint8_t i = 0; i < TOPIC_COUNT; i++) {
+        if (strcmp_P(suffix, (const char*)pgm_read_ptr(&TOPIC_SUFFIXES[i])) == 0) {
+            return (TopicId)i;
+        }
+    }
+    return TOPIC_COUNT;
+}
+
+const char* TopicCache::nextId() {
+    idCounter++;
+    if (idCounter == 0) {
+        idCounter = 1;
+    }
+    ultoa(idCounter, idBuffer, 10);
+    return idBuffer;
+}
@@ -5,16 +5,26 @@
 #include "SerialHandler.h"
 #include "MqttHandler.h"
 #include "Time_t.h"
+#include "PowerManager.h"
+#include "Metrics.h"
+#include "ConnectionManager.h"
+#include "TopicCache.h"
+#include "Gateway.h"
+#include "RuleEngine.h"
+#include "Settings.h"
+extern "C" {
+#include "gpio.h"
+}
 
 // 全局对象
 ESP8266WiFiMulti wifiMulti;
 WiFiClient wifiClient;
 SerialHandler serialHandler;
 MqttHandler mqttHandler(&wifiClient);
-// 定时器变量
-unsigned long lastWiFiCheck = 0;
-unsigned long lastMQTTCheck = 0;
-//unsigned long lastHeartbeat = 0;
+PowerManager powerManager(millis);
+ConnectionManager connectionManager(wifiMulti, mqttHandler);
+Gateway gateway;
+RuleEngine ruleEngine;
 //GPIO口初始化
 void initGPIO() {
     pinMode(LED_GPIO_PIN, OUTPUT);
@@ -27,6 +37,8 @@ void connectWiFi() {
 
     int attempts = 0;
     while (wifiMulti.run() != WL_CONNECTED && attempts < 30) {
+        // 阻塞期间串口数据在中断缓冲区中累积，按需通知STM32暂停
+        serialHandler.updateFlowControl();
         delay(500);
         Serial.print(".");
         attempts++;
@@ -42,24 +54,111 @@ void connectWiFi() {
         Serial.println("\nWiFi连接失败!");
     }
 }
+//距下一个定时事件（退避重连、MQTT保活/重发、NTP、批次上传、命令超时）的时间
+unsigned long nextDeadlineIn(unsigned long now) {
+    unsigned long next = connectionManager.getNextDeadlineIn(now);
+    unsigned long due = mqttHandler.getNextDeadlineIn(now);
+    if (due < next) next = due;
+    due = SimpleTime::getNextUpdateIn(now);
+    if (due < next) next = due;
+    due = serialHandler.getNextDeadlineIn(now);
+    if (due < next) next = due;
+    due = gateway.getNextDeadlineIn(now);
+    if (due < next) next = due;
+    if (mqttHandler.isConnected()) {
+        due = Metrics::getNextDueIn(now);
+        if (due < next) next = due;
+    }
+    return next;
+}
+//按决策等待或休眠，串口或网络有数据时提前唤醒
+void enterPowerMode(const PowerDecision& decision) {
+    static PowerMode currentMode = POWER_AWAKE;
+
+    if (decision.mode == POWER_AWAKE) {
+        if (decision.duration > 0) {
+            delay(decision.duration);
+        } else {
+            yield();
+        }
+        return;
+    }
+
+    // 只在模式变化时切换WiFi休眠类型
+    if (decision.mode != currentMode) {
+        if (decision.mode == POWER_LIGHT_SLEEP) {
+            WiFi.setSleepMode(WIFI_LIGHT_SLEEP, POWER_DTIM_LISTEN_INTERVAL);
+            // UART0 RX(GPIO3)空闲为高电平，STM32发送的起始位拉低时唤醒CPU
+            gpio_pin_wakeup_enable(GPIO_ID_PIN(3), GPIO_PIN_INTR_LOLEVEL);
+        } else {
+            gpio_pin_wakeup_disable();
+            WiFi.setSleepMode(WIFI_MODEM_SLEEP);
+        }
+        currentMode = decision.mode;
+    }
+
+    // 分片等待，SDK在delay()期间按所选类型自动休眠
+    bool byEvent = false;
+    unsigned long start = millis();
+    while (millis() - start < decision.duration) {
+        unsigned long remaining = decision.duration - (millis() - start);
+        delay(remaining < POWER_SLEEP_SLICE ? remaining : POWER_SLEEP_SLICE);
+        if (Serial.available() > 0 || wifiClient.available() > 0) {
+            byEvent = true;
+            break;
+        }
+    }
+    powerManager.wake(byEvent);
+}
+//运行参数修改后需要主动应用的部分，其余参数在使用处读取，修改后立即生效
+void onSettingChanged(SettingId id) {
+    if (id == CFG_MQTT_QOS1_WINDOW) {
+        mqttHandler.getInflight().setWindowSize(Settings::get(id));
+    }
+}
 //系统上电初始化
 void setup() {
     // 初始化GPIO
     initGPIO();
     // 初始化串口处理模块，波特率设置为115200
     serialHandler.init();
+    // 载入运行参数（队列长度、批次、超时等），其他模块按载入的值工作
+    Settings::begin();
+    Settings::setChangeCallback(onSettingChanged);
     // 设置MQTT处理器引用，在串口处理模块中使用MQTT的功能函数
     serialHandler.setMqttHandler(&mqttHandler);
+    // 设置串口处理器引用，属性设置指令通过串口转发给STM32
+    mqttHandler.setSerialHandler(&serialHandler);
+    // 设置低功耗管理器引用，STATUS中输出功耗统计
+    serialHandler.setPowerManager(&powerManager);
+#if GATEWAY_MODE
+    // 网关模式：带 @子设备名 的串口行与子设备主题交给网关处理
+    gateway.setMqttHandler(&mqttHandler);
+    serialHandler.setGateway(&gateway);
+    mqttHandler.setGateway(&gateway);
+#endif
+#if RULE_ENGINE_ENABLE
+    // 本地阈值规则：串口样本就地求值，阈值属性应用后重新编译
+    ruleEngine.setSerialHandler(&serialHandler);
+    ruleEngine.setMqttHandler(&mqttHandler);
+    serialHandler.setRuleEngine(&ruleEngine);
+    mqttHandler.setRuleEngine(&ruleEngine);
+#endif
     //打印启动信息
     Serial.println("MQTT连接程序启动...");
     // 连接WiFi
     connectWiFi();
     // 初始化MQTT处理模块
     mqttHandler.init();
+#if GATEWAY_MODE
+    gateway.begin();
+#endif
     // 尝试连接MQTT服务器并订阅主题
-    mqttHandler.connect(SUB_set_TOPIC);//连接MQTT并订阅属性设置主题
-    mqttHandler.subscribe(SUB_post_reply_TOPIC);//订阅属性上报回复主题
+    mqttHandler.connect(TopicCache::get(TOPIC_SET));//连接MQTT并订阅属性设置主题
+    mqttHandler.subscribe(TopicCache::get(TOPIC_POST_REPLY));//订阅属性上报回复主题
     SimpleTime::begin();
+    // 记录初始连接状态，生成本设备的重连退避种子
+    connectionManager.begin();
     //打印初始化完成信息
     Serial.println("初始化完成");
     Serial.println("支持的串口指令:");
@@ -72,38 +171,42 @@ void setup() {
 void loop() {
     unsigned long currentMillis = millis();
 
-    // 检查WiFi连接
-    if (currentMillis - lastWiFiCheck >= WIFI_CHECK_INTERVAL) {
-        lastWiFiCheck = currentMillis;
-        if (wifiMulti.run() != WL_CONNECTED) {
-            Serial.println("WiFi连接断开，尝试重连...");
-            digitalWrite(LED_GPIO_PIN, LOW);//WiFi断开，LED开
-            connectWiFi();//重新连接WiFi
-        } else {
-            digitalWrite(LED_GPIO_PIN, HIGH);//wifi正常连接提示，关闭LED
-        }
-    }
-    // 检查MQTT连接
-    if (currentMillis - lastMQTTCheck >= MQTT_CHECK_INTERVAL) {
-        lastMQTTCheck = currentMillis;
-        if (!mqttHandler.isConnected()) {
-            Serial.println("MQTT连接断开，尝试重连...");
-            mqttHandler.connect(SUB_set_TOPIC);
-        }
+    // 检查WiFi/MQTT连接，断开后按退避时间重连并恢复全部订阅
+    connectionManager.update(currentMillis);
+    // 发送心跳（运行指标），最近已随属性上报捎带时顺延
+    if (Metrics::isDue(currentMillis) && mqttHandler.isConnected()) {
+        mqttHandler.sendHeartbeat();
     }
-    // 发送心跳
-    // if (currentMillis - lastHeartbeat >= HEARTBEAT_INTERVAL) {
-    //     lastHeartbeat = currentMillis;
-    //     mqttHandler.sendHeartbeat();
-    // }
     // 维持MQTT连接
+    unsigned long mqttPacketsBefore = mqttHandler.getRxPacketCount();
     mqttHandler.loop();
+    if (mqttHandler.getRxPacketCount() != mqttPacketsBefore) {
+        powerManager.noteActivity();
+    }
     // 更新时间同步
     SimpleTime::update();
     // 处理串口数据
+    unsigned long rxBytesBefore = serialHandler.getRxByteCount();
     serialHandler.readSerialData();
+    if (serialHandler.getRxByteCount() != rxBytesBefore) {
+        powerManager.noteActivity();
+    }
+    // 处理STM32命令确认超时与重发
+    serialHandler.update();
+    // 子设备批次上传与登录状态维护
+    gateway.update(currentMillis);
+
+    // 记录本轮处理耗时（不含休眠）与空闲堆最低值
+    Metrics::set(TP_Loop_Time, millis() - currentMillis);
+    Metrics::set(TP_Heap_Min, ESP.getFreeHeap());
 
+#if POWER_MODE == 0
     delay(5);
+#else
+    // 空闲时按下一个定时事件的剩余时间进入modem sleep或light sleep
+    bool pendingWork = Serial.available() > 0 || serialHandler.hasPendingWork();
+    enterPowerMode(powerManager.plan(nextDeadlineIn(millis()), pendingWork));
+#endif
 
 }
 
@@ -0,0 +1,53 @@
+#ifndef HOST_ARDUINO_STUB_H
+#define HOST_ARDUINO_STUB_H
+
+// 主机单元测试用的Arduino替身：只提供被测模块用到的部分，时间由测试推进
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+
+inline unsigned long& hostMillis() {
+    static unsigned long now = 0;
+    return now;
+}
+inline unsigned long millis() { return hostMillis(); }
+inline unsigned long micros() { return hostMillis() * 1000UL; }
+inline void delay(unsigned long ms) { hostMillis() += ms; }
+inline void yield() {}
+
+class String {
+private:
+    std::string value;
+
+public:
+    String(const char* str = "") : value(str) {}
+    String(const std::string& str) : value(str) {}
+    String(int number) : value(std::to_string(number)) {}
+    String(unsigned int number) : value(std::to_string(number)) {}
+    String(long number) : value(std::to_string(number)) {}
+    String(unsigned long number) : value(std::to_string(number)) {}
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.size(); }
+    String& operator+=(const String& other) { value += other.value; return *this; }
+    friend String operator+(const String& lhs, const String& rhs) { return String(lhs.value + rhs.value); }
+    friend String operator+(const char* lhs, const String& rhs) { return String(lhs + rhs.value); }
+    friend String operator+(const String& lhs, const char* rhs) { return String(lhs.value + rhs); }
+};
+
+// 日志输出丢弃
+class HostSerial {
+public:
+    void print(const String&) {}
+    void println(const String& = String()) {}
+};
+
+inline HostSerial& hostSerial() {
+    static HostSerial serial;
+    return serial;
+}
+#define Serial hostSerial()
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef HOST_WIFI_CLIENT_STUB_H
+#define HOST_WIFI_CLIENT_STUB_H
+
+// 主机单元测试用的WiFiClient替身，测试通过MqttTransport接口注入数据，不使用这里的实现
+
+#include <Arduino.h>
+
+class WiFiClient {
+public:
+    int connect(const char*, uint16_t) { return 0; }
+    void stop() {}
+    uint8_t connected() { return 0; }
+    int available() { return 0; }
+    int read(uint8_t*, size_t) { return -1; }
+    size_t write(const uint8_t*, size_t) { return 0; }
+    void setNoDelay(bool) {}
+};
+
+#endif
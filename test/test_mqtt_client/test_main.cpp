@@ -0,0 +1,155 @@
+// MqttClient主机单元测试：pio test -e native -f test_mqtt_client
+// 用内存中的假连接代替WiFiClient，时间由Arduino替身的hostMillis()推进
+
+#include <unity.h>
+#include <string.h>
+#include <vector>
+#include <MqttClient.h>
+
+// 假连接：inbound为服务器将要发来的字节，outbound记录客户端写出的字节
+class FakeTransport : public MqttTransport {
+public:
+    std::vector<uint8_t> inbound;
+    std::vector<uint8_t> outbound;
+    bool open_ = false;
+
+    bool open(const char*, uint16_t) override {
+        open_ = true;
+        return true;
+    }
+    void close() override { open_ = false; }
+    bool isOpen() override { return open_; }
+    int available() override { return inbound.size(); }
+    int read(uint8_t* buf, size_t size) override {
+        size_t n = size < inbound.size() ? size : inbound.size();
+        memcpy(buf, inbound.data(), n);
+        inbound.erase(inbound.begin(), inbound.begin() + n);
+        return n;
+    }
+    bool writev(const MqttIoVec* iov, size_t count) override {
+        for (size_t i = 0; i < count; i++) {
+            outbound.insert(outbound.end(), iov[i].data, iov[i].data + iov[i].length);
+        }
+        return true;
+    }
+
+    void serverSends(std::initializer_list<uint8_t> data) { inbound.insert(inbound.end(), data); }
+    // 客户端最近写出的报文是否为PINGREQ
+    bool lastWasPingReq() const {
+        size_t n = outbound.size();
+        return n >= 2 && outbound[n - 2] == 0xC0 && outbound[n - 1] == 0x00;
+    }
+};
+
+static const uint16_t KEEPALIVE = 30;
+
+static FakeTransport* transport;
+static MqttClient* client;
+
+void setUp() {
+    hostMillis() = 1000;
+    transport = new FakeTransport();
+    client = new MqttClient(*transport, 256);
+    client->setServer("broker", 1883);
+    client->setKeepAlive(KEEPALIVE);
+    transport->serverSends({0x20, 0x02, 0x00, 0x00});
+    TEST_ASSERT_TRUE(client->connect("dev", "u", "p", true));
+    transport->outbound.clear();
+}
+
+void tearDown() {
+    delete client;
+    delete transport;
+}
+
+void test_connect_refused() {
+    FakeTransport refused;
+    MqttClient other(refused, 64);
+    other.setServer("broker", 1883);
+    refused.serverSends({0x20, 0x02, 0x00, 0x05});
+    TEST_ASSERT_FALSE(other.connect("dev", "u", "p", true));
+    TEST_ASSERT_EQUAL(MQTT_CONNECT_UNAUTHORIZED, other.getState());
+    TEST_ASSERT_FALSE(refused.isOpen());
+}
+
+void test_connect_timeout() {
+    FakeTransport silent;
+    MqttClient other(silent, 64);
+    other.setServer("broker", 1883);
+    TEST_ASSERT_FALSE(other.connect("dev", "u", "p", true));
+    TEST_ASSERT_EQUAL(MQTT_CONNECTION_TIMEOUT, other.getState());
+}
+
+void test_pingreq_does_not_time_out_immediately() {
+    hostMillis() += KEEPALIVE * 1000UL + 1;
+    TEST_ASSERT_TRUE(client->loop());
+    TEST_ASSERT_TRUE(transport->lastWasPingReq());
+
+    // PINGREQ刚发出，下一轮loop不能因为入站计时未重置而判定超时
+    hostMillis() += 10;
+    TEST_ASSERT_TRUE(client->loop());
+    TEST_ASSERT_TRUE(client->connected());
+
+    transport->serverSends({0xD0, 0x00});
+    hostMillis() += 200;
+    TEST_ASSERT_TRUE(client->loop());
+
+    // 收到PINGRESP后，下一个保活周期照常发送PINGREQ
+    transport->outbound.clear();
+    hostMillis() += KEEPALIVE * 1000UL + 1;
+    TEST_ASSERT_TRUE(client->loop());
+    TEST_ASSERT_TRUE(transport->lastWasPingReq());
+}
+
+void test_missing_pingresp_times_out_after_one_interval() {
+    hostMillis() += KEEPALIVE * 1000UL + 1;
+    TEST_ASSERT_TRUE(client->loop());
+    TEST_ASSERT_TRUE(transport->lastWasPingReq());
+
+    hostMillis() += KEEPALIVE * 1000UL;
+    TEST_ASSERT_TRUE(client->loop());
+
+    hostMillis() += 1;
+    TEST_ASSERT_FALSE(client->loop());
+    TEST_ASSERT_EQUAL(MQTT_CONNECTION_TIMEOUT, client->getState());
+    TEST_ASSERT_FALSE(transport->isOpen());
+}
+
+void test_publish_qos1_is_acknowledged() {
+    uint16_t acked = 0;
+    client->setAckCallback([&acked](uint16_t packetId) { acked = packetId; });
+    TEST_ASSERT_TRUE(client->publish("t", (const uint8_t*)"1", 1, 1, false, 9));
+    static const uint8_t expected[] = {0x32, 0x06, 0x00, 0x01, 't', 0x00, 0x09, '1'};
+    TEST_ASSERT_EQUAL_UINT32(sizeof(expected), transport->outbound.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, transport->outbound.data(), sizeof(expected));
+
+    transport->serverSends({0x40, 0x02, 0x00, 0x09});
+    TEST_ASSERT_TRUE(client->loop());
+    TEST_ASSERT_EQUAL_UINT16(9, acked);
+}
+
+void test_inbound_qos1_publish_is_delivered_and_acked() {
+    std::vector<uint8_t> received;
+    client->setCallback([&received](char* topic, uint8_t* payload, unsigned int length) {
+        TEST_ASSERT_EQUAL_STRING("a/b", topic);
+        received.assign(payload, payload + length);
+    });
+    transport->serverSends({0x32, 0x09, 0x00, 0x03, 'a', '/', 'b', 0x12, 0x34, 'o', 'k'});
+    TEST_ASSERT_TRUE(client->loop());
+    TEST_ASSERT_EQUAL_UINT32(2, received.size());
+    TEST_ASSERT_EQUAL_MEMORY("ok", received.data(), 2);
+    static const uint8_t puback[] = {0x40, 0x02, 0x12, 0x34};
+    TEST_ASSERT_EQUAL_UINT32(sizeof(puback), transport->outbound.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(puback, transport->outbound.data(), sizeof(puback));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_connect_refused);
+    RUN_TEST(test_connect_timeout);
+    RUN_TEST(test_pingreq_does_not_time_out_immediately);
+    RUN_TEST(test_missing_pingresp_times_out_after_one_interval);
+    RUN_TEST(test_publish_qos1_is_acknowledged);
+    RUN_TEST(test_inbound_qos1_publish_is_delivered_and_acked);
+    return UNITY_END();
+}
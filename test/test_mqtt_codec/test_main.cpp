@@ -0,0 +1,217 @@
+// MqttCodec主机单元测试：pio test -e native -f test_mqtt_codec
+// 期望的报文字节按MQTT 3.1.1规范逐字段写出，与抓包工具中看到的原始字节一致
+
+#include <unity.h>
+#include <string.h>
+#include <vector>
+#include <MqttCodec.h>
+
+static std::vector<uint8_t> bytes(const uint8_t* data, size_t length) {
+    return std::vector<uint8_t>(data, data + length);
+}
+
+static std::vector<uint8_t> flatten(const MqttPublishFrame& frame) {
+    std::vector<uint8_t> out;
+    for (size_t i = 0; i < frame.count; i++) {
+        out.insert(out.end(), frame.iov[i].data, frame.iov[i].data + frame.iov[i].length);
+    }
+    return out;
+}
+
+static void assertBytes(const std::vector<uint8_t>& expected, const std::vector<uint8_t>& actual) {
+    TEST_ASSERT_EQUAL_UINT32(expected.size(), actual.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.data(), actual.data(), expected.size());
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_remaining_length() {
+    uint8_t buf[4];
+    TEST_ASSERT_EQUAL_UINT32(1, mqttWriteRemainingLength(buf, 127));
+    TEST_ASSERT_EQUAL_HEX8(0x7F, buf[0]);
+    TEST_ASSERT_EQUAL_UINT32(2, mqttWriteRemainingLength(buf, 128));
+    TEST_ASSERT_EQUAL_HEX8(0x80, buf[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, buf[1]);
+    TEST_ASSERT_EQUAL_UINT32(3, mqttWriteRemainingLength(buf, 16384));
+    TEST_ASSERT_EQUAL_UINT32(4, mqttWriteRemainingLength(buf, 268435455));
+    TEST_ASSERT_EQUAL_HEX8(0x7F, buf[3]);
+}
+
+void test_encode_connect() {
+    static const uint8_t expected[] = {
+        0x10, 0x15,                                // CONNECT，剩余长度21
+        0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04,      // 协议名与级别
+        0xC2, 0x00, 0x3C,                          // 用户名+密码+cleanSession，保活60s
+        0x00, 0x03, 'd', 'e', 'v',
+        0x00, 0x01, 'u',
+        0x00, 0x01, 'p'};
+    std::vector<uint8_t> out;
+    mqttEncodeConnect(out, "dev", "u", "p", 60, true);
+    assertBytes(bytes(expected, sizeof(expected)), out);
+
+    // 持久会话、无用户名
+    out.clear();
+    mqttEncodeConnect(out, "dev", nullptr, nullptr, 120, false);
+    TEST_ASSERT_EQUAL_HEX8(0x0F, out[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, out[9]);
+    TEST_ASSERT_EQUAL_HEX8(0x78, out[11]);
+}
+
+void test_encode_subscribe() {
+    static const uint8_t expected[] = {
+        0x82, 0x0D, 0x00, 0x07,
+        0x00, 0x03, 'a', '/', 'b', 0x00,
+        0x00, 0x02, 'c', 'd', 0x00};
+    const char* topics[] = {"a/b", "cd"};
+    std::vector<uint8_t> out;
+    mqttEncodeSubscribe(out, 7, topics, 2, 0);
+    assertBytes(bytes(expected, sizeof(expected)), out);
+}
+
+void test_build_publish_qos0() {
+    static const uint8_t expected[] = {0x30, 0x0A, 0x00, 0x03, 'a', '/', 'b', 'h', 'e', 'l', 'l', 'o'};
+    const uint8_t payload[] = {'h', 'e', 'l', 'l', 'o'};
+    MqttPublishFrame frame;
+    mqttBuildPublish(frame, "a/b", payload, sizeof(payload), 0, false, 0);
+    TEST_ASSERT_EQUAL_UINT32(3, frame.count);
+    // 负载分段直接指向调用者的缓冲区
+    TEST_ASSERT_TRUE(frame.iov[2].data == payload);
+    assertBytes(bytes(expected, sizeof(expected)), flatten(frame));
+}
+
+void test_build_publish_qos1_dup() {
+    static const uint8_t expected[] = {0x3A, 0x08, 0x00, 0x01, 't', 0x80, 0x01, '4', '2', '!'};
+    MqttPublishFrame frame;
+    mqttBuildPublish(frame, "t", (const uint8_t*)"42!", 3, 1, true, 0x8001);
+    TEST_ASSERT_EQUAL_UINT32(4, frame.count);
+    assertBytes(bytes(expected, sizeof(expected)), flatten(frame));
+}
+
+void test_encode_ack_and_empty() {
+    uint8_t buf[4];
+    TEST_ASSERT_EQUAL_UINT32(4, mqttEncodeAck(buf, MQTT_PACKET_PUBACK, 0x1234));
+    static const uint8_t puback[] = {0x40, 0x02, 0x12, 0x34};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(puback, buf, 4);
+    TEST_ASSERT_EQUAL_UINT32(2, mqttEncodeEmpty(buf, MQTT_PACKET_PINGREQ));
+    TEST_ASSERT_EQUAL_HEX8(0xC0, buf[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, buf[1]);
+}
+
+void test_decode_packets_in_one_read() {
+    static const uint8_t wire[] = {
+        0x20, 0x02, 0x00, 0x00,                                     // CONNACK
+        0x90, 0x03, 0x00, 0x07, 0x00,                               // SUBACK id 7
+        0x32, 0x09, 0x00, 0x03, 'a', '/', 'b', 0x00, 0x05, 'x', 'y', // PUBLISH QoS1 id 5
+        0x40, 0x02, 0x80, 0x01,                                     // PUBACK id 0x8001
+        0xD0, 0x00};                                                // PINGRESP
+    MqttDecoder decoder(64);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(wire), decoder.feed(wire, sizeof(wire)));
+
+    MqttPacket packet;
+    TEST_ASSERT_EQUAL(MQTT_DECODE_PACKET, decoder.next(packet));
+    TEST_ASSERT_EQUAL_UINT8(MQTT_PACKET_CONNACK, packet.type);
+    TEST_ASSERT_EQUAL_UINT32(2, packet.length);
+
+    TEST_ASSERT_EQUAL(MQTT_DECODE_PACKET, decoder.next(packet));
+    TEST_ASSERT_EQUAL_UINT8(MQTT_PACKET_SUBACK, packet.type);
+    TEST_ASSERT_EQUAL_UINT16(7, packet.packetId);
+
+    TEST_ASSERT_EQUAL(MQTT_DECODE_PACKET, decoder.next(packet));
+    TEST_ASSERT_EQUAL_UINT8(MQTT_PACKET_PUBLISH, packet.type);
+    TEST_ASSERT_EQUAL_UINT16(5, packet.packetId);
+    TEST_ASSERT_EQUAL_STRING("a/b", packet.topic);
+    TEST_ASSERT_EQUAL_UINT32(2, packet.payloadLength);
+    TEST_ASSERT_EQUAL_MEMORY("xy", packet.payload, 2);
+
+    TEST_ASSERT_EQUAL(MQTT_DECODE_PACKET, decoder.next(packet));
+    TEST_ASSERT_EQUAL_UINT8(MQTT_PACKET_PUBACK, packet.type);
+    TEST_ASSERT_EQUAL_UINT16(0x8001, packet.packetId);
+
+    TEST_ASSERT_EQUAL(MQTT_DECODE_PACKET, decoder.next(packet));
+    TEST_ASSERT_EQUAL_UINT8(MQTT_PACKET_PINGRESP, packet.type);
+
+    TEST_ASSERT_EQUAL(MQTT_DECODE_NEED_MORE, decoder.next(packet));
+    TEST_ASSERT_EQUAL_UINT32(0, decoder.size());
+}
+
+void test_decode_byte_by_byte() {
+    static const uint8_t wire[] = {0x30, 0x07, 0x00, 0x02, 'o', 'k', '{', '}', '!'};
+    MqttDecoder decoder(32);
+    MqttPacket packet;
+    for (size_t i = 0; i + 1 < sizeof(wire); i++) {
+        decoder.feed(wire + i, 1);
+        TEST_ASSERT_EQUAL(MQTT_DECODE_NEED_MORE, decoder.next(packet));
+    }
+    decoder.feed(wire + sizeof(wire) - 1, 1);
+    TEST_ASSERT_EQUAL(MQTT_DECODE_PACKET, decoder.next(packet));
+    TEST_ASSERT_EQUAL_STRING("ok", packet.topic);
+    TEST_ASSERT_EQUAL_MEMORY("{}!", packet.payload, 3);
+}
+
+void test_decode_wrapped_packet() {
+    // 先占用缓冲区后部，使下一个报文跨越缓冲区末尾
+    static const uint8_t filler[] = {0x40, 0x02, 0x00, 0x01, 0x40, 0x02, 0x00, 0x02, 0x40, 0x02, 0x00, 0x03};
+    static const uint8_t publish[] = {0x30, 0x08, 0x00, 0x03, 'a', 'b', 'c', '1', '2', '3'};
+    MqttDecoder decoder(16);
+    MqttPacket packet;
+    decoder.feed(filler, sizeof(filler));
+    TEST_ASSERT_EQUAL(MQTT_DECODE_PACKET, decoder.next(packet));
+    TEST_ASSERT_EQUAL(MQTT_DECODE_PACKET, decoder.next(packet));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(publish), decoder.feed(publish, sizeof(publish)));
+
+    TEST_ASSERT_EQUAL(MQTT_DECODE_PACKET, decoder.next(packet));
+    TEST_ASSERT_EQUAL_UINT16(3, packet.packetId);
+    TEST_ASSERT_EQUAL(MQTT_DECODE_PACKET, decoder.next(packet));
+    TEST_ASSERT_EQUAL_STRING("abc", packet.topic);
+    TEST_ASSERT_EQUAL_MEMORY("123", packet.payload, 3);
+}
+
+void test_decode_skips_oversize() {
+    MqttDecoder decoder(16);
+    MqttPacket packet;
+    // 剩余长度30的PUBLISH超过缓冲区，分两次到达后被整体跳过
+    std::vector<uint8_t> big = {0x30, 0x1E, 0x00, 0x01, 't'};
+    big.resize(32, 'z');
+    decoder.feed(big.data(), 16);
+    TEST_ASSERT_EQUAL(MQTT_DECODE_NEED_MORE, decoder.next(packet));
+    decoder.feed(big.data() + 16, 16);
+    TEST_ASSERT_EQUAL(MQTT_DECODE_NEED_MORE, decoder.next(packet));
+    TEST_ASSERT_EQUAL_UINT32(0, decoder.size());
+    static const uint8_t pingresp[] = {0xD0, 0x00};
+    decoder.feed(pingresp, sizeof(pingresp));
+    TEST_ASSERT_EQUAL(MQTT_DECODE_PACKET, decoder.next(packet));
+    TEST_ASSERT_EQUAL_UINT8(MQTT_PACKET_PINGRESP, packet.type);
+    TEST_ASSERT_EQUAL_UINT32(1, decoder.getOversizeCount());
+}
+
+void test_decode_malformed() {
+    MqttDecoder decoder(16);
+    MqttPacket packet;
+    // 剩余长度超过4字节
+    static const uint8_t badLength[] = {0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x01};
+    decoder.feed(badLength, sizeof(badLength));
+    TEST_ASSERT_EQUAL(MQTT_DECODE_ERROR, decoder.next(packet));
+
+    // 主题长度超出报文
+    decoder.reset();
+    static const uint8_t badTopic[] = {0x32, 0x03, 0x00, 0x05, 'a'};
+    decoder.feed(badTopic, sizeof(badTopic));
+    TEST_ASSERT_EQUAL(MQTT_DECODE_ERROR, decoder.next(packet));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_remaining_length);
+    RUN_TEST(test_encode_connect);
+    RUN_TEST(test_encode_subscribe);
+    RUN_TEST(test_build_publish_qos0);
+    RUN_TEST(test_build_publish_qos1_dup);
+    RUN_TEST(test_encode_ack_and_empty);
+    RUN_TEST(test_decode_packets_in_one_read);
+    RUN_TEST(test_decode_byte_by_byte);
+    RUN_TEST(test_decode_wrapped_packet);
+    RUN_TEST(test_decode_skips_oversize);
+    RUN_TEST(test_decode_malformed);
+    return UNITY_END();
+}
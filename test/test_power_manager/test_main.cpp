@@ -0,0 +1,123 @@
+// PowerManager主机单元测试：pio test -e native -f test_power_manager
+// 决策逻辑不依赖Arduino，时钟用可推进的假时钟注入
+
+#include <unity.h>
+#include <PowerManager.h>
+
+static unsigned long fakeNow = 0;
+static unsigned long fakeClock() { return fakeNow; }
+
+static PowerInputs idleInputs(unsigned long nextDeadlineIn) {
+    PowerInputs inputs;
+    inputs.idleFor = POWER_IDLE_THRESHOLD;
+    inputs.nextDeadlineIn = nextDeadlineIn;
+    inputs.pendingWork = false;
+    return inputs;
+}
+
+void setUp() { fakeNow = 1000; }
+void tearDown() {}
+
+void test_pending_work_keeps_awake() {
+    PowerInputs inputs = idleInputs(POWER_NO_DEADLINE);
+    inputs.pendingWork = true;
+    PowerDecision decision = PowerManager::decide(inputs);
+    TEST_ASSERT_EQUAL(POWER_AWAKE, decision.mode);
+    TEST_ASSERT_EQUAL_UINT32(0, decision.duration);
+}
+
+void test_recent_activity_keeps_awake() {
+    PowerInputs inputs = idleInputs(POWER_NO_DEADLINE);
+    inputs.idleFor = POWER_IDLE_THRESHOLD - 1;
+    TEST_ASSERT_EQUAL(POWER_AWAKE, PowerManager::decide(inputs).mode);
+}
+
+void test_near_deadline_waits_awake() {
+    PowerDecision decision = PowerManager::decide(idleInputs(POWER_MIN_SLEEP - 1));
+    TEST_ASSERT_EQUAL(POWER_AWAKE, decision.mode);
+    TEST_ASSERT_EQUAL_UINT32(POWER_MIN_SLEEP - 1, decision.duration);
+}
+
+void test_short_gap_uses_modem_sleep() {
+    PowerDecision decision = PowerManager::decide(idleInputs(POWER_MIN_SLEEP));
+    TEST_ASSERT_EQUAL(POWER_MODEM_SLEEP, decision.mode);
+    TEST_ASSERT_EQUAL_UINT32(POWER_MIN_SLEEP, decision.duration);
+#if POWER_MODE >= 2
+    TEST_ASSERT_EQUAL(POWER_MODEM_SLEEP, PowerManager::decide(idleInputs(POWER_LIGHT_SLEEP_MIN - 1)).mode);
+#endif
+}
+
+void test_long_gap_uses_light_sleep_capped() {
+#if POWER_MODE >= 2
+    PowerDecision decision = PowerManager::decide(idleInputs(POWER_LIGHT_SLEEP_MIN));
+    TEST_ASSERT_EQUAL(POWER_LIGHT_SLEEP, decision.mode);
+    TEST_ASSERT_EQUAL_UINT32(POWER_LIGHT_SLEEP_MIN, decision.duration);
+#endif
+    PowerDecision capped = PowerManager::decide(idleInputs(POWER_NO_DEADLINE));
+    TEST_ASSERT_EQUAL_UINT32(POWER_MAX_SLEEP, capped.duration);
+}
+
+void test_time_until_handles_wraparound() {
+    TEST_ASSERT_EQUAL_UINT32(300, PowerManager::timeUntil(1000, 500, 1200));
+    TEST_ASSERT_EQUAL_UINT32(0, PowerManager::timeUntil(1000, 500, 1600));
+    // millis()回绕：start在回绕前16ms，now在回绕后5ms
+    TEST_ASSERT_EQUAL_UINT32(479, PowerManager::timeUntil((unsigned long)0 - 16, 500, 5));
+}
+
+void test_plan_follows_activity_clock() {
+    PowerManager power(fakeClock);
+    // 刚启动时视为有活动
+    TEST_ASSERT_EQUAL(POWER_AWAKE, power.plan(POWER_NO_DEADLINE, false).mode);
+
+    fakeNow += POWER_IDLE_THRESHOLD;
+    TEST_ASSERT_TRUE(power.plan(POWER_NO_DEADLINE, false).mode != POWER_AWAKE);
+    fakeNow += 200;
+    power.wake(false);
+    TEST_ASSERT_EQUAL_UINT32(200, power.getSleepMillis());
+    TEST_ASSERT_EQUAL_UINT32(1, power.getWakeCount());
+
+    // 发出STM32命令后记录活动，等待确认期间不休眠
+    power.noteActivity();
+    TEST_ASSERT_EQUAL(POWER_AWAKE, power.plan(POWER_NO_DEADLINE, false).mode);
+    fakeNow += POWER_IDLE_THRESHOLD;
+    TEST_ASSERT_EQUAL(POWER_AWAKE, power.plan(STM32_CMD_TIMEOUT, true).mode);
+}
+
+void test_event_wake_counts_as_activity() {
+    PowerManager power(fakeClock);
+    fakeNow += POWER_IDLE_THRESHOLD;
+    TEST_ASSERT_TRUE(power.plan(POWER_NO_DEADLINE, false).mode != POWER_AWAKE);
+    fakeNow += 40;
+    power.wake(true);
+    TEST_ASSERT_EQUAL_UINT32(1, power.getEventWakeCount());
+    // 被数据唤醒后保持唤醒处理数据
+    TEST_ASSERT_EQUAL(POWER_AWAKE, power.plan(POWER_NO_DEADLINE, false).mode);
+    // 未休眠时wake()不计数
+    power.wake(true);
+    TEST_ASSERT_EQUAL_UINT32(1, power.getWakeCount());
+}
+
+void test_awake_ratio() {
+    PowerManager power(fakeClock);
+    TEST_ASSERT_EQUAL(100, power.getAwakeRatio());
+    fakeNow += POWER_IDLE_THRESHOLD;
+    power.plan(POWER_NO_DEADLINE, false);
+    fakeNow += 150;
+    power.wake(false);
+    // 唤醒POWER_IDLE_THRESHOLD，休眠150ms
+    TEST_ASSERT_EQUAL(POWER_IDLE_THRESHOLD * 100 / (POWER_IDLE_THRESHOLD + 150), power.getAwakeRatio());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_pending_work_keeps_awake);
+    RUN_TEST(test_recent_activity_keeps_awake);
+    RUN_TEST(test_near_deadline_waits_awake);
+    RUN_TEST(test_short_gap_uses_modem_sleep);
+    RUN_TEST(test_long_gap_uses_light_sleep_capped);
+    RUN_TEST(test_time_until_handles_wraparound);
+    RUN_TEST(test_plan_follows_activity_clock);
+    RUN_TEST(test_event_wake_counts_as_activity);
+    RUN_TEST(test_awake_ratio);
+    return UNITY_END();
+}
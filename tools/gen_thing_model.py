@@ -0,0 +1,537 @@
+"""根据OneNET导出的物模型JSON生成类型化的属性绑定头文件
+
+用法:
+    python tools/gen_thing_model.py [物模型JSON] [输出头文件]
+
+默认读取 model/thing_model.json，生成 include/ThingModel.h。
+在 platformio.ini 中作为 pre 脚本注册，每次编译前自动运行；
+生成结果没有变化时不改写文件，避免触发整体重新编译。
+"""
+
+import json
+import math
+import os
+import sys
+
+# 物模型数据类型 -> (ThingValueType, C++类型)
+TYPE_MAP = {
+    "bool": ("TM_BOOL", "bool"),
+    "int32": ("TM_INT", "int32_t"),
+    "enum": ("TM_INT", "int32_t"),
+    "float": ("TM_FLOAT", "float"),
+    "double": ("TM_FLOAT", "float"),
+    "string": ("TM_STRING", "String"),
+}
+
+
+def load_properties(model_path):
+    with open(model_path, encoding="utf-8") as f:
+        model = json.load(f)
+
+    props = []
+    for item in model.get("properties", []):
+        ident = item["identifier"]
+        data_type = item["dataType"]["type"]
+        if data_type not in TYPE_MAP:
+            print("gen_thing_model: 跳过不支持的类型 %s (%s)" % (ident, data_type))
+            continue
+        if not ident.replace("_", "").isalnum() or ident[0].isdigit():
+            raise ValueError("属性标识符不能作为C++名称: %s" % ident)
+
+        specs = item["dataType"].get("specs", {})
+        enum_type, cpp_type = TYPE_MAP[data_type]
+        prop = {
+            "id": ident,
+            "name": item.get("name", ident),
+            "enum_type": enum_type,
+            "cpp_type": cpp_type,
+            "writable": "w" in item.get("accessMode", "r"),
+            "decimals": 0,
+            "min": None,
+            "max": None,
+            "length": None,
+        }
+        if data_type in ("int32", "float", "double"):
+            prop["min"] = float(specs.get("min", "nan"))
+            prop["max"] = float(specs.get("max", "nan"))
+        if data_type in ("float", "double") and "step" in specs:
+            step = float(specs["step"])
+            if step > 0:
+                prop["decimals"] = max(0, int(round(-math.log10(step))))
+        if data_type == "enum":
+            keys = [int(k) for k in specs.keys()]
+            prop["min"], prop["max"] = float(min(keys)), float(max(keys))
+        if data_type == "string":
+            prop["length"] = int(specs.get("length", 0)) or None
+        props.append(prop)
+
+    if not props:
+        raise ValueError("物模型中没有可用的属性")
+    return props
+
+
+def c_number(value, cpp_type):
+    if cpp_type == "int32_t":
+        return str(int(value))
+    return repr(float(value)) + "f"
+
+
+def range_check(p, var):
+    checks = []
+    if p["min"] is not None and not math.isnan(p["min"]):
+        checks.append("%s < %s" % (var, c_number(p["min"], p["cpp_type"])))
+    if p["max"] is not None and not math.isnan(p["max"]):
+        checks.append("%s > %s" % (var, c_number(p["max"], p["cpp_type"])))
+    return " || ".join(checks)
+
+
+def post_max_length(props):
+    """全部属性同时上报时的JSON长度估算"""
+    # {"id":"<10位id>","version":"1.0","params":{...}}
+    length = len('{"id":""') + 10 + len(',"version":"1.0","params":{') + len("}}")
+    for p in props:
+        length += len('"%s":{"value":}' % p["id"]) + 1
+        if p["cpp_type"] == "String":
+            length += 2 + (p["length"] or 32)
+        elif p["cpp_type"] == "bool":
+            length += 5
+        else:
+            length += 12
+    return length
+
+
+def generate(props, source_name):
+    count = len(props)
+    mask_type = "uint32_t" if count <= 32 else "uint64_t"
+    one = "1UL" if count <= 32 else "1ULL"
+    writable = sum(1 for p in props if p["writable"])
+    out = []
+    w = out.append
+
+    w("// 自动生成文件，请勿手动修改")
+    w("// 来源: %s" % source_name)
+    w("// 生成: tools/gen_thing_model.py（编译前由PlatformIO自动运行）")
+    w("#ifndef THING_MODEL_H")
+    w("#define THING_MODEL_H")
+    w("")
+    w("#include <Arduino.h>")
+    w("#include <ArduinoJson.h>")
+    w("")
+    w("// 物模型属性值类型")
+    w("enum ThingValueType : uint8_t {")
+    w("    TM_BOOL,")
+    w("    TM_INT,")
+    w("    TM_FLOAT,")
+    w("    TM_STRING")
+    w("};")
+    w("")
+    w("// 物模型属性编号")
+    w("enum ThingPropertyId : uint8_t {")
+    for p in props:
+        w("    TP_%s, // %s" % (p["id"], p["name"]))
+    w("    TP_COUNT")
+    w("};")
+    w("")
+    w("// 属性标识符")
+    w("namespace ThingKey {")
+    for p in props:
+        w('    constexpr char %s[] = "%s";' % (p["id"], p["id"]))
+    w("}")
+    w("")
+    w("// 物模型属性描述")
+    w("struct ThingPropertyInfo {")
+    w("    const char* key;")
+    w("    ThingValueType type;")
+    w("    bool writable;     // 是否允许云端设置")
+    w("    uint8_t decimals;  // 浮点数按步长保留的小数位数")
+    w("};")
+    w("")
+    w("static const ThingPropertyInfo THING_PROPERTIES[TP_COUNT] = {")
+    for p in props:
+        w("    {ThingKey::%s, %s, %s, %d}," % (
+            p["id"], p["enum_type"], "true" if p["writable"] else "false", p["decimals"]))
+    w("};")
+    w("")
+    w("constexpr size_t THING_WRITABLE_COUNT = %d;" % writable)
+    w("// 属性设置JSON容量: {\"id\",\"version\",\"params\":{...}}，按零拷贝方式解析")
+    w("constexpr size_t THING_SET_JSON_CAPACITY =")
+    w("    JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(THING_WRITABLE_COUNT);")
+    w("")
+    w("// 物模型属性值，present位图标记已赋值的属性")
+    w("struct ThingProperties {")
+    w("    %s present;" % mask_type)
+    for p in props:
+        w("    %s %s;" % (p["cpp_type"], p["id"]))
+    w("")
+    inits = ["present(0)"]
+    for p in props:
+        if p["cpp_type"] == "bool":
+            inits.append("%s(false)" % p["id"])
+        elif p["cpp_type"] != "String":
+            inits.append("%s(0)" % p["id"])
+    w("    ThingProperties() : %s {}" % ", ".join(inits))
+    w("    bool has(ThingPropertyId id) const { return (present & ((%s)%s << id)) != 0; }" % (mask_type, one))
+    w("    void mark(ThingPropertyId id) { present |= (%s)%s << id; }" % (mask_type, one))
+    w("    void clear() { present = 0; }")
+    w("    bool empty() const { return present == 0; }")
+    w("};")
+    w("")
+    w("// 按步长保留小数位，避免平台校验步长失败")
+    w("inline double thingRound(double value, uint8_t decimals) {")
+    w("    double scale = 1.0;")
+    w("    for (uint8_t i = 0; i < decimals; i++) {")
+    w("        scale *= 10.0;")
+    w("    }")
+    w("    return lround(value * scale) / scale;")
+    w("}")
+    w("")
+    w("// 浮点数按步长缩放为整数（与thingRound取整一致），NaN/无穷大记为THING_SCALED_NULL")
+    w("constexpr int32_t THING_SCALED_NULL = INT32_MIN;")
+    w("inline int32_t thingScaleFloat(float value, uint8_t decimals) {")
+    w("    if (isnan(value) || isinf(value)) {")
+    w("        return THING_SCALED_NULL;")
+    w("    }")
+    w("    double scale = 1.0;")
+    w("    for (uint8_t i = 0; i < decimals; i++) {")
+    w("        scale *= 10.0;")
+    w("    }")
+    w("    return (int32_t)lround(value * scale);")
+    w("}")
+    w("")
+    w("inline float thingUnscaleFloat(int32_t value, uint8_t decimals) {")
+    w("    if (value == THING_SCALED_NULL) {")
+    w("        return NAN;")
+    w("    }")
+    w("    double scale = 1.0;")
+    w("    for (uint8_t i = 0; i < decimals; i++) {")
+    w("        scale *= 10.0;")
+    w("    }")
+    w("    return (float)(value / scale);")
+    w("}")
+    w("")
+    w("// 按标识符查找属性，未找到时返回TP_COUNT")
+    w("inline ThingPropertyId thingFindProperty(const char* key) {")
+    for p in props:
+        w("    if (strcmp(key, ThingKey::%s) == 0) return TP_%s;" % (p["id"], p["id"]))
+    w("    return TP_COUNT;")
+    w("}")
+    w("")
+    w("// 读取云端下发的属性值（类型、范围与可写性校验）")
+    w("// 返回结果码: 200成功，400类型或范围不符，403只读，404未定义")
+    w("inline int thingReadValue(ThingProperties& props, ThingPropertyId id, JsonVariantConst value) {")
+    w("    switch (id) {")
+    for p in props:
+        ident = p["id"]
+        w("        case TP_%s: {" % ident)
+        if not p["writable"]:
+            w("            return 403;")
+            w("        }")
+            continue
+        t = p["cpp_type"]
+        if t == "bool":
+            w("            if (value.is<bool>()) {")
+            w("                props.%s = value.as<bool>();" % ident)
+            w("            } else if (value.is<int>() && (value.as<int>() == 0 || value.as<int>() == 1)) {")
+            w("                props.%s = value.as<int>() == 1;" % ident)
+            w("            } else {")
+            w("                return 400;")
+            w("            }")
+        elif t == "int32_t":
+            w("            if (!value.is<int32_t>()) return 400;")
+            w("            int32_t v = value.as<int32_t>();")
+            rc = range_check(p, "v")
+            if rc:
+                w("            if (%s) return 400;" % rc)
+            w("            props.%s = v;" % ident)
+        elif t == "float":
+            w("            if (!value.is<float>()) return 400;")
+            w("            float v = value.as<float>();")
+            rc = range_check(p, "v")
+            if rc:
+                w("            if (%s) return 400;" % rc)
+            w("            props.%s = v;" % ident)
+        else:
+            w("            if (!value.is<const char*>()) return 400;")
+            w("            const char* v = value.as<const char*>();")
+            if p["length"]:
+                w("            if (strlen(v) > %d) return 400;" % p["length"])
+            w("            props.%s = v;" % ident)
+        w("            break;")
+        w("        }")
+    w("        default:")
+    w("            return 404;")
+    w("    }")
+    w("    props.mark(id);")
+    w("    return 200;")
+    w("}")
+    w("")
+    w("// 解析串口文本形式的属性值（key=value中的value），格式或范围不符时返回false")
+    w("inline bool thingParseText(ThingProperties& props, ThingPropertyId id, const char* text) {")
+    w("    char* end = nullptr;")
+    w("    switch (id) {")
+    for p in props:
+        ident = p["id"]
+        t = p["cpp_type"]
+        w("        case TP_%s: {" % ident)
+        if t == "bool":
+            w('            if (strcmp(text, "1") == 0 || strcasecmp(text, "true") == 0 || strcasecmp(text, "on") == 0) {')
+            w("                props.%s = true;" % ident)
+            w('            } else if (strcmp(text, "0") == 0 || strcasecmp(text, "false") == 0 || strcasecmp(text, "off") == 0) {')
+            w("                props.%s = false;" % ident)
+            w("            } else {")
+            w("                return false;")
+            w("            }")
+        elif t == "int32_t":
+            w("            long v = strtol(text, &end, 10);")
+            w("            if (end == text || *end != '\\0') return false;")
+            rc = range_check(p, "v")
+            if rc:
+                w("            if (%s) return false;" % rc)
+            w("            props.%s = (int32_t)v;" % ident)
+        elif t == "float":
+            w("            float v = strtof(text, &end);")
+            w("            if (end == text || *end != '\\0') return false;")
+            rc = range_check(p, "v")
+            if rc:
+                w("            if (%s) return false;" % rc)
+            w("            props.%s = v;" % ident)
+        else:
+            if p["length"]:
+                w("            if (strlen(text) > %d) return false;" % p["length"])
+            w("            props.%s = text;" % ident)
+        w("            break;")
+        w("        }")
+    w("        default:")
+    w("            return false;")
+    w("    }")
+    w("    props.mark(id);")
+    w("    return true;")
+    w("}")
+    w("")
+    w("// 将属性值写入obj[key]（浮点数按步长取整，字符串按指针引用）")
+    w("inline void thingWriteValue(JsonObject obj, const char* key, const ThingProperties& props, ThingPropertyId id) {")
+    w("    switch (id) {")
+    for p in props:
+        ident = p["id"]
+        if p["cpp_type"] == "float":
+            value = "thingRound(props.%s, %d)" % (ident, p["decimals"])
+        elif p["cpp_type"] == "String":
+            value = "props.%s.c_str()" % ident
+        else:
+            value = "props.%s" % ident
+        w("        case TP_%s:" % ident)
+        w("            obj[key] = %s;" % value)
+        w("            break;")
+    w("        default:")
+    w("            break;")
+    w("    }")
+    w("}")
+    w("")
+    w("// 复制单个属性值（含present标记）")
+    w("inline void thingCopyValue(ThingProperties& dst, const ThingProperties& src, ThingPropertyId id) {")
+    w("    switch (id) {")
+    for p in props:
+        w("        case TP_%s:" % p["id"])
+        w("            dst.%s = src.%s;" % (p["id"], p["id"]))
+        w("            break;")
+    w("        default:")
+    w("            return;")
+    w("    }")
+    w("    if (src.has(id)) {")
+    w("        dst.mark(id);")
+    w("    }")
+    w("}")
+    w("")
+    w("// 设置整数属性的值（用于运行指标等设备侧生成的属性），非整数属性返回false")
+    w("inline bool thingSetInt(ThingProperties& props, ThingPropertyId id, int32_t value) {")
+    w("    switch (id) {")
+    for p in props:
+        if p["cpp_type"] == "int32_t":
+            w("        case TP_%s:" % p["id"])
+            w("            props.%s = value;" % p["id"])
+            w("            break;")
+    w("        default:")
+    w("            return false;")
+    w("    }")
+    w("    props.mark(id);")
+    w("    return true;")
+    w("}")
+    w("")
+    w("// 追加JSON字符串（带引号和必要的转义）")
+    w("inline void thingAppendJsonString(String& out, const char* str) {")
+    w("    out += '\"';")
+    w("    for (const char* p = str; *p; p++) {")
+    w("        if (*p == '\"' || *p == '\\\\') {")
+    w("            out += '\\\\';")
+    w("            out += *p;")
+    w("        } else if ((uint8_t)*p < 0x20) {")
+    w("            char escaped[7];")
+    w("            snprintf(escaped, sizeof(escaped), \"\\\\u%04x\", (uint8_t)*p);")
+    w("            out += escaped;")
+    w("        } else {")
+    w("            out += *p;")
+    w("        }")
+    w("    }")
+    w("    out += '\"';")
+    w("}")
+    w("")
+    w("// 追加浮点数，按步长保留小数位；NaN与无穷大写为null（与ArduinoJson一致）")
+    w("inline void thingAppendFloat(String& out, float value, uint8_t decimals) {")
+    w("    if (isnan(value) || isinf(value)) {")
+    w("        out += F(\"null\");")
+    w("        return;")
+    w("    }")
+    w("    char buffer[48];")
+    w("    dtostrf(value, 1, decimals, buffer);")
+    w("    out += buffer;")
+    w("}")
+    w("")
+    w("// 追加属性值的JSON表示")
+    w("inline void thingAppendValue(String& out, const ThingProperties& props, ThingPropertyId id) {")
+    w("    char buffer[12];")
+    w("    switch (id) {")
+    for p in props:
+        ident = p["id"]
+        t = p["cpp_type"]
+        w("        case TP_%s:" % ident)
+        if t == "float":
+            w("            thingAppendFloat(out, props.%s, %d);" % (ident, p["decimals"]))
+        elif t == "int32_t":
+            w("            out += ltoa(props.%s, buffer, 10);" % ident)
+        elif t == "bool":
+            w("            out += props.%s ? F(\"true\") : F(\"false\");" % ident)
+        else:
+            w("            thingAppendJsonString(out, props.%s.c_str());" % ident)
+        w("            break;")
+    w("        default:")
+    w("            out += F(\"null\");")
+    w("            break;")
+    w("    }")
+    w("    (void)buffer;")
+    w("}")
+    w("")
+    w("// 属性上报JSON的固定部分保存在Flash中，序列化时直接拼接，不经过JsonDocument")
+    w("static const char THING_POST_HEAD[] PROGMEM = \"{\\\"id\\\":\";")
+    w("static const char THING_POST_VERSION[] PROGMEM = \",\\\"version\\\":\\\"1.0\\\",\\\"params\\\":{\";")
+    w("static const char THING_POST_TAIL[] PROGMEM = \"}}\";")
+    for p in props:
+        w("static const char THING_POST_KEY_%s[] PROGMEM = \"\\\"%s\\\":{\\\"value\\\":\";" % (p["id"], p["id"]))
+    w("static const char* const THING_POST_KEYS[TP_COUNT] PROGMEM = {")
+    for p in props:
+        w("    THING_POST_KEY_%s," % p["id"])
+    w("};")
+    w("// 全部属性同时上报时的JSON长度估算（数值按常见长度计），用于预留String容量")
+    w("constexpr size_t THING_POST_MAX_LENGTH = %d;" % post_max_length(props))
+    w("")
+    w("// 追加已赋值属性的 \"key\":{\"value\":v},... 部分（属性上报与网关批量上报共用）")
+    w("inline void thingAppendParams(String& out, const ThingProperties& props) {")
+    w("    bool first = true;")
+    w("    for (uint8_t i = 0; i < TP_COUNT; i++) {")
+    w("        ThingPropertyId pid = (ThingPropertyId)i;")
+    w("        if (!props.has(pid)) {")
+    w("            continue;")
+    w("        }")
+    w("        if (!first) {")
+    w("            out += ',';")
+    w("        }")
+    w("        first = false;")
+    w("        out += FPSTR((const char*)pgm_read_ptr(&THING_POST_KEYS[i]));")
+    w("        thingAppendValue(out, props, pid);")
+    w("        out += '}';")
+    w("    }")
+    w("}")
+    w("")
+    w("// 生成OneNET属性上报JSON，只包含已赋值的属性")
+    w("inline void thingSerializePost(const ThingProperties& props, const char* id, String& out) {")
+    w("    out.reserve(THING_POST_MAX_LENGTH);")
+    w("    out = FPSTR(THING_POST_HEAD);")
+    w("    thingAppendJsonString(out, id);")
+    w("    out += FPSTR(THING_POST_VERSION);")
+    w("    thingAppendParams(out, props);")
+    w("    out += FPSTR(THING_POST_TAIL);")
+    w("}")
+    w("")
+    w("// 依次访问已赋值的属性，visitor需为 bool/int32_t/float/String 各提供一个重载:")
+    w("//   void operator()(ThingPropertyId id, T value)")
+    w("template <class Visitor>")
+    w("inline void thingVisit(const ThingProperties& props, Visitor& visitor) {")
+    for p in props:
+        w("    if (props.has(TP_%s)) visitor(TP_%s, props.%s);" % (p["id"], p["id"], p["id"]))
+    w("}")
+    w("")
+    w("// 非字符串属性的整数表示：整数原值，布尔为0/1，浮点数按步长缩放（供紧凑记录编码）")
+    w("inline int32_t thingGetScaled(const ThingProperties& props, ThingPropertyId id) {")
+    w("    switch (id) {")
+    for p in props:
+        if p["enum_type"] == "TM_INT":
+            w("        case TP_%s: return props.%s;" % (p["id"], p["id"]))
+        elif p["enum_type"] == "TM_BOOL":
+            w("        case TP_%s: return props.%s ? 1 : 0;" % (p["id"], p["id"]))
+        elif p["enum_type"] == "TM_FLOAT":
+            w("        case TP_%s: return thingScaleFloat(props.%s, %d);" % (p["id"], p["id"], p["decimals"]))
+    w("        default: return 0;")
+    w("    }")
+    w("}")
+    w("")
+    w("// 由整数表示还原属性值（不修改present位图）")
+    w("inline void thingSetScaled(ThingProperties& props, ThingPropertyId id, int32_t value) {")
+    w("    switch (id) {")
+    for p in props:
+        if p["enum_type"] == "TM_INT":
+            w("        case TP_%s: props.%s = value; break;" % (p["id"], p["id"]))
+        elif p["enum_type"] == "TM_BOOL":
+            w("        case TP_%s: props.%s = value != 0; break;" % (p["id"], p["id"]))
+        elif p["enum_type"] == "TM_FLOAT":
+            w("        case TP_%s: props.%s = thingUnscaleFloat(value, %d); break;" % (p["id"], p["id"], p["decimals"]))
+    w("        default: break;")
+    w("    }")
+    w("}")
+    w("")
+    w("// 字符串属性的存储位置，非字符串属性返回nullptr")
+    w("inline String* thingStringField(ThingProperties& props, ThingPropertyId id) {")
+    w("    switch (id) {")
+    for p in props:
+        if p["enum_type"] == "TM_STRING":
+            w("        case TP_%s: return &props.%s;" % (p["id"], p["id"]))
+    w("        default: return nullptr;")
+    w("    }")
+    w("}")
+    w("")
+    w("inline const String* thingStringField(const ThingProperties& props, ThingPropertyId id) {")
+    w("    return thingStringField(const_cast<ThingProperties&>(props), id);")
+    w("}")
+    w("")
+    w("#endif")
+    w("")
+    return "\n".join(out)
+
+
+def run(project_dir, model_path=None, header_path=None):
+    model_path = model_path or os.path.join(project_dir, "model", "thing_model.json")
+    header_path = header_path or os.path.join(project_dir, "include", "ThingModel.h")
+
+    props = load_properties(model_path)
+    source_name = os.path.relpath(model_path, project_dir).replace(os.sep, "/")
+    content = generate(props, source_name)
+
+    old = None
+    if os.path.exists(header_path):
+        with open(header_path, encoding="utf-8") as f:
+            old = f.read()
+    if old != content:
+        with open(header_path, "w", encoding="utf-8", newline="\n") as f:
+            f.write(content)
+        print("gen_thing_model: 已生成 %s（%d 个属性）" % (header_path, len(props)))
+
+
+try:
+    # 作为PlatformIO的pre脚本运行
+    Import("env")  # noqa: F821
+    run(env["PROJECT_DIR"])  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        args = sys.argv[1:]
+        run(root,
+            os.path.abspath(args[0]) if len(args) > 0 else None,
+            os.path.abspath(args[1]) if len(args) > 1 else None)
@@ -0,0 +1,503 @@
+"""串口 -> SerialHandler -> MqttHandler -> TCP 全链路吞吐测试（硬件在环）
+
+用法:
+    python tools/mqtt_bench.py --port COM5 [--trace tools/traces/sample.txt]
+                               [--rate 50] [--duration 60] [--mode stream]
+                               [--latency 0] [--jitter 0] [--loss 0]
+                               [--ack-delay 0] [--windows 1,2,4,8]
+
+本脚本同时扮演两端：
+  * 本地MQTT 3.1.1 broker替身（默认监听 0.0.0.0:1883），可注入延迟/抖动/丢包，
+    模拟信号差的蜂窝链路。设备的 config.h 中 MQTT_SERVER/MQTT_PORT 需指向本机。
+    --ack-delay 让QoS1的PUBACK延迟返回（按顺序），模拟确认往返时间。
+  * 假的STM32：通过USB串口按设定速率回放录制的STM32数据行。
+
+每隔 --marker-every 行插入一条带序号的标记属性（默认 Upload_Data=b<序号>），
+broker收到含该标记的 property/post 时计算 串口发送 -> 收到发布 的延迟。
+结束时发送 STATUS，读取设备侧的 SerialDrops/MqttDrops/RxOverrun 计数。
+--windows 依次用串口指令 QOS_WINDOW n 设置QoS1在途窗口，每个窗口跑一轮并输出对比表。
+
+依赖: pip install pyserial
+"""
+
+import argparse
+import collections
+import json
+import random
+import socket
+import socketserver
+import sys
+import threading
+import time
+
+POST_TOPIC_SUFFIX = "/thing/property/post"
+
+
+# ---------------------------------------------------------------------------
+# MQTT 3.1.1 broker替身
+# ---------------------------------------------------------------------------
+
+def read_exact(sock, n):
+    data = b""
+    while len(data) < n:
+        chunk = sock.recv(n - len(data))
+        if not chunk:
+            raise ConnectionError("连接已关闭")
+        data += chunk
+    return data
+
+
+def read_packet(sock):
+    """读取一个MQTT报文，返回 (类型, 标志, 报文体)"""
+    header = read_exact(sock, 1)[0]
+    length = 0
+    shift = 0
+    while True:
+        b = read_exact(sock, 1)[0]
+        length |= (b & 0x7F) << shift
+        if not b & 0x80:
+            break
+        shift += 7
+        if shift > 21:
+            raise ValueError("剩余长度字段非法")
+    body = read_exact(sock, length) if length else b""
+    return header >> 4, header & 0x0F, body
+
+
+def encode_packet(packet_type, flags, body):
+    length = len(body)
+    out = bytearray([(packet_type << 4) | flags])
+    while True:
+        b = length & 0x7F
+        length >>= 7
+        out.append(b | 0x80 if length else b)
+        if not length:
+            break
+    return bytes(out) + body
+
+
+class MiniBroker(socketserver.ThreadingTCPServer):
+    """只实现测试需要的子集：CONNECT/SUBSCRIBE/PUBLISH(QoS0/1)/PINGREQ/DISCONNECT"""
+
+    allow_reuse_address = True
+    daemon_threads = True
+
+    def __init__(self, addr, latency_ms=0, jitter_ms=0, loss=0.0, on_publish=None, ack_delay_ms=0):
+        super().__init__(addr, BrokerHandler)
+        self.latency_ms = latency_ms
+        self.jitter_ms = jitter_ms
+        self.loss = loss
+        self.ack_delay_ms = ack_delay_ms
+        self.on_publish = on_publish
+        self.lock = threading.Lock()
+        self.connects = 0
+        self.injected_drops = 0
+        self.qos1_publishes = 0
+        self.dup_publishes = 0
+
+    def link_delay(self):
+        delay = self.latency_ms + random.uniform(0, self.jitter_ms)
+        if delay > 0:
+            time.sleep(delay / 1000.0)
+
+
+class BrokerHandler(socketserver.BaseRequestHandler):
+
+    def setup(self):
+        # 出站报文统一由发送线程写出，PUBACK可按 --ack-delay 推迟而不阻塞读取
+        self.outbox = collections.deque()
+        self.outbox_cond = threading.Condition()
+        self.closed = False
+        self.writer = threading.Thread(target=self.write_loop, daemon=True)
+        self.writer.start()
+
+    def finish(self):
+        with self.outbox_cond:
+            self.closed = True
+            self.outbox_cond.notify()
+        self.writer.join(1.0)
+
+    def send(self, data, delay_ms=0):
+        # 延迟固定，按入队顺序即按到期顺序发送
+        with self.outbox_cond:
+            self.outbox.append((time.monotonic() + delay_ms / 1000.0, data))
+            self.outbox_cond.notify()
+
+    def write_loop(self):
+        while True:
+            with self.outbox_cond:
+                while not self.outbox and not self.closed:
+                    self.outbox_cond.wait()
+                if self.closed:
+                    return
+                due, data = self.outbox[0]
+                wait = due - time.monotonic()
+                if wait > 0:
+                    self.outbox_cond.wait(wait)
+                    continue
+                self.outbox.popleft()
+            try:
+                self.request.sendall(data)
+            except OSError:
+                return
+
+    def handle(self):
+        broker = self.server
+        sock = self.request
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        try:
+            while True:
+                packet_type, flags, body = read_packet(sock)
+                # 按报文注入上行延迟：读取被阻塞，设备侧的TCP发送窗口随之填满
+                broker.link_delay()
+
+                if packet_type == 1:  # CONNECT
+                    with broker.lock:
+                        broker.connects += 1
+                    self.send(encode_packet(2, 0, b"\x00\x00"))
+                elif packet_type == 3:  # PUBLISH
+                    self.handle_publish(flags, body)
+                elif packet_type == 8:  # SUBSCRIBE
+                    packet_id = body[:2]
+                    pos = 2
+                    granted = bytearray()
+                    while pos < len(body):
+                        topic_len = int.from_bytes(body[pos:pos + 2], "big")
+                        pos += 2 + topic_len
+                        granted.append(min(body[pos], 1))
+                        pos += 1
+                    self.send(encode_packet(9, 0, packet_id + bytes(granted)))
+                elif packet_type == 10:  # UNSUBSCRIBE
+                    self.send(encode_packet(11, 0, body[:2]))
+                elif packet_type == 12:  # PINGREQ
+                    self.send(encode_packet(13, 0, b""))
+                elif packet_type == 14:  # DISCONNECT
+                    break
+        except (ConnectionError, OSError, ValueError):
+            pass
+
+    def handle_publish(self, flags, body):
+        broker = self.server
+        qos = (flags >> 1) & 0x03
+        topic_len = int.from_bytes(body[:2], "big")
+        topic = body[2:2 + topic_len].decode("utf-8", "replace")
+        pos = 2 + topic_len
+        packet_id = None
+        if qos > 0:
+            packet_id = body[pos:pos + 2]
+            pos += 2
+        payload = body[pos:]
+        if qos == 1:
+            with broker.lock:
+                broker.qos1_publishes += 1
+                if flags & 0x08:
+                    broker.dup_publishes += 1
+
+        if broker.loss > 0 and random.random() < broker.loss:
+            # 模拟链路丢包：不记录也不确认
+            with broker.lock:
+                broker.injected_drops += 1
+            return
+        if qos == 1:
+            self.send(encode_packet(4, 0, packet_id), broker.ack_delay_ms)
+        on_publish = broker.on_publish
+        if on_publish is not None:
+            on_publish(time.monotonic(), topic, payload)
+
+
+# ---------------------------------------------------------------------------
+# 统计
+# ---------------------------------------------------------------------------
+
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    ordered = sorted(values)
+    index = max(0, min(len(ordered) - 1, int(round(p / 100.0 * len(ordered) + 0.5)) - 1))
+    return ordered[index]
+
+
+class Recorder:
+    """记录broker收到的发布，并按标记属性匹配串口发送时间"""
+
+    def __init__(self, marker_key):
+        self.marker_key = marker_key
+        self.lock = threading.Lock()
+        self.sent_markers = {}
+        self.latencies = []
+        self.messages = 0
+        self.bytes = 0
+        self.other_messages = 0
+        self.first_time = None
+        self.last_time = None
+
+    def marker_sent(self, marker, t):
+        with self.lock:
+            self.sent_markers[marker] = t
+
+    def on_publish(self, t, topic, payload):
+        with self.lock:
+            if not topic.endswith(POST_TOPIC_SUFFIX):
+                self.other_messages += 1
+                return
+            self.messages += 1
+            self.bytes += len(payload)
+            if self.first_time is None:
+                self.first_time = t
+            self.last_time = t
+            try:
+                params = json.loads(payload.decode("utf-8")).get("params", {})
+                marker = params.get(self.marker_key, {}).get("value")
+            except (ValueError, AttributeError):
+                return
+            sent = self.sent_markers.pop(marker, None)
+            if sent is not None:
+                self.latencies.append((t - sent) * 1000.0)
+
+
+# ---------------------------------------------------------------------------
+# 假STM32：串口回放
+# ---------------------------------------------------------------------------
+
+def load_trace(path):
+    with open(path, encoding="utf-8") as f:
+        lines = [line.rstrip("\r\n") for line in f]
+    return [line for line in lines if line and not line.startswith("#")]
+
+
+class DeviceLink:
+    """串口读写：写入回放数据，后台线程收集设备日志"""
+
+    def __init__(self, port, baud, log_path=None):
+        import serial  # 延迟导入，只有需要串口时才依赖pyserial
+        self.serial = serial.Serial(port, baud, timeout=0.1)
+        self.lines = []
+        self.lock = threading.Lock()
+        self.log = open(log_path, "w", encoding="utf-8") if log_path else None
+        self.running = True
+        self.reader = threading.Thread(target=self.read_loop, daemon=True)
+        self.reader.start()
+
+    def read_loop(self):
+        pending = b""
+        while self.running:
+            data = self.serial.read(256)
+            if not data:
+                continue
+            pending += data
+            while b"\n" in pending:
+                raw, pending = pending.split(b"\n", 1)
+                line = raw.rstrip(b"\r").decode("utf-8", "replace")
+                with self.lock:
+                    self.lines.append(line)
+                if self.log:
+                    self.log.write(line + "\n")
+
+    def send_line(self, line):
+        self.serial.write(line.encode("utf-8") + b"\r\n")
+
+    def wait_for(self, prefix, timeout):
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            with self.lock:
+                for line in reversed(self.lines):
+                    if prefix in line:
+                        return line
+            time.sleep(0.05)
+        return None
+
+    def close(self):
+        self.running = False
+        self.reader.join(1.0)
+        self.serial.close()
+        if self.log:
+            self.log.close()
+
+
+def parse_status(line):
+    fields = {}
+    for item in (line or "").split(","):
+        if ":" in item:
+            key, value = item.split(":", 1)
+            fields[key.strip()] = value.strip()
+    return fields
+
+
+def feed(link, recorder, trace, args):
+    """按 --rate 回放trace，返回 (发送行数, 发送标记数, 耗时)"""
+    interval = 1.0 / args.rate if args.rate > 0 else 0.0
+    if args.mode == "stream":
+        link.send_line("STREAM")
+    elif args.mode == "upload":
+        link.send_line("UPLOAD_DATA")
+    time.sleep(0.2)
+
+    sent_lines = 0
+    sent_markers = 0
+    start = time.monotonic()
+    next_time = start
+    index = 0
+    while time.monotonic() - start < args.duration:
+        if args.marker_every > 0 and sent_lines % args.marker_every == 0:
+            marker = "b%d" % sent_markers
+            recorder.marker_sent(marker, time.monotonic())
+            link.send_line("%s=%s" % (args.marker_key, marker))
+            sent_markers += 1
+        link.send_line(trace[index])
+        index = (index + 1) % len(trace)
+        sent_lines += 1
+
+        if interval:
+            next_time += interval
+            wait = next_time - time.monotonic()
+            if wait > 0:
+                time.sleep(wait)
+    elapsed = time.monotonic() - start
+
+    if args.mode != "normal":
+        link.send_line("END")
+    return sent_lines, sent_markers, elapsed
+
+
+def run_round(link, broker, trace, args):
+    """回放一轮并等待发布排空，返回统计结果"""
+    recorder = Recorder(args.marker_key)
+    broker.on_publish = recorder.on_publish
+    with broker.lock:
+        drops_before = broker.injected_drops
+        qos1_before = broker.qos1_publishes
+        dup_before = broker.dup_publishes
+
+    sent_lines, sent_markers, elapsed = feed(link, recorder, trace, args)
+    time.sleep(args.drain)
+    link.send_line("STATUS")
+    status = parse_status(link.wait_for("SerialDrops:", 3.0))
+    broker.on_publish = None
+
+    with recorder.lock:
+        messages = recorder.messages
+        total_bytes = recorder.bytes
+        latencies = list(recorder.latencies)
+        span = (recorder.last_time - recorder.first_time) if messages > 1 else elapsed
+    with broker.lock:
+        injected = broker.injected_drops - drops_before
+        qos1 = broker.qos1_publishes - qos1_before
+        dups = broker.dup_publishes - dup_before
+
+    return {
+        "sent_lines": sent_lines,
+        "sent_markers": sent_markers,
+        "elapsed": elapsed,
+        "messages": messages,
+        "bytes": total_bytes,
+        "span": span or elapsed,
+        "latencies": latencies,
+        "injected": injected,
+        "qos1": qos1,
+        "dups": dups,
+        "status": status,
+    }
+
+
+def print_round(result):
+    latencies = result["latencies"]
+    status = result["status"]
+    span = result["span"]
+    elapsed = result["elapsed"]
+    print("回放: %d 行 + %d 个标记, %.1fs, %.1f 行/s" %
+          (result["sent_lines"], result["sent_markers"], elapsed,
+           (result["sent_lines"] + result["sent_markers"]) / elapsed))
+    print("发布: %d 条, %.1f 条/s, %.0f 字节/s" %
+          (result["messages"], result["messages"] / span, result["bytes"] / span))
+    print("延迟: p50 %.1fms, p99 %.1fms, 最大 %.1fms (%d/%d 个标记到达)" %
+          (percentile(latencies, 50), percentile(latencies, 99),
+           max(latencies) if latencies else float("nan"), len(latencies), result["sent_markers"]))
+    print("丢弃: 链路注入 %d, 标记丢失 %d, 设备 SerialDrops %s, MqttDrops %s, RxOverrun %s" %
+          (result["injected"], result["sent_markers"] - len(latencies), status.get("SerialDrops", "?"),
+           status.get("MqttDrops", "?"), status.get("RxOverrun", "?")))
+    print("QoS1: %d 条PUBLISH, 其中DUP重发 %d 条; 设备 PubAcks %s, Resends %s" %
+          (result["qos1"], result["dups"], status.get("PubAcks", "?"), status.get("Resends", "?")))
+
+
+def print_window_table(rows):
+    print("%6s %10s %10s %10s %10s %8s %8s" %
+          ("窗口", "条/s", "字节/s", "p50(ms)", "p99(ms)", "标记丢失", "DUP"))
+    for window, result in rows:
+        latencies = result["latencies"]
+        span = result["span"]
+        print("%6d %10.1f %10.0f %10.1f %10.1f %8d %8d" %
+              (window, result["messages"] / span, result["bytes"] / span,
+               percentile(latencies, 50), percentile(latencies, 99),
+               result["sent_markers"] - len(latencies), result["dups"]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="ESP8266 串口到MQTT全链路吞吐测试")
+    parser.add_argument("--port", required=True, help="设备串口，如 COM5 或 /dev/ttyUSB0")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--trace", default="tools/traces/sample.txt", help="录制的STM32数据行")
+    parser.add_argument("--mode", choices=["stream", "upload", "normal"], default="stream")
+    parser.add_argument("--rate", type=float, default=50, help="每秒发送行数，0为不限速")
+    parser.add_argument("--duration", type=float, default=30, help="回放时长(s)")
+    parser.add_argument("--drain", type=float, default=5, help="回放结束后等待发布的时间(s)")
+    parser.add_argument("--marker-key", default="Upload_Data", help="用于测量延迟的字符串属性")
+    parser.add_argument("--marker-every", type=int, default=10, help="每N行插入一个延迟标记，0为不插入")
+    parser.add_argument("--bind", default="0.0.0.0")
+    parser.add_argument("--broker-port", type=int, default=1883)
+    parser.add_argument("--latency", type=float, default=0, help="broker每个报文的固定延迟(ms)")
+    parser.add_argument("--jitter", type=float, default=0, help="broker每个报文的随机附加延迟上限(ms)")
+    parser.add_argument("--loss", type=float, default=0, help="PUBLISH丢包率 0~1")
+    parser.add_argument("--ack-delay", type=float, default=0, help="QoS1 PUBACK的返回延迟(ms)")
+    parser.add_argument("--windows", help="逐个测试的QoS1在途窗口，如 1,2,4,8（需设备 MQTT_PUBLISH_QOS 为1）")
+    parser.add_argument("--connect-wait", type=float, default=30, help="等待设备连接broker的时间(s)")
+    parser.add_argument("--log", help="保存设备串口日志的文件")
+    args = parser.parse_args()
+
+    trace = load_trace(args.trace)
+    if not trace:
+        sys.exit("trace为空: %s" % args.trace)
+
+    windows = [int(w) for w in args.windows.split(",")] if args.windows else []
+
+    broker = MiniBroker((args.bind, args.broker_port), args.latency, args.jitter, args.loss,
+                        ack_delay_ms=args.ack_delay)
+    threading.Thread(target=broker.serve_forever, daemon=True).start()
+    print("broker替身监听 %s:%d (延迟 %gms, 抖动 %gms, 丢包 %.1f%%, PUBACK延迟 %gms)" %
+          (args.bind, args.broker_port, args.latency, args.jitter, args.loss * 100, args.ack_delay))
+
+    link = DeviceLink(args.port, args.baud, args.log)
+    try:
+        print("等待设备连接broker...")
+        deadline = time.monotonic() + args.connect_wait
+        while broker.connects == 0 and time.monotonic() < deadline:
+            time.sleep(0.1)
+        if broker.connects == 0:
+            sys.exit("设备未连接到broker，请检查 MQTT_SERVER/MQTT_PORT 配置")
+
+        rows = []
+        if windows:
+            for window in windows:
+                link.send_line("QOS_WINDOW %d" % window)
+                if link.wait_for("QoS1窗口: %d" % window, 3.0) is None:
+                    print("设备未确认窗口 %d，跳过" % window)
+                    continue
+                print("")
+                print("== QoS1窗口 %d ==" % window)
+                result = run_round(link, broker, trace, args)
+                print_round(result)
+                rows.append((window, result))
+        else:
+            print("")
+            print_round(run_round(link, broker, trace, args))
+    finally:
+        link.close()
+        broker.shutdown()
+
+    if rows:
+        print("")
+        print_window_table(rows)
+    print("重连: %d 次" % max(0, broker.connects - 1))
+
+
+if __name__ == "__main__":
+    main()
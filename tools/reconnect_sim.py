@@ -0,0 +1,171 @@
+"""现场N台设备同时掉线后的重连模拟（主机离散事件模拟，不需要硬件）
+
+用法:
+    python tools/reconnect_sim.py [--devices 500] [--ap-down 20] [--broker-rate 20]
+                                  [--base 2000] [--cap 120000] [--duration 600]
+
+场景：同一现场的AP重启，所有设备在t=0同时断开，AP在 --ap-down 秒后恢复。
+broker替身按令牌桶限制每秒接受的连接数（--broker-rate，模拟OneNET的接入限流），
+超出的连接被拒绝，设备按各自的策略重试。对比两种策略：
+
+  fixed   原实现：每 --interval 秒检查一次并重连（设备同时上电，检查时刻对齐）
+  jitter  ConnectionManager：去相关抖动指数退避，delay = min(cap, random(base, 上次delay*3))，
+          随机数为按芯片ID与设备ID播种的xorshift32，与固件算法一致
+
+输出每秒连接尝试数的分布、峰值、被拒绝次数和全部设备恢复所需时间。
+"""
+
+import argparse
+import heapq
+import random
+
+MASK32 = 0xFFFFFFFF
+
+
+def fnv_seed(chip_id, device_id):
+    """与 ConnectionManager::begin() 相同的种子计算"""
+    seed = chip_id & MASK32
+    for ch in device_id.encode("utf-8"):
+        seed = ((seed ^ ch) * 16777619) & MASK32
+    return seed
+
+
+class ReconnectBackoff:
+    """ReconnectBackoff 的Python移植，需与 src/ConnectionManager.cpp 保持一致"""
+
+    def __init__(self, base, cap, seed):
+        self.base = base
+        self.cap = cap
+        self.current = 0
+        self.state = seed if seed != 0 else 0x9E3779B9
+
+    def next_random(self):
+        x = self.state
+        x ^= (x << 13) & MASK32
+        x ^= x >> 17
+        x ^= (x << 5) & MASK32
+        self.state = x
+        return x
+
+    def next(self):
+        upper = self.base * 3 if self.current == 0 else self.current * 3
+        upper = min(upper, self.cap)
+        self.current = self.base + self.next_random() % (upper - self.base + 1)
+        return self.current
+
+    def reset(self):
+        self.current = 0
+
+
+class ThrottledBroker:
+    """broker替身：令牌桶限流，桶容量为1秒的配额"""
+
+    def __init__(self, rate):
+        self.rate = rate
+        self.tokens = float(rate)
+        self.last = 0.0
+        self.accepted = 0
+        self.rejected = 0
+
+    def connect(self, t):
+        self.tokens = min(float(self.rate), self.tokens + (t - self.last) * self.rate)
+        self.last = t
+        if self.tokens >= 1.0:
+            self.tokens -= 1.0
+            self.accepted += 1
+            return True
+        self.rejected += 1
+        return False
+
+
+def simulate(strategy, args, chip_ids):
+    """返回 (每秒尝试数列表, broker, 全部恢复的时间或None)"""
+    broker = ThrottledBroker(args.broker_rate)
+    attempts = [0] * (args.duration + 1)
+    events = []
+    backoffs = []
+
+    for i in range(args.devices):
+        seed = fnv_seed(chip_ids[i], "dev%04d" % i)
+        wifi = ReconnectBackoff(args.base, args.cap, seed)
+        mqtt = ReconnectBackoff(args.base, args.cap, seed ^ 0x5A5A5A5A)
+        backoffs.append((wifi, mqtt))
+        if strategy == "fixed":
+            # 同时上电，检查时刻对齐，仅有loop耗时带来的毫秒级差异
+            first = args.interval + random.uniform(0, 0.05)
+        else:
+            first = wifi.next() / 1000.0
+        heapq.heappush(events, (first, i, "wifi"))
+
+    connected = 0
+    all_up = None
+    while events:
+        t, i, kind = heapq.heappop(events)
+        if t > args.duration:
+            break
+        wifi, mqtt = backoffs[i]
+
+        if kind == "wifi":
+            if t < args.ap_down:
+                delay = args.interval if strategy == "fixed" else wifi.next() / 1000.0
+                heapq.heappush(events, (t + delay, i, "wifi"))
+                continue
+            wifi.reset()
+            # WiFi恢复后立即尝试MQTT（fixed策略在同一次检查中依次完成）
+            heapq.heappush(events, (t + 0.5, i, "mqtt"))
+            continue
+
+        attempts[int(t)] += 1
+        if broker.connect(t):
+            mqtt.reset()
+            connected += 1
+            if connected == args.devices:
+                all_up = t
+        else:
+            delay = args.interval if strategy == "fixed" else mqtt.next() / 1000.0
+            heapq.heappush(events, (t + delay, i, "mqtt"))
+
+    return attempts, broker, all_up
+
+
+def histogram(attempts, width, bucket):
+    rows = []
+    buckets = [sum(attempts[i:i + bucket]) for i in range(0, len(attempts), bucket)]
+    last = max((i for i, v in enumerate(buckets) if v), default=0)
+    peak = max(buckets) or 1
+    for i in range(last + 1):
+        bar = "#" * int(round(buckets[i] * width / peak))
+        rows.append("  %4ds %5d %s" % (i * bucket, buckets[i], bar))
+    return "\n".join(rows)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="现场设备重连风暴模拟")
+    parser.add_argument("--devices", type=int, default=500)
+    parser.add_argument("--ap-down", type=float, default=20, help="AP恢复前的时间(s)")
+    parser.add_argument("--broker-rate", type=float, default=20, help="broker每秒接受的连接数")
+    parser.add_argument("--interval", type=float, default=30, help="fixed策略的检查间隔(s)")
+    parser.add_argument("--base", type=int, default=2000, help="RECONNECT_BACKOFF_BASE(ms)")
+    parser.add_argument("--cap", type=int, default=120000, help="RECONNECT_BACKOFF_CAP(ms)")
+    parser.add_argument("--duration", type=int, default=900, help="模拟时长(s)")
+    parser.add_argument("--bucket", type=int, default=5, help="直方图每格的秒数")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    random.seed(args.seed)
+    chip_ids = [random.getrandbits(32) for _ in range(args.devices)]
+
+    for strategy in ("fixed", "jitter"):
+        random.seed(args.seed)
+        attempts, broker, all_up = simulate(strategy, args, chip_ids)
+        print("== %s ==" % strategy)
+        print("MQTT连接尝试（每 %ds）:" % args.bucket)
+        print(histogram(attempts, 50, args.bucket))
+        print("峰值 %d 次/s, 接受 %d, 被限流拒绝 %d, 全部恢复: %s" %
+              (max(attempts), broker.accepted, broker.rejected,
+               "%.1fs" % all_up if all_up is not None else "超过 %ds" % args.duration))
+        print("")
+
+
+if __name__ == "__main__":
+    main()
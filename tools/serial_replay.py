@@ -0,0 +1,205 @@
+"""串口抓包的提取、查看与回放，用于用现场数据复现解析问题并验证解析优化
+
+用法:
+    python tools/serial_replay.py extract 设备日志.txt -o field.trace
+    python tools/serial_replay.py show field.trace
+    python tools/serial_replay.py replay field.trace --port COM5 [--speed 1] [--wrap upload]
+
+抓包流程：现场设备上依次发送 TRACE_START …（复现问题）… TRACE_DUMP，
+把串口日志保存下来，再用 extract 提取 TRACE_BEGIN/TRACE:/TRACE_END 之间的数据。
+
+trace文件格式：b"CYZT" + 版本(1字节)，之后为设备端的记录：
+    [距上一条的毫秒数 varint][字节数 varint][原始字节]
+replay 也接受纯文本trace（如 tools/traces/sample.txt），每行作为一条间隔为0的记录。
+
+replay 按原始时间间隔（--speed 倍速，0为不等待）把字节写入设备串口，
+前后发送 PARSE_STATS_RESET / PARSE_STATS，输出设备侧的每行解析耗时和内存分配次数。
+分配次数需使用 esp12e_trace 环境编译的固件（pio run -e esp12e_trace）。
+
+依赖: pip install pyserial（仅 replay 需要）
+"""
+
+import argparse
+import sys
+import time
+
+from mqtt_bench import DeviceLink, parse_status
+
+TRACE_MAGIC = b"CYZT"
+TRACE_VERSION = 1
+
+
+def read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(data):
+            raise ValueError("trace数据不完整")
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return value, pos
+        shift += 7
+
+
+def decode_records(data):
+    """返回 [(距上一条的毫秒数, 原始字节)]"""
+    records = []
+    pos = 0
+    while pos < len(data):
+        delta, pos = read_varint(data, pos)
+        length, pos = read_varint(data, pos)
+        if pos + length > len(data):
+            raise ValueError("trace数据不完整")
+        records.append((delta, data[pos:pos + length]))
+        pos += length
+    return records
+
+
+def load_trace(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data.startswith(TRACE_MAGIC):
+        if data[4] != TRACE_VERSION:
+            raise ValueError("不支持的trace版本: %d" % data[4])
+        return decode_records(data[5:])
+    # 纯文本trace
+    lines = data.decode("utf-8").splitlines()
+    return [(0, line.encode("utf-8") + b"\r\n") for line in lines
+            if line and not line.startswith("#")]
+
+
+def extract(log_path):
+    """从设备日志中提取最后一次TRACE_DUMP的数据"""
+    with open(log_path, encoding="utf-8", errors="replace") as f:
+        lines = [line.strip() for line in f]
+
+    begin = None
+    for i, line in enumerate(lines):
+        if line.startswith("TRACE_BEGIN"):
+            begin = i
+    if begin is None:
+        raise ValueError("日志中没有TRACE_BEGIN")
+
+    data = bytearray()
+    expected_sum = None
+    for line in lines[begin + 1:]:
+        if line.startswith("TRACE:"):
+            data += bytes.fromhex(line[6:])
+        elif line.startswith("TRACE_END"):
+            expected_sum = int(line.split("sum=")[1])
+            break
+    if expected_sum is None:
+        raise ValueError("日志中没有TRACE_END，抓包数据不完整")
+    if sum(data) & 0xFFFF != expected_sum:
+        raise ValueError("校验和不一致，日志中可能混入了其他输出")
+    return lines[begin], bytes(data)
+
+
+def cmd_extract(args):
+    header, data = extract(args.log)
+    records = decode_records(data)
+    with open(args.output, "wb") as f:
+        f.write(TRACE_MAGIC + bytes([TRACE_VERSION]) + data)
+    print(header)
+    print("已写入 %s: %d 条记录, %d 字节" % (args.output, len(records), len(data)))
+
+
+def cmd_show(args):
+    records = load_trace(args.trace)
+    t = 0
+    for delta, raw in records:
+        t += delta
+        print("%8dms %3dB %r" % (t, len(raw), raw))
+    total = sum(len(raw) for _, raw in records)
+    lines = sum(raw.count(b"\n") for _, raw in records)
+    print("共 %d 条记录, %d 字节, 约 %d 行, 时长 %.1fs" % (len(records), total, lines, t / 1000.0))
+
+
+def cmd_replay(args):
+    records = load_trace(args.trace)
+    if not records:
+        sys.exit("trace为空: %s" % args.trace)
+
+    link = DeviceLink(args.port, args.baud, args.log)
+    try:
+        link.send_line("PARSE_STATS_RESET")
+        link.wait_for("解析统计已清零", 2.0)
+        if args.wrap == "upload":
+            link.send_line("UPLOAD_DATA")
+        elif args.wrap == "stream":
+            link.send_line("STREAM")
+        time.sleep(0.2)
+
+        sent = 0
+        start = time.monotonic()
+        due = start
+        for delta, raw in records:
+            if args.speed > 0:
+                due += delta / 1000.0 / args.speed
+                wait = due - time.monotonic()
+                if wait > 0:
+                    time.sleep(wait)
+            link.serial.write(raw)
+            sent += len(raw)
+        link.serial.flush()
+        elapsed = time.monotonic() - start
+
+        # 上传/流式模式下不处理命令，先CANCEL返回正常模式（统计中包含进入/退出模式的2行）
+        time.sleep(args.settle)
+        if args.wrap != "none":
+            link.send_line("CANCEL")
+        link.send_line("PARSE_STATS")
+        stats = parse_status(link.wait_for("AllocsPerLine:", 3.0))
+    finally:
+        link.close()
+
+    if not stats:
+        sys.exit("未收到PARSE_STATS输出")
+
+    lines = int(stats.get("Lines", 0))
+    total_us = int(stats.get("TotalUs", 0))
+    print("回放: %d 条记录, %d 字节, %.2fs (%.0f 字节/s)" %
+          (len(records), sent, elapsed, sent / elapsed if elapsed else 0))
+    print("解析: %d 行, 平均 %sus/行, 最大 %sus, 吞吐 %.0f 行/s（仅解析耗时）" %
+          (lines, stats.get("AvgUs", "?"), stats.get("MaxUs", "?"),
+           lines * 1e6 / total_us if total_us else 0))
+    allocs = stats.get("AllocsPerLine", "-1")
+    print("内存: %s 次分配/行, 最低空闲堆 %s 字节" %
+          ("未启用（需esp12e_trace固件）" if allocs == "-1" else allocs, stats.get("HeapMin", "?")))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="串口抓包提取/查看/回放")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("extract", help="从设备日志提取TRACE_DUMP数据")
+    p.add_argument("log")
+    p.add_argument("-o", "--output", default="serial.trace")
+    p.set_defaults(func=cmd_extract)
+
+    p = sub.add_parser("show", help="按时间顺序打印trace内容")
+    p.add_argument("trace")
+    p.set_defaults(func=cmd_show)
+
+    p = sub.add_parser("replay", help="把trace回放到设备串口并读取解析统计")
+    p.add_argument("trace")
+    p.add_argument("--port", required=True)
+    p.add_argument("--baud", type=int, default=115200)
+    p.add_argument("--speed", type=float, default=1.0, help="回放倍速，0为不等待")
+    p.add_argument("--wrap", choices=["none", "upload", "stream"], default="none",
+                   help="回放前进入的模式，upload只解析不上传")
+    p.add_argument("--settle", type=float, default=1.0, help="回放结束后等待设备处理的时间(s)")
+    p.add_argument("--log", help="保存设备串口日志的文件")
+    p.set_defaults(func=cmd_replay)
+
+    args = parser.parse_args()
+    try:
+        args.func(args)
+    except (OSError, ValueError) as e:
+        sys.exit("错误: %s" % e)
+
+
+if __name__ == "__main__":
+    main()
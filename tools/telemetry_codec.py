@@ -0,0 +1,264 @@
+"""离线属性上报紧凑格式（TelemetryQueue）的主机端基准：用录制的串口数据计算压缩比
+
+用法:
+    python tools/telemetry_codec.py [tools/traces/sample.txt ...] [--batch 0] [--repeat 100]
+                                    [--queue-bytes 4096] [--queue-messages 10]
+
+按设备端相同的规则把trace中的 key=value 行解析为属性上报，分别计算
+OneNET JSON（thingSerializePost）与紧凑记录（src/TelemetryQueue.cpp）的字节数，
+并解码每条紧凑记录与原值比对。
+
+记录划分：--batch 0（默认）在某个键再次出现时开始新的一条上报，对应STM32每轮扫描上报一次；
+--batch N 每N行合并为一条（同一键取最后的值），对应STREAM模式的微批次。
+trace既可以是纯文本（每行 key=value），也可以是 serial_replay.py extract 得到的二进制抓包。
+--repeat 将trace重复多次，估算长时间断网时队列能保存的上报条数。
+"""
+
+import argparse
+import json
+import math
+import os
+import struct
+import sys
+
+from gen_thing_model import load_properties
+from serial_replay import load_trace
+
+MODEL_PATH = os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__file__))),
+                          "model", "thing_model.json")
+SCALED_NULL = -2 ** 31
+
+
+# ---------------------------------------------------------------------------
+# 紧凑格式（与 src/TelemetryQueue.cpp 一致）
+# ---------------------------------------------------------------------------
+
+def write_varint(out, value):
+    value &= 0xFFFFFFFF
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+
+
+def read_varint(data, pos):
+    value = 0
+    for shift in range(0, 35, 7):
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return value, pos
+    raise ValueError("varint过长")
+
+
+def to_int32(value):
+    value &= 0xFFFFFFFF
+    return value - 0x100000000 if value & 0x80000000 else value
+
+
+def zigzag_encode(value):
+    return ((value << 1) ^ (value >> 31)) & 0xFFFFFFFF
+
+
+def zigzag_decode(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def scale_value(prop, value):
+    """非字符串属性的整数表示（thingGetScaled）"""
+    if prop["enum_type"] == "TM_BOOL":
+        return 1 if value else 0
+    if prop["enum_type"] == "TM_FLOAT":
+        if math.isnan(value) or math.isinf(value):
+            return SCALED_NULL
+        # 设备端的float先转为double再缩放，这里同样按单精度取值
+        value = struct.unpack("f", struct.pack("f", value))[0]
+        scaled = value * 10 ** prop["decimals"]
+        return int(math.floor(scaled + 0.5)) if scaled >= 0 else -int(math.floor(-scaled + 0.5))
+    return int(value)
+
+
+class Encoder:
+    def __init__(self, props):
+        self.props = props
+        self.base = [0] * len(props)
+
+    def encode(self, record):
+        out = bytearray()
+        present = 0
+        for index in record:
+            present |= 1 << index
+        write_varint(out, present)
+        for index, prop in enumerate(self.props):
+            if index not in record:
+                continue
+            value = record[index]
+            if prop["enum_type"] == "TM_STRING":
+                raw = value.encode("utf-8")
+                write_varint(out, len(raw))
+                out += raw
+            else:
+                scaled = scale_value(prop, value)
+                write_varint(out, zigzag_encode(to_int32(scaled - self.base[index])))
+                self.base[index] = scaled
+        return bytes(out)
+
+
+class Decoder:
+    def __init__(self, props):
+        self.props = props
+        self.base = [0] * len(props)
+
+    def decode(self, data):
+        present, pos = read_varint(data, 0)
+        record = {}
+        for index, prop in enumerate(self.props):
+            if not present & (1 << index):
+                continue
+            value, pos = read_varint(data, pos)
+            if prop["enum_type"] == "TM_STRING":
+                record[index] = data[pos:pos + value].decode("utf-8")
+                pos += value
+            else:
+                self.base[index] = to_int32(self.base[index] + zigzag_decode(value))
+                record[index] = self.base[index]
+        if pos != len(data):
+            raise ValueError("记录长度不符")
+        return record
+
+
+# ---------------------------------------------------------------------------
+# OneNET JSON（与 thingSerializePost 一致）
+# ---------------------------------------------------------------------------
+
+def json_value(prop, value):
+    if prop["enum_type"] == "TM_BOOL":
+        return "true" if value else "false"
+    if prop["enum_type"] == "TM_STRING":
+        return json.dumps(value, ensure_ascii=False)
+    if prop["enum_type"] == "TM_FLOAT":
+        if math.isnan(value) or math.isinf(value):
+            return "null"
+        return "%.*f" % (prop["decimals"], value)
+    return str(int(value))
+
+
+def json_post(props, record, message_id):
+    params = ",".join('"%s":{"value":%s}' % (props[i]["id"], json_value(props[i], record[i]))
+                      for i in sorted(record))
+    return '{"id":"%d","version":"1.0","params":{%s}}' % (message_id, params)
+
+
+# ---------------------------------------------------------------------------
+# trace解析
+# ---------------------------------------------------------------------------
+
+def parse_value(prop, text):
+    """thingParseText的简化版：类型或范围不符时返回None"""
+    try:
+        if prop["enum_type"] == "TM_BOOL":
+            lowered = text.lower()
+            if lowered in ("1", "true", "on"):
+                return True
+            if lowered in ("0", "false", "off"):
+                return False
+            return None
+        if prop["enum_type"] == "TM_STRING":
+            return text if prop["length"] is None or len(text) <= prop["length"] else None
+        value = float(text) if prop["enum_type"] == "TM_FLOAT" else int(text)
+    except ValueError:
+        return None
+    if prop["min"] is not None and not (prop["min"] <= value <= prop["max"]):
+        return None
+    return value
+
+
+def load_lines(path):
+    data = b"".join(raw for _, raw in load_trace(path))
+    lines = data.decode("utf-8", "replace").replace("\r", "\n").split("\n")
+    return [line.strip() for line in lines if line.strip() and not line.startswith("#")]
+
+
+def split_key_value(line):
+    # 与SerialHandler::validateKeyValueFormat一致：优先使用'='
+    for sep in ("=", ":"):
+        pos = line.find(sep)
+        if pos > 0:
+            return line[:pos].strip(), line[pos + 1:].strip()
+    return None, None
+
+
+def build_records(props, lines, batch):
+    index_of = {p["id"]: i for i, p in enumerate(props)}
+    records = []
+    current = {}
+    count = 0
+    for line in lines:
+        key, text = split_key_value(line)
+        index = index_of.get(key)
+        if index is None:
+            continue
+        value = parse_value(props[index], text)
+        if value is None:
+            continue
+        if batch == 0 and index in current:
+            records.append(current)
+            current = {}
+        current[index] = value
+        count += 1
+        if batch > 0 and count % batch == 0:
+            records.append(current)
+            current = {}
+    if current:
+        records.append(current)
+    return records
+
+
+def main():
+    parser = argparse.ArgumentParser(description="离线属性上报紧凑格式压缩比测试")
+    parser.add_argument("traces", nargs="*", default=["tools/traces/sample.txt"])
+    parser.add_argument("--batch", type=int, default=0, help="每N行合并为一条上报，0为按键重复划分")
+    parser.add_argument("--repeat", type=int, default=100, help="trace重复次数")
+    parser.add_argument("--queue-bytes", type=int, default=4096, help="TELEMETRY_QUEUE_BYTES")
+    parser.add_argument("--queue-messages", type=int, default=10, help="原JSON重传队列的条数上限")
+    args = parser.parse_args()
+
+    props = load_properties(MODEL_PATH)
+    total_json = 0
+    total_compact = 0
+    for path in args.traces:
+        records = build_records(props, load_lines(path), args.batch) * max(1, args.repeat)
+        if not records:
+            print("%s: 没有有效的属性数据" % path)
+            continue
+
+        encoder = Encoder(props)
+        decoder = Decoder(props)
+        json_bytes = 0
+        compact_bytes = 0
+        for number, record in enumerate(records, 1):
+            compact = encoder.encode(record)
+            decoded = decoder.decode(compact)
+            expected = {i: (scale_value(props[i], v) if props[i]["enum_type"] != "TM_STRING" else v)
+                        for i, v in record.items()}
+            if decoded != expected:
+                sys.exit("%s: 第%d条记录解码结果不一致" % (path, number))
+            json_bytes += len(json_post(props, record, number).encode("utf-8"))
+            compact_bytes += len(compact)
+
+        total_json += json_bytes
+        total_compact += compact_bytes
+        print("%s: %d 条上报, JSON %d 字节 (%.1f/条), 紧凑 %d 字节 (%.1f/条), 压缩比 %.1f" %
+              (path, len(records), json_bytes, json_bytes / len(records), compact_bytes,
+               compact_bytes / len(records), json_bytes / compact_bytes))
+        print("  按平均长度, %d 字节队列约可保存 %d 条上报（原JSON重传队列 %d 条）" %
+              (args.queue_bytes, args.queue_bytes * len(records) // compact_bytes, args.queue_messages))
+
+    if len(args.traces) > 1 and total_compact:
+        print("合计: JSON %d 字节, 紧凑 %d 字节, 压缩比 %.1f" %
+              (total_json, total_compact, total_json / total_compact))
+
+
+if __name__ == "__main__":
+    main()